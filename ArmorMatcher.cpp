@@ -2,43 +2,446 @@
 #include <vector>
 #include <fstream>
 #include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <thread>
 #include <opencv2/core/mat.hpp>
-#include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
 namespace armor
 {
 namespace
 {
+// 全局分类器：g_matcherMutex 只在发布与线程快照过期时使用，g_matcherGeneration 标记快照是否过期
 std::shared_ptr<ArmorMatcher> g_matcher;
 std::mutex g_matcherMutex;
+std::atomic<uint64_t> g_matcherGeneration{0};
+
+// 正面视图几何：装甲板四边形先映射到 224x224，左右各裁掉 50 像素；剩余区域按全高拉伸后
+// 水平居中保留 150/224 的宽度（原模型为缩放到 224x224 后居中裁剪 150 像素），对应网络输入的全部宽度
+constexpr int kFrontViewSize = 224;
+constexpr int kFrontViewSideCrop = 50;
+constexpr double kCenterCropRatio = 150.0 / 224.0;
+// 模型输入宽高为动态维度且调用方未指定时使用的网络输入尺寸（原 ResNet 模型）
+constexpr int kDefaultInputWidth = 150;
+constexpr int kDefaultInputHeight = 224;
+// 灰度二值化阈值
+constexpr int kBinaryThreshold = 40;
+// 每通道归一化参数（ImageNet）
+constexpr float kMean[3] = {0.485f, 0.456f, 0.406f};
+constexpr float kStd[3] = {0.229f, 0.224f, 0.225f};
+
+// 输入通道折叠后允许的输出偏差（相对输出最大绝对值）
+constexpr double kFoldTolerance = 1e-2;
+
+// 8 位像素到网络输入的查找表：前三项为各通道的 (v / 255 - mean) / std，第四项为折叠后单通道输入的 v / 255
+const cv::Mat &inputLut(int channel, int channels)
+{
+    static const std::array<cv::Mat, 4> tables = [] {
+        std::array<cv::Mat, 4> t;
+        for (int c = 0; c < 4; c++)
+        {
+            t[c].create(1, 256, CV_32F);
+            float *values = t[c].ptr<float>();
+            for (int v = 0; v < 256; v++)
+                values[v] = c < 3 ? (v / 255.0f - kMean[c]) / kStd[c] : v / 255.0f;
+        }
+        return t;
+    }();
+    return tables[channels == 1 ? 3 : channel];
+}
+
+// 单通道 8 位图像经查找表直接写入 1xCxHxW 张量的各个通道平面
+void planeToBlob(const cv::Mat &plane, cv::Mat &blob, int channels)
+{
+    int dims[4] = {1, channels, plane.rows, plane.cols};
+    blob.create(4, dims, CV_32F);
+    for (int c = 0; c < channels; c++)
+    {
+        cv::Mat dst(plane.rows, plane.cols, CV_32F, blob.ptr<float>() + static_cast<size_t>(c) * plane.total());
+        cv::LUT(plane, inputLut(c, channels), dst);
+    }
+}
+
+// 居中裁剪出网络输入宽度之前的缩放宽度（原模型为 224）
+int preCropWidth(int inputWidth)
+{
+    return static_cast<int>(std::lround(inputWidth / kCenterCropRatio));
+}
+
+// 按 match 的预处理把图像转为单通道二值图：灰度、二值化、缩放到网络输入高度后居中裁剪出网络输入宽度
+bool imageToPlane(const cv::Mat &image, int inputWidth, int inputHeight, cv::Mat &plane, std::string &error)
+{
+    if (image.empty())
+    {
+        error = "输入图像为空";
+        return false;
+    }
+
+    // 灰度二值化后三个通道完全相同，只在单通道上缩放与裁剪，最后经查找表直接写入张量
+    cv::Mat gray;
+    if (image.channels() == 1)
+    {
+        gray = image;
+    }
+    else if (image.channels() == 3)
+    {
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    }
+    else if (image.channels() == 4)
+    {
+        cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+    }
+    else
+    {
+        error = "不支持的通道数: " + std::to_string(image.channels());
+        return false;
+    }
+
+    cv::Mat binary;
+    cv::threshold(gray, binary, kBinaryThreshold, 255, cv::THRESH_BINARY);
+    const int resizedWidth = preCropWidth(inputWidth);
+    cv::resize(binary, plane, cv::Size(resizedWidth, inputHeight), 0, 0, cv::INTER_LINEAR);
+    plane = plane(cv::Rect((resizedWidth - inputWidth) / 2, 0, inputWidth, plane.rows));
+    return true;
+}
+
+// 用几组典型的二值输入比对折叠前后网络的输出
+bool verifyFoldedSession(InferenceSession &reference, InferenceSession &folded, int rows, int cols)
+{
+    cv::Mat plane(rows, cols, CV_8U);
+    cv::Mat referenceBlob, foldedBlob, expected, actual;
+    std::string error;
+    cv::RNG rng(0x61726d72);
+    for (int test = 0; test < 3; test++)
+    {
+        plane.setTo(0);
+        if (test == 1)
+            cv::rectangle(plane, cv::Rect(cols / 4, rows / 6, cols / 2, rows * 2 / 3), cv::Scalar(255), cv::FILLED);
+        else if (test == 2)
+        {
+            rng.fill(plane, cv::RNG::UNIFORM, 0, 256);
+            cv::threshold(plane, plane, 127, 255, cv::THRESH_BINARY);
+        }
+
+        planeToBlob(plane, referenceBlob, 3);
+        planeToBlob(plane, foldedBlob, 1);
+        if (!reference.run(referenceBlob, expected, error) || !folded.run(foldedBlob, actual, error) ||
+            expected.total() != actual.total())
+            return false;
+
+        cv::Point expectedClass, actualClass;
+        cv::minMaxLoc(expected, nullptr, nullptr, nullptr, &expectedClass);
+        cv::minMaxLoc(actual, nullptr, nullptr, nullptr, &actualClass);
+        double range = std::max(1e-6, cv::norm(expected, cv::NORM_INF));
+        if (expectedClass != actualClass || cv::norm(expected, actual, cv::NORM_INF) > kFoldTolerance * range)
+            return false;
+    }
+    return true;
+}
+
+// 预热推理：全零输入按各批大小推理一次，倒序进行使第一个批大小最后执行
+bool warmUp(InferenceSession &session, const std::vector<int> &batchSizes, int channels, int rows, int cols,
+            std::string &error)
+{
+    cv::Mat output;
+    for (auto it = batchSizes.rbegin(); it != batchSizes.rend(); ++it)
+    {
+        if (*it <= 0)
+            continue;
+        int dims[4] = {*it, channels, rows, cols};
+        cv::Mat blob = cv::Mat::zeros(4, dims, CV_32F);
+        if (!session.run(blob, output, error))
+            return false;
+    }
+    return true;
+}
+
+// 模型缓存文件名：<模型哈希>-<后端及内容>
+std::string cacheFileName(uint64_t hash, const char *suffix)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%s", static_cast<unsigned long long>(hash), suffix);
+    return name;
+}
+
+// 折叠比对结果缓存：返回 1 通过、0 未通过，-1 表示没有记录或容差已改变
+int readFoldDecision(const std::string &path)
+{
+    cv::FileStorage fs;
+    try
+    {
+        if (!std::filesystem::exists(path) || !fs.open(path, cv::FileStorage::READ))
+            return -1;
+    }
+    catch (const cv::Exception &)
+    {
+        return -1;
+    }
+    double tolerance = 0.0;
+    int folded = -1;
+    fs["tolerance"] >> tolerance;
+    fs["folded"] >> folded;
+    if (tolerance != kFoldTolerance || folded < 0)
+        return -1;
+    return folded != 0 ? 1 : 0;
+}
+
+void writeFoldDecision(const std::string &path, bool folded)
+{
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened())
+        return;
+    fs << "tolerance" << kFoldTolerance;
+    fs << "folded" << static_cast<int>(folded);
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// 网络输出一行（CV_32F）中得分最高的类别及其概率。模型末层已是 softmax（非负且和为 1）时直接取最大值，
+// 否则把输出视为 logits 做 softmax，使置信度与级联第一级、分类缓存阈值同为 0~1 的类别概率
+double classProbability(const cv::Mat &row, int &classId)
+{
+    double minValue = 0.0, maxValue = 0.0;
+    cv::Point maxPoint;
+    cv::minMaxLoc(row, &minValue, &maxValue, nullptr, &maxPoint);
+    classId = maxPoint.x;
+    if (minValue >= 0.0 && std::abs(cv::sum(row)[0] - 1.0) < 1e-3)
+        return maxValue;
+
+    const float *values = row.ptr<float>();
+    double denominator = 0.0;
+    for (int c = 0; c < row.cols; c++)
+        denominator += std::exp(values[c] - maxValue);
+    return 1.0 / denominator;
+}
 } // namespace
 
+// 推理上下文池：空闲上下文存放在 idle 中，借出期间由调用线程独占
+struct ArmorMatcher::ContextPool
+{
+    std::unique_ptr<InferenceBackend> backend; // 只读的模型定义
+    int capacity = 1;
+
+    std::mutex mutex;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<InferenceSession>> idle;
+    int created = 0;
+
+    // 借出一个上下文：有空闲的直接取用，未达上限时新建，否则等待归还
+    std::unique_ptr<InferenceSession> acquire(std::string &error)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this] { return !idle.empty() || created < capacity; });
+        if (!idle.empty())
+        {
+            std::unique_ptr<InferenceSession> session = std::move(idle.back());
+            idle.pop_back();
+            return session;
+        }
+        created++;
+        lock.unlock();
+
+        // 解析模型较慢，在锁外进行
+        std::string reason;
+        if (std::unique_ptr<InferenceSession> session = backend->createSession(reason))
+            return session;
+        error = "创建推理上下文失败: " + reason;
+        lock.lock();
+        created--;
+        available.notify_one();
+        return nullptr;
+    }
+
+    void release(std::unique_ptr<InferenceSession> session)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(std::move(session));
+        }
+        available.notify_one();
+    }
+};
+
 bool ArmorMatcher::load(const std::string &modelPath, int inputWidth, int inputHeight)
 {
+    const auto loadBegin = std::chrono::steady_clock::now();
     ready_ = false;
     labels_.clear();
     lastError_.clear();
+    loadStats_ = LoadStats();
+    pool_.reset();
+    inputChannels_ = 3;
+    fixedBatch_ = 0;
     modelPath_ = modelPath;
-    // 强制使用 224x224
-    inputWidth_ = 224;
-    inputHeight_ = 224;
-    try
+    inputWidth_ = inputWidth > 0 ? inputWidth : kDefaultInputWidth;
+    inputHeight_ = inputHeight > 0 ? inputHeight : kDefaultInputHeight;
+
+    std::ifstream ifs(modelPath, std::ios::binary);
+    if (!ifs.is_open())
     {
-        net_ = cv::dnn::readNetFromONNX(modelPath);
-        net_.setPreferableBackend(cv::dnn::DNN_BACKEND_DEFAULT);
-        net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        lastError_ = std::string("无法打开模型文件: ") + modelPath;
+        return false;
     }
-    catch (const cv::Exception &e)
+    std::vector<uchar> model((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    // 输入几何以模型声明的 NCHW 形状为准，动态维度使用调用方给出的尺寸；形状无法读取时交给后端解析报错
+    std::string error;
+    std::vector<int64_t> shape;
+    if (readOnnxInputShape(model, shape, error) && shape.size() == 4)
     {
-        lastError_ = std::string("加载 ONNX 模型失败: ") + e.what();
-        return false;
+        if (shape[1] > 0 && shape[1] != 3)
+        {
+            lastError_ = "模型输入应为三通道，实际为 " + std::to_string(shape[1]) + " 通道: " + modelPath;
+            return false;
+        }
+        fixedBatch_ = static_cast<int>(std::max<int64_t>(shape[0], 0));
+        if (shape[2] > 0)
+            inputHeight_ = static_cast<int>(shape[2]);
+        if (shape[3] > 0)
+            inputWidth_ = static_cast<int>(shape[3]);
+    }
+
+    BackendOptions options = backendOptions_;
+    options.foldInputChannels = false;
+    options.cacheFile.clear();
+    std::copy(std::begin(kMean), std::end(kMean), options.foldMean.begin());
+    std::copy(std::begin(kStd), std::end(kStd), options.foldStd.begin());
+
+    // 模型缓存：文件名以模型内容哈希开头，模型更新后自动失效
+    const bool tryFold = backendOptions_.foldInputChannels && options.type == BackendType::OpenCvDnn;
+    std::string foldCachePath;
+    if (!cacheDir_.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(cacheDir_, ec);
+        const uint64_t hash = modelHash(model);
+        if (options.type == BackendType::OnnxRuntime)
+            options.cacheFile = (std::filesystem::path(cacheDir_) / cacheFileName(hash, "onnxruntime.ort")).string();
+        if (tryFold)
+            foldCachePath = (std::filesystem::path(cacheDir_) / cacheFileName(hash, "opencv-fold.yml")).string();
+    }
+    const int foldDecision = foldCachePath.empty() ? -1 : readFoldDecision(foldCachePath);
+
+    // INT8 静态量化的校准输入：按 match 的预处理转换校准图像
+    std::vector<cv::Mat> calibration;
+    if (options.type == BackendType::OpenCvInt8)
+    {
+        cv::Mat plane;
+        for (const cv::Mat &image : calibrationImages_)
+        {
+            if (!imageToPlane(image, inputWidth_, inputHeight_, plane, error))
+                continue;
+            calibration.emplace_back();
+            planeToBlob(plane, calibration.back(), 3);
+        }
     }
 
+    std::unique_ptr<InferenceBackend> backend;
+    std::unique_ptr<InferenceSession> session;
+    if (foldDecision == 1)
+    {
+        // 上次比对已通过，直接创建折叠后的网络；失败时按无缓存处理
+        BackendOptions foldedOptions = options;
+        foldedOptions.foldInputChannels = true;
+        backend = createInferenceBackend(model, foldedOptions, calibration, error);
+        session = backend ? backend->createSession(error) : nullptr;
+        loadStats_.cacheHit = session != nullptr;
+    }
+
+    if (!session)
+    {
+        // 先创建一个上下文以校验模型，放入池中供第一个调用者使用
+        backend = createInferenceBackend(model, options, calibration, error);
+        session = backend ? backend->createSession(error) : nullptr;
+        if (!session)
+        {
+            lastError_ = std::string("加载 ONNX 模型失败 (") + backendName(options.type) + "): " + error;
+            return false;
+        }
+
+        // 折叠只适用于 OpenCV DNN 浮点后端；失败不影响使用，仍以三通道输入推理
+        if (tryFold && foldDecision == 0)
+        {
+            loadStats_.cacheHit = true;
+        }
+        else if (tryFold)
+        {
+            options.foldInputChannels = true;
+            std::unique_ptr<InferenceBackend> folded = createInferenceBackend(model, options, calibration, error);
+            std::unique_ptr<InferenceSession> foldedSession = folded ? folded->createSession(error) : nullptr;
+            const bool accepted =
+                foldedSession && verifyFoldedSession(*session, *foldedSession, inputHeight_, inputWidth_);
+            if (accepted)
+            {
+                backend = std::move(folded);
+                session = std::move(foldedSession);
+            }
+            if (!foldCachePath.empty())
+                writeFoldDecision(foldCachePath, accepted);
+        }
+    }
+    if (backendOptions_.foldInputChannels && backend->inputChannels() != 1)
+        lastError_ = "输入通道折叠不适用于该模型或后端，保持三通道输入";
+    loadStats_.cacheHit = loadStats_.cacheHit || backend->loadedFromCache();
+    loadStats_.loadMs = elapsedMs(loadBegin);
+
+    auto pool = std::make_shared<ContextPool>();
+    pool->capacity = maxContexts_ > 0 ? maxContexts_ : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    inputChannels_ = backend->inputChannels();
+
+    // 预先创建并预热上下文，把一次性初始化移出实时帧；预热失败不影响加载，推理时会再次报告错误
+    const auto warmupBegin = std::chrono::steady_clock::now();
+    pool->idle.push_back(std::move(session));
+    const size_t contexts = static_cast<size_t>(std::min(pool->capacity, std::max(1, warmupContexts_)));
+    while (pool->idle.size() < contexts)
+    {
+        std::unique_ptr<InferenceSession> extra = backend->createSession(error);
+        if (!extra)
+            break;
+        pool->idle.push_back(std::move(extra));
+    }
+    // 批大小固定的模型只预热该批大小
+    std::vector<int> warmupBatchSizes;
+    for (int batchSize : warmupBatchSizes_)
+    {
+        if (fixedBatch_ == 0 || batchSize == fixedBatch_)
+            warmupBatchSizes.push_back(batchSize);
+    }
+    for (std::unique_ptr<InferenceSession> &context : pool->idle)
+    {
+        if (!warmUp(*context, warmupBatchSizes, inputChannels_, inputHeight_, inputWidth_, error))
+        {
+            lastError_ = "预热推理失败: " + error;
+            break;
+        }
+    }
+    pool->created = static_cast<int>(pool->idle.size());
+    pool->backend = std::move(backend);
+    loadStats_.warmupMs = elapsedMs(warmupBegin);
+
+    pool_ = std::move(pool);
     ready_ = true;
     return true;
 }
 
+int ArmorMatcher::contextCount() const
+{
+    if (!pool_)
+        return 0;
+    std::lock_guard<std::mutex> lock(pool_->mutex);
+    return pool_->created;
+}
+
 bool ArmorMatcher::loadWithLabels(const std::string &modelPath, const std::string &labelsPath, int inputWidth,
                                   int inputHeight)
 {
@@ -73,113 +476,261 @@ MatchResult ArmorMatcher::match(const cv::Mat &image) const
     if (!ready_)
     {
         result.error = "模型尚未加载";
-        lastError_ = result.error;
         return result;
     }
 
-    if (image.empty())
-    {
-        result.error = "输入图像为空";
-        lastError_ = result.error;
+    cv::Mat blob;
+    if (!prepareImage(image, blob, &result.error))
         return result;
+    return matchBlob(blob);
+}
+
+bool ArmorMatcher::prepareImage(const cv::Mat &image, cv::Mat &blob, std::string *error) const
+{
+    cv::Mat plane;
+    std::string reason;
+    if (!imageToPlane(image, inputWidth_, inputHeight_, plane, reason))
+    {
+        if (error)
+            *error = reason;
+        return false;
     }
+    // 缩放后边缘处存在中间灰度，查找表覆盖全部 256 个取值
+    planeToBlob(plane, blob, inputChannels_);
+    return true;
+}
 
-    // 先将输入转换为灰度并二值化（阈值 100），然后再转换为三通道用于网络
-    cv::Mat gray;
-    if (image.channels() == 1)
+bool ArmorMatcher::prepareInput(const cv::Mat &frame, const std::array<cv::Point2f, 4> &quad, cv::Mat &blob,
+                                cv::Mat &frontView) const
+{
+    if (frame.empty() || frame.type() != CV_8UC3)
+        return false;
+
+    // 四角点必须在图像内，且构成面积足够的凸四边形
+    for (const cv::Point2f &pt : quad)
     {
-        gray = image.clone();
+        if (pt.x < 0 || pt.x >= frame.cols || pt.y < 0 || pt.y >= frame.rows)
+            return false;
     }
-    else if (image.channels() == 3)
+    // 直接引用四角点，不拷贝
+    cv::Mat contour(4, 1, CV_32FC2, const_cast<cv::Point2f *>(quad.data()));
+    if (cv::contourArea(contour) < 100.0 || !cv::isContourConvex(contour))
+        return false;
+
+    // 四边形 -> 224x224 正面视图
+    const float last = static_cast<float>(kFrontViewSize - 1);
+    cv::Point2f dst[4] = {{0, 0}, {last, 0}, {last, last}, {0, last}};
+    cv::Matx33d toFrontView = cv::getPerspectiveTransform(quad.data(), dst);
+
+    // 正面视图 -> 网络输入：两侧裁剪、宽高缩放（按 INTER_LINEAR 的像素中心对齐）与居中裁剪合成一个仿射变换，
+    // 输出直接是网络输入尺寸
+    const int cropWidth = kFrontViewSize - 2 * kFrontViewSideCrop;
+    const int resizedWidth = preCropWidth(inputWidth_);
+    const double sx = static_cast<double>(resizedWidth) / cropWidth;
+    const double sy = static_cast<double>(inputHeight_) / kFrontViewSize;
+    const double offsetX = (resizedWidth - inputWidth_) / 2;
+    cv::Matx33d toInput(sx, 0, (0.5 - kFrontViewSideCrop) * sx - 0.5 - offsetX, //
+                        0, sy, 0.5 * sy - 0.5,                                  //
+                        0, 0, 1);
+
+    cv::warpPerspective(frame, frontView, cv::Mat(toInput * toFrontView), cv::Size(inputWidth_, inputHeight_),
+                        cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+
+    // 二值图只有 0 和 255 两种取值，每个通道只需查找表中的两项
+    const int channels = inputChannels_;
+    float low[3], high[3];
+    for (int c = 0; c < channels; c++)
     {
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        low[c] = inputLut(c, channels).ptr<float>()[0];
+        high[c] = inputLut(c, channels).ptr<float>()[255];
     }
-    else if (image.channels() == 4)
+
+    const int rows = frontView.rows, cols = frontView.cols;
+    int dims[4] = {1, channels, rows, cols};
+    blob.create(4, dims, CV_32F);
+
+    // 每行先求二值掩码，再按通道逐平面选择，内层循环均可向量化
+    thread_local std::vector<uchar> mask;
+    mask.resize(cols);
+    for (int y = 0; y < rows; y++)
     {
-        cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+        // 与 cvtColor(BGR2GRAY) 相同的定点系数
+        const uchar *src = frontView.ptr<uchar>(y);
+        for (int x = 0; x < cols; x++, src += 3)
+        {
+            int gray = (src[0] * 1868 + src[1] * 9617 + src[2] * 4899 + (1 << 13)) >> 14;
+            mask[x] = gray > kBinaryThreshold;
+        }
+        for (int c = 0; c < channels; c++)
+        {
+            float *dst = blob.ptr<float>() + (static_cast<size_t>(c) * rows + y) * cols;
+            const float lo = low[c], hi = high[c];
+            for (int x = 0; x < cols; x++)
+                dst[x] = mask[x] ? hi : lo;
+        }
     }
-    else
+    return true;
+}
+
+MatchResult ArmorMatcher::matchBlob(const cv::Mat &blob) const
+{
+    MatchResult result;
+    runBatch(blob, &result);
+    return result;
+}
+
+std::vector<MatchResult> ArmorMatcher::matchBatch(const std::vector<cv::Mat> &blobs) const
+{
+    std::vector<MatchResult> results(blobs.size());
+    if (blobs.empty())
+        return results;
+
+    // 按样本拼接为 NxCxHxW 张量，一次推理
+    const cv::Mat &first = blobs.front();
+    int dims[4] = {static_cast<int>(blobs.size()), first.size[1], first.size[2], first.size[3]};
+    thread_local cv::Mat batch;
+    batch.create(4, dims, CV_32F);
+    const size_t sampleSize = first.total();
+    for (size_t i = 0; i < blobs.size(); i++)
     {
-        result.error = "不支持的通道数: " + std::to_string(image.channels());
-        lastError_ = result.error;
-        return result;
+        if (blobs[i].total() != sampleSize || blobs[i].type() != CV_32F || !blobs[i].isContinuous())
+        {
+            for (MatchResult &result : results)
+                result.error = "批内张量尺寸不一致";
+            return results;
+        }
+        std::copy_n(blobs[i].ptr<float>(), sampleSize, batch.ptr<float>() + i * sampleSize);
     }
+    runBatch(batch, results.data());
+    return results;
+}
 
-    // 先做严格二值化（纯黑白），阈值使用 100
-    cv::Mat bwStrict;
-    cv::threshold(gray, bwStrict, 40, 255, cv::THRESH_BINARY);
-    imshow("Binary Strict", bwStrict);
-    // 将单通道二值图复制为三通道 BGR（每通道相同）
-    cv::Mat bgr;
-
-    cv::cvtColor(bwStrict, bgr, cv::COLOR_GRAY2BGR);
-    cv::Mat resized;
-    cv::resize(bgr, resized, cv::Size(inputWidth_, inputHeight_), cv::INTER_LINEAR);
-    if (resized.cols >= 150)
-    {
-        int targetW = 150;
-        int targetH = resized.rows;
-        int x = (resized.cols - targetW) / 2;
-        int y = 0;
-        cv::Rect roi(x, y, targetW, targetH);
-        resized = resized(roi).clone();
-    }
-
-    // 转为浮点并缩放到 [0,1]
-    resized.convertTo(resized, CV_32F, 1.0f / 255.0f);
-    cv::imshow("Resized", resized);
-    
-    cv::Mat mean = (cv::Mat_<float>(1, 3) << 0.485f, 0.456f, 0.406f);
-    cv::Mat stdv = (cv::Mat_<float>(1, 3) << 0.229f, 0.224f, 0.225f);
-    std::vector<cv::Mat> chans(3);
-    cv::split(resized, chans);
-    for (int i = 0; i < 3; i++)
-        chans[i] = (chans[i] - mean.at<float>(i)) / stdv.at<float>(i);
-    cv::merge(chans, resized);
-    // 生成 1x3xH xW 的 blob（值为 0 或 1）
-    cv::Mat blob = cv::dnn::blobFromImage(resized);
-    
-    cv::Mat out;
-    try
+bool ArmorMatcher::loadFirstStage(const std::string &path)
+{
+    DigitTemplateClassifier stage;
+    if (!stage.load(path, lastError_))
+        return false;
+    firstStage_ = std::move(stage);
+    return true;
+}
+
+std::string ArmorMatcher::labelFor(int classId) const
+{
+    // 如果 labels_ 可用，则映射为标签文本，否则使用索引字符串
+    if (!labels_.empty() && classId >= 0 && classId < (int)labels_.size())
+        return labels_[classId];
+    return std::to_string(classId);
+}
+
+void ArmorMatcher::runBatch(const cv::Mat &batch, MatchResult *results) const
+{
+    const int count = batch.size[0];
+    if (!ready_)
     {
-        net_.setInput(blob);
-        out = net_.forward();
+        for (int i = 0; i < count; i++)
+            results[i].error = "模型尚未加载";
+        return;
     }
-    catch (const cv::Exception &e)
+    if (!cascadeActive())
     {
-        result.error = std::string("推理失败: ") + e.what();
-        lastError_ = result.error;
-        return result;
+        runNetwork(batch, results);
+        return;
     }
 
-    cv::Point classIdPoint;
-    double confidence = 0.0;
-    cv::minMaxLoc(out, nullptr, &confidence, nullptr, &classIdPoint);
-    int classId = classIdPoint.x;
-    // 如果 labels_ 可用，则映射为标签文本，否则使用索引字符串
-    std::string label;
-    if (!labels_.empty() && classId >= 0 && classId < (int)labels_.size())
-        label = labels_[classId];
-    else
-        label = std::to_string(classId);
+    // 级联第一级：margin 足够大的样本直接给出结果，其余样本组成子批次交给网络
+    thread_local cv::Mat feature;
+    thread_local std::vector<int> pending;
+    pending.clear();
+    for (int i = 0; i < count; i++)
+    {
+        if (DigitTemplateClassifier::extractFeature(batch, i, feature))
+        {
+            DigitTemplateClassifier::Prediction prediction = firstStage_.predict(feature);
+            if (firstStage_.accept(prediction))
+            {
+                MatchResult &result = results[i];
+                result.success = true;
+                result.firstStage = true;
+                result.classId = prediction.classId;
+                result.confidence = prediction.probability;
+                result.label = labelFor(prediction.classId);
+                continue;
+            }
+        }
+        pending.push_back(i);
+    }
+    if (pending.empty())
+        return;
+    if (static_cast<int>(pending.size()) == count)
+    {
+        runNetwork(batch, results);
+        return;
+    }
 
-    result.success = true;
-    result.classId = classId;
-    result.confidence = confidence;
-    result.label = label;
-    return result;
+    int dims[4] = {static_cast<int>(pending.size()), batch.size[1], batch.size[2], batch.size[3]};
+    thread_local cv::Mat subBatch;
+    thread_local std::vector<MatchResult> subResults;
+    subBatch.create(4, dims, CV_32F);
+    const size_t sampleSize = batch.total() / count;
+    for (size_t k = 0; k < pending.size(); k++)
+        std::copy_n(batch.ptr<float>() + pending[k] * sampleSize, sampleSize, subBatch.ptr<float>() + k * sampleSize);
+    subResults.assign(pending.size(), MatchResult());
+    runNetwork(subBatch, subResults.data());
+    for (size_t k = 0; k < pending.size(); k++)
+        results[pending[k]] = std::move(subResults[k]);
 }
 
-void setGlobalArmorMatcher(const std::shared_ptr<ArmorMatcher> &matcher)
+void ArmorMatcher::runNetwork(const cv::Mat &batch, MatchResult *results) const
+{
+    const int count = batch.size[0];
+
+    // 推理结果已拷贝出上下文，推理完成后立即归还
+    std::string error;
+    std::unique_ptr<InferenceSession> session = pool_->acquire(error);
+    thread_local cv::Mat output;
+    bool ok = session && session->run(batch, output, error);
+    if (session)
+        pool_->release(std::move(session));
+
+    for (int i = 0; i < count; i++)
+    {
+        MatchResult &result = results[i];
+        if (!ok || output.rows != count)
+        {
+            result.error = ok ? "推理输出与批大小不一致" : error;
+            continue;
+        }
+
+        result.success = true;
+        result.confidence = classProbability(output.row(i), result.classId);
+        result.label = labelFor(result.classId);
+    }
+}
+
+std::shared_ptr<ArmorMatcher> setGlobalArmorMatcher(const std::shared_ptr<ArmorMatcher> &matcher)
 {
     std::lock_guard<std::mutex> lock(g_matcherMutex);
+    std::shared_ptr<ArmorMatcher> previous = std::move(g_matcher);
     g_matcher = matcher;
+    g_matcherGeneration.fetch_add(1, std::memory_order_release);
+    return previous;
 }
 
-std::shared_ptr<ArmorMatcher> getGlobalArmorMatcher()
+std::shared_ptr<ArmorMatcher> getGlobalArmorMatcher(uint64_t *generation)
 {
-    std::lock_guard<std::mutex> lock(g_matcherMutex);
-    return g_matcher;
+    // 线程快照：发布序号未变时直接返回，旧分类器在各线程下一次读取时释放
+    thread_local std::shared_ptr<ArmorMatcher> snapshot;
+    thread_local uint64_t snapshotGeneration = 0;
+    uint64_t current = g_matcherGeneration.load(std::memory_order_acquire);
+    if (current != snapshotGeneration)
+    {
+        std::lock_guard<std::mutex> lock(g_matcherMutex);
+        snapshot = g_matcher;
+        snapshotGeneration = g_matcherGeneration.load(std::memory_order_relaxed);
+    }
+    if (generation)
+        *generation = snapshotGeneration;
+    return snapshot;
 }
 
 } // namespace armor
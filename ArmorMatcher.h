@@ -1,8 +1,10 @@
 #pragma once
 
+#include "digitstage.h"
+#include "inference.h"
+#include <array>
 #include <memory>
 #include <opencv2/core.hpp>
-#include <opencv2/dnn.hpp>
 #include <string>
 #include <vector>
 
@@ -13,34 +15,172 @@ struct MatchResult
 {
     bool success = false;
     int classId = -1;
-    double confidence = 0.0;
+    double confidence = 0.0; // 类别概率（0~1），网络与级联第一级同一量纲
     std::string label;
     std::string error;
+    bool firstStage = false; // 由级联第一级直接给出，未经过网络
 };
 
+/**
+ * @brief 装甲板分类器
+ *
+ * 模型文件只读取一次，由加载时选定的推理后端（见 inference.h）按需为每个并发调用者创建独立的推理上下文，
+ * 上下文数量不超过 maxContexts，用完归还到池中复用。加载完成后 match / matchBlob / prepareInput
+ * 可在任意线程并发调用，推理期间不持有任何锁；推理错误通过 MatchResult::error 按值返回。
+ * load / loadWithLabels 及各 set 方法不可与其它调用并发。
+ */
 class ArmorMatcher
 {
   public:
     ArmorMatcher() = default;
 
+    /**
+     * @brief 设置推理上下文数量上限（线程预算），在下次 load 时生效
+     * @param maxContexts 上限，<= 0 表示使用硬件线程数
+     */
+    void setMaxContexts(int maxContexts) noexcept
+    {
+        maxContexts_ = maxContexts;
+    }
+
+    /**
+     * @brief 选择推理后端（OpenCV DNN / OpenCV INT8 / ONNX Runtime），在下次 load 时生效
+     */
+    void setBackend(const BackendOptions &options)
+    {
+        backendOptions_ = options;
+    }
+
+    const BackendOptions &backendOptions() const noexcept
+    {
+        return backendOptions_;
+    }
+
+    /**
+     * @brief 设置 INT8 静态量化的校准图像（保存的装甲板正面视图，按 match 的预处理转换），在下次 load 时生效
+     */
+    void setCalibrationImages(std::vector<cv::Mat> images)
+    {
+        calibrationImages_ = std::move(images);
+    }
+
+    /**
+     * @brief 加载级联第一级（模板相关分类器，由 tools/cascade_fit 生成），与网络模型独立，可在 load 之前或之后调用
+     *
+     * 加载后 matchBlob / matchBatch 先在 32x32 下采样图上做模板相关，margin 足够大时直接返回结果，
+     * 不确定的样本才交给网络。
+     */
+    bool loadFirstStage(const std::string &path);
+
+    /**
+     * @brief 暂时关闭（或重新打开）已加载的第一级，用于与纯网络结果对比
+     */
+    void setCascadeEnabled(bool enabled) noexcept
+    {
+        cascadeEnabled_ = enabled;
+    }
+
+    bool cascadeActive() const noexcept
+    {
+        return cascadeEnabled_ && !firstStage_.empty();
+    }
+
+    /**
+     * @brief 加载时把网络输入的三个通道折叠进第一层卷积，在下次 load 时生效（仅 OpenCV DNN 浮点后端）
+     *
+     * 网络输入是三通道相同的二值图，归一化参数与三组输入通道权重可以合并为单通道权重和偏置，
+     * 网络改为接收 [0,1] 单通道输入，第一层卷积计算量减为三分之一。第一层卷积带零填充时图像边界处
+     * 与原网络略有差异，load 会用测试输入比对两者输出，差异超出容差或第一层不是卷积时保持三通道输入。
+     */
+    void setFoldInputChannels(bool enabled) noexcept
+    {
+        backendOptions_.foldInputChannels = enabled;
+    }
+
+    /**
+     * @brief 设置加载时的预热推理，在下次 load 时生效
+     *
+     * 第一次推理包含各层的一次性初始化（缓冲区分配、卷积实现选择等），load 用全零输入按各批大小推理一次，
+     * 避免在第一帧中付出这部分延迟。OpenCV DNN 在输入形状改变时重新分配缓冲区，因此第一个批大小
+     * （实时帧使用的形状）最后预热。
+     * @param batchSizes 预热的批大小，为空表示不预热
+     * @param contexts 加载时预先创建并预热的推理上下文数量（不超过上限），通常等于并发分类的线程数
+     */
+    void setWarmup(std::vector<int> batchSizes, int contexts = 1)
+    {
+        warmupBatchSizes_ = std::move(batchSizes);
+        warmupContexts_ = contexts;
+    }
+
+    /**
+     * @brief 设置模型缓存目录，在下次 load 时生效；为空表示不使用缓存
+     *
+     * 缓存以模型内容哈希与后端为键。ONNX Runtime 保存图优化后的 ORT 格式模型，之后启动时跳过 ONNX 解析与图优化；
+     * OpenCV DNN 不能序列化网络，只记录输入通道折叠的比对结果，之后启动时不再重复比对。
+     */
+    void setModelCacheDir(const std::string &dir)
+    {
+        cacheDir_ = dir;
+    }
+
+    struct LoadStats
+    {
+        double loadMs = 0.0;   ///< 读取模型、创建后端与第一个上下文的耗时
+        double warmupMs = 0.0; ///< 预热推理（含预先创建的上下文）的耗时
+        bool cacheHit = false; ///< 是否使用了模型缓存
+    };
+
+    /**
+     * @brief 最近一次 load 的耗时统计
+     */
+    const LoadStats &loadStats() const noexcept
+    {
+        return loadStats_;
+    }
+
+    /**
+     * @brief 网络输入宽高（未加载模型时为默认的 150x224），也是 prepareInput 输出正面视图的尺寸
+     */
+    int inputWidth() const noexcept
+    {
+        return inputWidth_;
+    }
+
+    int inputHeight() const noexcept
+    {
+        return inputHeight_;
+    }
+
+    /**
+     * @brief 网络输入通道数：3，或折叠生效后为 1
+     */
+    int inputChannels() const noexcept
+    {
+        return inputChannels_;
+    }
+
     /**
      * @brief 加载 ONNX 模型
+     *
+     * 网络输入尺寸取自模型声明的 NCHW 输入形状，prepareInput / prepareImage 直接生成该尺寸的张量；
+     * 输入必须为三通道。
      * @param modelPath 模型文件路径
-     * @param inputSize 网络输入尺寸，固定为 224x224
+     * @param inputWidth 模型输入宽度为动态维度时使用的宽度，<= 0 表示默认 150
+     * @param inputHeight 模型输入高度为动态维度时使用的高度，<= 0 表示默认 224
      * @return 是否加载成功
      */
-    bool load(const std::string &modelPath, int inputWidth = 224, int inputHeight = 224);
+    bool load(const std::string &modelPath, int inputWidth = 0, int inputHeight = 0);
 
     /**
      * @brief 加载 ONNX 模型并同时从 labels 文件加载标签（可选）
      * @param modelPath 模型文件路径
      * @param labelsPath 每行一个标签的文本文件路径（如果不存在则忽略）
-     * @param inputWidth 网络输入宽度，默认224
-     * @param inputHeight 网络输入高度，默认224
+     * @param inputWidth 模型输入宽度为动态维度时使用的宽度，<= 0 表示默认 150
+     * @param inputHeight 模型输入高度为动态维度时使用的高度，<= 0 表示默认 224
      * @return 是否加载成功（模型加载失败则返回 false；labels 无法打开不会使得方法失败，但会记录 lastError）
      */
-    bool loadWithLabels(const std::string &modelPath, const std::string &labelsPath, int inputWidth = 224,
-                        int inputHeight = 224);
+    bool loadWithLabels(const std::string &modelPath, const std::string &labelsPath, int inputWidth = 0,
+                        int inputHeight = 0);
 
     /**
      * @brief 匹配装甲板图像，返回分类结果
@@ -48,6 +188,36 @@ class ArmorMatcher
      */
     MatchResult match(const cv::Mat &image) const;
 
+    /**
+     * @brief 按 match 的预处理由正面视图图像生成网络输入张量
+     * @param error 可选，失败时写入原因
+     */
+    bool prepareImage(const cv::Mat &image, cv::Mat &blob, std::string *error = nullptr) const;
+
+    /**
+     * @brief 由原图与装甲板四角点直接生成网络输入张量
+     *
+     * 正面视图两侧裁剪与网络输入的中心裁剪合并进同一个透视变换矩阵，一次 warpPerspective
+     * 直接输出网络输入分辨率的图像，随后逐行完成灰度与二值化，按两项查找表写入归一化后的 NCHW 张量。
+     * @param frame 原始 BGR 图像
+     * @param quad 装甲板四角点（左上、右上、右下、左下），与 PnP 使用的角点相同
+     * @param blob 输出 1xCxHxW 浮点张量（C 为 inputChannels()），尺寸不变时复用已有内存
+     * @param frontView 输出与张量同分辨率的 BGR 正面视图，尺寸不变时复用已有内存
+     * @return 四边形非法或超出图像范围时返回 false
+     */
+    bool prepareInput(const cv::Mat &frame, const std::array<cv::Point2f, 4> &quad, cv::Mat &blob,
+                      cv::Mat &frontView) const;
+
+    /**
+     * @brief 对 prepareInput 生成的张量做推理；上下文全部被占用时等待其它线程归还
+     */
+    MatchResult matchBlob(const cv::Mat &blob) const;
+
+    /**
+     * @brief 把多个 1xCxHxW 张量拼成一批做一次推理，结果与输入一一对应
+     */
+    std::vector<MatchResult> matchBatch(const std::vector<cv::Mat> &blobs) const;
+
     /**
      * @brief 判断模型是否已经成功加载
      */
@@ -57,24 +227,57 @@ class ArmorMatcher
     }
 
     /**
-     * @brief 获取最近一次错误信息
+     * @brief 获取最近一次加载时的错误信息（推理错误见 MatchResult::error）
      */
     const std::string &lastError() const noexcept
     {
         return lastError_;
     }
 
+    /**
+     * @brief 已创建的推理上下文数量（即曾经同时推理的最大线程数）
+     */
+    int contextCount() const;
+
   private:
+    struct ContextPool;
+
+    void runBatch(const cv::Mat &batch, MatchResult *results) const;
+    void runNetwork(const cv::Mat &batch, MatchResult *results) const;
+    std::string labelFor(int classId) const;
+
     bool ready_ = false;
-    int inputWidth_ = 224;
+    int inputWidth_ = 150;
     int inputHeight_ = 224;
+    int fixedBatch_ = 0; // 模型声明的固定批大小，0 表示动态
+    int maxContexts_ = 0;
+    int inputChannels_ = 3;
+    BackendOptions backendOptions_;
+    std::vector<cv::Mat> calibrationImages_;
+    std::vector<int> warmupBatchSizes_{1};
+    int warmupContexts_ = 1;
+    std::string cacheDir_;
+    LoadStats loadStats_;
+    DigitTemplateClassifier firstStage_;
+    bool cascadeEnabled_ = true;
     std::vector<std::string> labels_; // 可选：保留但不强制加载
-    mutable std::string lastError_;
+    std::string lastError_;
     std::string modelPath_;
-    mutable cv::dnn::Net net_;
+    std::shared_ptr<ContextPool> pool_; // 共享的模型数据与空闲推理上下文
 };
 
-void setGlobalArmorMatcher(const std::shared_ptr<ArmorMatcher> &matcher);
-std::shared_ptr<ArmorMatcher> getGlobalArmorMatcher();
+/**
+ * @brief 发布全局分类器，返回被替换的分类器
+ *
+ * 发布只在写入方加锁；读取方各线程缓存一份快照，仅在发布后第一次读取时加锁刷新。
+ * 已取得旧快照的调用者继续在旧分类器上完成当前帧。
+ */
+std::shared_ptr<ArmorMatcher> setGlobalArmorMatcher(const std::shared_ptr<ArmorMatcher> &matcher);
+
+/**
+ * @brief 读取全局分类器：通常只有一次原子读取与引用计数加一，不加锁
+ * @param generation 可选，输出发布序号，每次 setGlobalArmorMatcher 加一，用于判断分类器是否已更换
+ */
+std::shared_ptr<ArmorMatcher> getGlobalArmorMatcher(uint64_t *generation = nullptr);
 
 } // namespace armor
@@ -2,6 +2,8 @@
 #define HIK_CAMERA_H
 
 #include "MvCameraControl.h"
+#include <cstdint>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -25,8 +27,18 @@ struct ImageData
     unsigned int height;
     unsigned int pixelFormat;
     unsigned int dataSize;
-
-    ImageData() : data(nullptr), width(0), height(0), pixelFormat(0), dataSize(0)
+    // 图像相对传感器全分辨率的比例（1 / (binning * decimation)），按全分辨率标定的内参需乘以该比例
+    float scaleX;
+    float scaleY;
+    unsigned int frameNumber;
+    // 曝光时刻的设备时间戳（GigE 为 GevTimestampTickFrequency 计数，USB3 为纳秒），0 表示相机未提供
+    uint64_t deviceTimestamp;
+    // SDK 交付该帧的主机时刻（steady_clock 纳秒）
+    int64_t hostTimestamp;
+
+    ImageData()
+        : data(nullptr), width(0), height(0), pixelFormat(0), dataSize(0), scaleX(1.0f), scaleY(1.0f), frameNumber(0),
+          deviceTimestamp(0), hostTimestamp(0)
     {
     }
 };
@@ -62,6 +74,14 @@ class HikCamera
     // 获取一帧图像并转换为BGR格式
     bool GrabImageBGR(ImageData &imageData, unsigned int timeout = 1000);
 
+    // 获取一帧原始图像并拷贝到调用方缓冲区（容量不足时扩容），SDK 缓冲区立即归还
+    // 适用于采集与格式转换分别在不同线程执行的流水线
+    bool GrabImageInto(ImageData &imageData, std::vector<unsigned char> &buffer, unsigned int timeout = 1000);
+
+    // 将 GrabImageInto 得到的原始图像转换为 BGR，写入调用方缓冲区（dstSize >= width * height * 3）
+    // 可与 GrabImageInto 在不同线程并发调用
+    bool ConvertToBGR(const ImageData &src, unsigned char *dst, unsigned int dstSize);
+
     // 设置曝光时间 (微秒)
     bool SetExposureTime(float exposureTime);
 
@@ -98,6 +118,29 @@ class HikCamera
     // 获取图像高度
     unsigned int GetHeight();
 
+    // 设置传感器像素合并（BinningHorizontal/BinningVertical），常见取值 1/2/4
+    // 输出尺寸相关参数在采集中被锁定，正在采集时会自动停止采集、设置后再恢复
+    bool SetBinning(unsigned int horizontal, unsigned int vertical);
+    bool GetBinning(unsigned int &horizontal, unsigned int &vertical);
+
+    // 设置传感器抽样（DecimationHorizontal/DecimationVertical），行为同 SetBinning
+    bool SetDecimation(unsigned int horizontal, unsigned int vertical);
+    bool GetDecimation(unsigned int &horizontal, unsigned int &vertical);
+
+    // 查询水平方向支持的 Binning / Decimation 取值（不支持时返回空）
+    std::vector<unsigned int> GetSupportedBinning();
+    std::vector<unsigned int> GetSupportedDecimation();
+
+    // 当前输出图像相对传感器全分辨率的比例，同时写入每帧 ImageData::scaleX/scaleY
+    float GetResolutionScaleX() const
+    {
+        return m_scaleX;
+    }
+    float GetResolutionScaleY() const
+    {
+        return m_scaleY;
+    }
+
     // 传输层参数（可用于调优带宽）
     bool SetPacketSize(unsigned int packetSize);
     unsigned int GetPacketSize();
@@ -111,6 +154,13 @@ class HikCamera
     // 获取相机当前 PayloadSize（帧数据大小）
     unsigned int GetPayloadSize();
 
+    // 设备时间戳频率（GevTimestampTickFrequency，Hz），相机不提供该节点时返回 0（USB3 相机时间戳一般为纳秒）
+    double GetTimestampFrequency();
+
+    // 锁存并读取设备当前时间戳（GevTimestampControlLatch + GevTimestampValue）
+    // hostBefore/hostAfter 为锁存命令前、读取后的主机时刻（steady_clock 纳秒），用于设备时钟映射
+    bool LatchDeviceTimestamp(uint64_t &ticks, int64_t &hostBefore, int64_t &hostAfter);
+
     // 打印/查询相机支持的像素格式及帧率范围（调试用）
     void PrintCameraCapabilities();
 
@@ -145,6 +195,7 @@ class HikCamera
     std::string m_lastError;        // 最后的错误信息
     unsigned char *m_convertBuffer; // 图像转换缓冲区
     unsigned int m_bufferSize;      // 缓冲区大小
+    std::mutex m_convertMutex;      // 串行化 ConvertToBGR 中的 SDK 转换调用，并保护 Open/Close 对句柄的发布与销毁
 
     // 用于断线重连时恢复状态的缓存值
     unsigned int m_deviceIndex;      // 当前设备索引
@@ -153,10 +204,26 @@ class HikCamera
     bool m_savedTrigger;             // 最近设置的触发模式
     float m_savedFrameRate;          // 最近设置的帧率 (fps)
     unsigned int m_savedPixelFormat; // 最近设置的像素格式
+    unsigned int m_savedBinningH;    // 最近设置的 Binning（0 表示未设置）
+    unsigned int m_savedBinningV;
+    unsigned int m_savedDecimationH; // 最近设置的 Decimation（0 表示未设置）
+    unsigned int m_savedDecimationV;
+
+    // 当前输出相对传感器全分辨率的比例，打开相机及修改 Binning/Decimation 后刷新
+    float m_scaleX;
+    float m_scaleY;
 
     // 设置错误信息
     void SetError(const std::string &error, int errorCode);
 
+    // Binning/Decimation 节点读写：海康相机多为枚举节点，部分型号为整数节点
+    bool SetSamplingNode(const char *node, unsigned int factor);
+    unsigned int GetSamplingNode(const char *node);
+    std::vector<unsigned int> GetSamplingSupport(const char *node);
+    bool SetSamplingPair(const char *horizontalNode, const char *verticalNode, unsigned int horizontal,
+                         unsigned int vertical);
+    void RefreshResolutionScale();
+
     // 禁止拷贝
     HikCamera(const HikCamera &) = delete;
     HikCamera &operator=(const HikCamera &) = delete;
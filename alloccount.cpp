@@ -0,0 +1,448 @@
+#include "alloccount.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+
+namespace alloccount
+{
+
+namespace
+{
+constexpr int kStageCount = static_cast<int>(frametiming::Stage::Count);
+constexpr int kSlots = kStageCount + 1; // 0 为未标记，stage s 为 s + 1
+constexpr int kSiteSlots = 512;         // 调用点表容量，满了之后的新调用点只计入 droppedSites
+constexpr int kSiteDepth = 12;
+
+// 只由所属线程访问；平凡类型、零初始化，分配函数在线程启动早期被调用时也无需构造
+struct ThreadState
+{
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytes;
+    int stage;        // 当前归属的槽位
+    bool inHook;      // 正在采集调用栈，期间的分配不再采集
+    bool faultsValid; // minor / major 已有上一次边界的读数
+    uint64_t minor;
+    uint64_t major;
+};
+
+thread_local ThreadState tState __attribute__((tls_model("initial-exec")));
+
+// 全部为常量初始化，可在静态构造之前使用
+std::atomic<uint64_t> gAllocations{0};
+std::atomic<uint64_t> gFrees{0};
+std::atomic<uint64_t> gBytes{0};
+std::atomic<uint64_t> gStageAllocations[kSlots];
+std::atomic<uint64_t> gStageBytes[kSlots];
+std::atomic<uint64_t> gStageMinor[kSlots];
+std::atomic<uint64_t> gStageMajor[kSlots];
+
+struct SiteSlot
+{
+    uint64_t hash;
+    uint64_t allocations;
+    uint64_t bytes;
+    int depth;
+    void *frames[kSiteDepth];
+};
+
+std::atomic<bool> gCaptureSites{false};
+std::atomic_flag gSitesLock = ATOMIC_FLAG_INIT;
+SiteSlot gSites[kSiteSlots];
+uint64_t gDroppedSites = 0;
+
+class SpinLock
+{
+  public:
+    SpinLock()
+    {
+        while (gSitesLock.test_and_set(std::memory_order_acquire))
+        {
+        }
+    }
+    ~SpinLock()
+    {
+        gSitesLock.clear(std::memory_order_release);
+    }
+};
+
+// 采集或解析调用栈期间当前线程的分配不再采集（backtrace / backtrace_symbols 自身也会分配）
+class HookGuard
+{
+  public:
+    HookGuard() : previous_(tState.inHook)
+    {
+        tState.inHook = true;
+    }
+    ~HookGuard()
+    {
+        tState.inHook = previous_;
+    }
+
+  private:
+    bool previous_;
+};
+
+#if defined(HIKO_ALLOC_COUNT) && defined(__GLIBC__)
+void recordSite(size_t size)
+{
+    HookGuard guard;
+    void *frames[kSiteDepth];
+    int depth = backtrace(frames, kSiteDepth);
+    uint64_t hash = 1469598103934665603ull; // FNV-1a
+    for (int i = 0; i < depth; i++)
+    {
+        hash ^= reinterpret_cast<uintptr_t>(frames[i]);
+        hash *= 1099511628211ull;
+    }
+    hash |= 1; // 0 表示空槽
+
+    SpinLock lock;
+    for (int probe = 0; probe < kSiteSlots; probe++)
+    {
+        SiteSlot &slot = gSites[(hash + probe) % kSiteSlots];
+        if (slot.hash == 0)
+        {
+            slot.hash = hash;
+            slot.depth = depth;
+            std::memcpy(slot.frames, frames, sizeof(void *) * depth);
+        }
+        if (slot.hash == hash)
+        {
+            slot.allocations++;
+            slot.bytes += size;
+            return;
+        }
+    }
+    gDroppedSites++;
+}
+
+void onAllocate(size_t size) noexcept
+{
+    ThreadState &t = tState;
+    t.allocations++;
+    t.bytes += size;
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    gBytes.fetch_add(size, std::memory_order_relaxed);
+    gStageAllocations[t.stage].fetch_add(1, std::memory_order_relaxed);
+    gStageBytes[t.stage].fetch_add(size, std::memory_order_relaxed);
+    if (gCaptureSites.load(std::memory_order_relaxed) && !t.inHook)
+        recordSite(size);
+}
+
+void onFree() noexcept
+{
+    tState.frees++;
+    gFrees.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+// 阶段边界：把上一次边界以来当前线程的缺页计入当前槽位
+void accountFaults(ThreadState &t) noexcept
+{
+    rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0)
+        return;
+    const uint64_t minor = static_cast<uint64_t>(usage.ru_minflt), major = static_cast<uint64_t>(usage.ru_majflt);
+    if (t.faultsValid)
+    {
+        gStageMinor[t.stage].fetch_add(minor - t.minor, std::memory_order_relaxed);
+        gStageMajor[t.stage].fetch_add(major - t.major, std::memory_order_relaxed);
+    }
+    t.minor = minor;
+    t.major = major;
+    t.faultsValid = true;
+}
+
+// "binary(mangled+0x1f) [0x...]" -> "demangled+0x1f (binary)"
+std::string demangleFrame(const char *symbol)
+{
+    std::string text(symbol);
+    const size_t open = text.find('('), plus = text.find('+', open), close = text.find(')', open);
+    if (open == std::string::npos || close == std::string::npos || plus == std::string::npos || plus > close ||
+        plus == open + 1)
+        return text;
+    const std::string mangled = text.substr(open + 1, plus - open - 1);
+    const size_t slash = text.rfind('/', open);
+    const size_t begin = slash == std::string::npos ? 0 : slash + 1;
+    const std::string binary = text.substr(begin, open - begin);
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+    std::string name = status == 0 && demangled ? demangled : mangled;
+    std::free(demangled);
+    return name + text.substr(plus, close - plus) + " (" + binary + ")";
+}
+
+// 本模块替换的分配函数
+bool isHookFrame(const std::string &frame)
+{
+    static const char *const kHooks[] = {"malloc+", "calloc+", "realloc+", "posix_memalign+", "aligned_alloc+",
+                                         "memalign+"};
+    for (const char *hook : kHooks)
+    {
+        if (frame.compare(0, std::strlen(hook), hook) == 0)
+            return true;
+    }
+    return false;
+}
+} // namespace
+
+Counters operator-(const Counters &now, const Counters &before)
+{
+    Counters d;
+    d.allocations = now.allocations - before.allocations;
+    d.frees = now.frees - before.frees;
+    d.bytes = now.bytes - before.bytes;
+    d.minorFaults = now.minorFaults - before.minorFaults;
+    d.majorFaults = now.majorFaults - before.majorFaults;
+    return d;
+}
+
+bool compiled() noexcept
+{
+#if defined(HIKO_ALLOC_COUNT) && defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+Counters threadCounters() noexcept
+{
+    Counters c;
+    c.allocations = tState.allocations;
+    c.frees = tState.frees;
+    c.bytes = tState.bytes;
+    rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) == 0)
+    {
+        c.minorFaults = static_cast<uint64_t>(usage.ru_minflt);
+        c.majorFaults = static_cast<uint64_t>(usage.ru_majflt);
+    }
+    return c;
+}
+
+Counters processCounters() noexcept
+{
+    Counters c;
+    c.allocations = gAllocations.load(std::memory_order_relaxed);
+    c.frees = gFrees.load(std::memory_order_relaxed);
+    c.bytes = gBytes.load(std::memory_order_relaxed);
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        c.minorFaults = static_cast<uint64_t>(usage.ru_minflt);
+        c.majorFaults = static_cast<uint64_t>(usage.ru_majflt);
+    }
+    return c;
+}
+
+StageScope::StageScope(frametiming::Stage stage) noexcept : previous_(tState.stage)
+{
+    accountFaults(tState);
+    tState.stage = static_cast<int>(stage) + 1;
+}
+
+StageScope::~StageScope()
+{
+    accountFaults(tState);
+    tState.stage = previous_;
+}
+
+Reporter::Reporter() : last_(kSlots)
+{
+}
+
+std::vector<StageCounters> Reporter::take()
+{
+    std::vector<StageCounters> stages;
+    stages.reserve(kSlots);
+    for (int slot = 0; slot < kSlots; slot++)
+    {
+        Counters now;
+        now.allocations = gStageAllocations[slot].load(std::memory_order_relaxed);
+        now.bytes = gStageBytes[slot].load(std::memory_order_relaxed);
+        now.minorFaults = gStageMinor[slot].load(std::memory_order_relaxed);
+        now.majorFaults = gStageMajor[slot].load(std::memory_order_relaxed);
+        StageCounters s;
+        s.tagged = slot > 0;
+        s.stage = s.tagged ? static_cast<frametiming::Stage>(slot - 1) : frametiming::Stage::Count;
+        s.counters = now - last_[slot];
+        last_[slot] = now;
+        stages.push_back(s);
+    }
+    return stages;
+}
+
+std::string Reporter::format(const std::vector<StageCounters> &stages, uint64_t frames)
+{
+    const double n = frames > 0 ? static_cast<double>(frames) : 1.0;
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    for (const StageCounters &s : stages)
+    {
+        const Counters &c = s.counters;
+        if (c.allocations == 0 && c.minorFaults == 0 && c.majorFaults == 0)
+            continue;
+        oss << "  " << std::left << std::setw(10) << (s.tagged ? frametiming::stageName(s.stage) : "other")
+            << std::right << " | alloc/帧 " << std::setw(8) << c.allocations / n << " | KB/帧 " << std::setw(9)
+            << c.bytes / n / 1024.0 << " | 缺页/帧 minor " << std::setw(7) << c.minorFaults / n << " major "
+            << std::setw(5) << c.majorFaults / n << "\n";
+    }
+    if (oss.tellp() == 0)
+        oss << "  (无分配与缺页)\n";
+    return oss.str();
+}
+
+void setSiteCapture(bool enabled)
+{
+    if (enabled)
+    {
+        // backtrace 第一次调用时加载 libgcc_s，在采集开始前完成
+        void *frames[2];
+        HookGuard guard;
+        backtrace(frames, 2);
+    }
+    gCaptureSites.store(enabled, std::memory_order_relaxed);
+}
+
+std::vector<Site> takeSites(size_t maxSites)
+{
+    HookGuard guard;
+    std::vector<SiteSlot> slots;
+    uint64_t dropped = 0;
+    {
+        SpinLock lock;
+        for (SiteSlot &slot : gSites)
+        {
+            if (slot.hash != 0)
+                slots.push_back(slot);
+            slot = SiteSlot();
+        }
+        dropped = gDroppedSites;
+        gDroppedSites = 0;
+    }
+    std::sort(slots.begin(), slots.end(),
+              [](const SiteSlot &a, const SiteSlot &b) { return a.allocations > b.allocations; });
+    if (slots.size() > maxSites)
+        slots.resize(maxSites);
+
+    std::vector<Site> sites;
+    for (const SiteSlot &slot : slots)
+    {
+        Site site;
+        site.allocations = slot.allocations;
+        site.bytes = slot.bytes;
+        char **symbols = backtrace_symbols(slot.frames, slot.depth);
+        if (symbols)
+        {
+            std::vector<std::string> frames;
+            for (int i = 0; i < slot.depth; i++)
+                frames.push_back(demangleFrame(symbols[i]));
+            std::free(symbols);
+            // 跳过本模块（静态函数没有符号名）与分配函数自身，从分配函数的调用者开始
+            size_t start = 0;
+            for (size_t i = 0; i < frames.size() && i < 4; i++)
+            {
+                if (isHookFrame(frames[i]))
+                    start = i + 1;
+            }
+            site.frames.assign(frames.begin() + start, frames.end());
+        }
+        sites.push_back(std::move(site));
+    }
+    if (dropped > 0)
+    {
+        Site overflow;
+        overflow.allocations = dropped;
+        overflow.frames.push_back("(调用点表已满，未记录的分配)");
+        sites.push_back(std::move(overflow));
+    }
+    return sites;
+}
+
+std::string formatSites(const std::vector<Site> &sites, size_t depth)
+{
+    std::ostringstream oss;
+    for (const Site &site : sites)
+    {
+        oss << "  " << site.allocations << " 次, " << site.bytes << " 字节\n";
+        for (size_t i = 0; i < site.frames.size() && i < depth; i++)
+            oss << "      " << site.frames[i] << "\n";
+    }
+    return oss.str();
+}
+
+} // namespace alloccount
+
+#if defined(HIKO_ALLOC_COUNT) && defined(__GLIBC__)
+// 以同名函数替换 glibc 的分配函数（可执行文件中的定义优先于 libc.so，OpenCV 等共享库的分配也会解析到这里），
+// 计数后转发到 glibc 的实现
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void *ptr);
+
+    void *malloc(size_t size)
+    {
+        alloccount::onAllocate(size);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        alloccount::onAllocate(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        if (size == 0 && ptr)
+            alloccount::onFree();
+        else
+            alloccount::onAllocate(size);
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void *ptr)
+    {
+        if (ptr)
+            alloccount::onFree();
+        __libc_free(ptr);
+    }
+
+    void *memalign(size_t alignment, size_t size)
+    {
+        alloccount::onAllocate(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size)
+    {
+        alloccount::onAllocate(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void **out, size_t alignment, size_t size)
+    {
+        if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+        alloccount::onAllocate(size);
+        void *ptr = __libc_memalign(alignment, size);
+        if (!ptr)
+            return ENOMEM;
+        *out = ptr;
+        return 0;
+    }
+}
+#endif
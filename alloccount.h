@@ -0,0 +1,117 @@
+#pragma once
+
+#include "frametiming.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 堆分配与缺页计数：用于确认处理循环在预热之后每帧不再分配内存。
+// 编译时定义 HIKO_ALLOC_COUNT（CMake 选项 HIKO_ALLOC_COUNT=ON）时，本模块以同名函数替换 glibc 的
+// malloc / calloc / realloc / free / posix_memalign / aligned_alloc / memalign（转发到 __libc_* 实现），
+// operator new 与 OpenCV 的 fastMalloc 都经过它们，C++ 与 C 的分配都被计入。
+// 每次分配计入当前线程的计数，以及当前线程所在阶段（HIKO_ALLOC_STAGE 标记，最内层优先）的计数；
+// 缺页数在阶段边界上由 getrusage(RUSAGE_THREAD) 读取，计入刚结束的那段时间所属的阶段。
+// 开启调用点采集后每次分配额外记录调用栈，找出稳定运行后仍在分配的位置。
+// 未定义 HIKO_ALLOC_COUNT 时不替换分配函数，分配计数始终为 0（缺页仍可读取），HIKO_ALLOC_STAGE 展开为空。
+namespace alloccount
+{
+
+struct Counters
+{
+    uint64_t allocations = 0; // 分配次数（malloc / calloc / realloc / 对齐分配）
+    uint64_t frees = 0;
+    uint64_t bytes = 0;       // 申请的字节数
+    uint64_t minorFaults = 0;
+    uint64_t majorFaults = 0;
+};
+
+// now - before，逐项相减
+Counters operator-(const Counters &now, const Counters &before);
+
+/**
+ * @brief 是否编译了分配函数替换（HIKO_ALLOC_COUNT）；为 false 时分配计数没有意义
+ */
+bool compiled() noexcept;
+
+/**
+ * @brief 当前线程的累计分配计数与缺页数
+ */
+Counters threadCounters() noexcept;
+
+/**
+ * @brief 全部线程的累计分配计数与整个进程的缺页数
+ */
+Counters processCounters() noexcept;
+
+/**
+ * @brief 作用域内当前线程的分配归属 stage；可嵌套，内层作用域的分配不计入外层
+ */
+class StageScope
+{
+  public:
+    explicit StageScope(frametiming::Stage stage) noexcept;
+    ~StageScope();
+
+    StageScope(const StageScope &) = delete;
+    StageScope &operator=(const StageScope &) = delete;
+
+  private:
+    int previous_;
+};
+
+// 单个阶段在一个统计窗口内的计数；tagged 为 false 的一项汇总不在任何阶段内的分配
+struct StageCounters
+{
+    frametiming::Stage stage = frametiming::Stage::Frame;
+    bool tagged = true;
+    Counters counters;
+};
+
+/**
+ * @brief 汇总各阶段计数；每次 take 返回自上次 take 以来的增量（应由单一线程周期性调用）
+ */
+class Reporter
+{
+  public:
+    Reporter();
+
+    std::vector<StageCounters> take();
+
+    // 多行文本，每帧平均值；只包含窗口内有分配或缺页的阶段
+    static std::string format(const std::vector<StageCounters> &stages, uint64_t frames);
+
+  private:
+    std::vector<Counters> last_;
+};
+
+/**
+ * @brief 开启或关闭调用点采集；开启时每次分配记录一次调用栈（明显变慢，只应在预热之后短时间开启）
+ */
+void setSiteCapture(bool enabled);
+
+// 一个分配调用点：调用栈相同的分配合并为一项
+struct Site
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    std::vector<std::string> frames; // 已解析的调用栈，从分配函数的调用者开始
+};
+
+/**
+ * @brief 取出并清空采集到的调用点，按分配次数从多到少排列，最多 maxSites 项
+ */
+std::vector<Site> takeSites(size_t maxSites = 10);
+
+// 多行文本，每个调用点输出前 depth 层调用栈
+std::string formatSites(const std::vector<Site> &sites, size_t depth = 6);
+
+} // namespace alloccount
+
+#ifdef HIKO_ALLOC_COUNT
+// 当前作用域内当前线程的分配归属 stage
+#define HIKO_ALLOC_STAGE(stage)                                                                                        \
+    ::alloccount::StageScope HIKO_TIMING_CONCAT(hikoAllocStage_, __LINE__)(::frametiming::Stage::stage)
+#else
+#define HIKO_ALLOC_STAGE(stage) ((void)0)
+#endif
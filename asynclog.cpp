@@ -0,0 +1,315 @@
+#include "asynclog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace asynclog
+{
+
+namespace
+{
+constexpr size_t kSlotBytes = 256;
+constexpr size_t kSlotText = kSlotBytes - 16;
+constexpr size_t kMaxMessage = 8192;
+
+// 环形缓冲区中的一片。位置 p 的片空闲时 sequence == p，写完后置为 p + 1，写线程取走后置为 p + 容量（Vyukov 有界队列）。
+// 超过一片的消息占用连续的多片，由生产者一次 CAS 整体占下，首片的 parts 为总片数
+struct Slot
+{
+    std::atomic<uint64_t> sequence{0};
+    uint16_t length = 0; // 本片的字节数
+    uint16_t parts = 0;
+    Level level = Level::Info;
+    char text[kSlotText];
+};
+static_assert(sizeof(Slot) == kSlotBytes, "Slot should fill exactly one record");
+
+struct Ring
+{
+    explicit Ring(size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1)
+    {
+        for (size_t i = 0; i < capacity; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // 多个生产者；缓冲区满时返回 false，不等待
+    bool push(Level level, const char *text, size_t length) noexcept
+    {
+        size_t parts = std::max<size_t>(1, (length + kSlotText - 1) / kSlotText);
+        const size_t maxParts = (mask + 1) / 4; // 单条消息最多占四分之一，避免一条长消息挤掉其他记录
+        if (parts > maxParts)
+        {
+            parts = maxParts;
+            length = parts * kSlotText;
+        }
+
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            // 写线程按顺序释放各片，最后一片空闲时前面的片也都空闲
+            const uint64_t last = pos + parts - 1;
+            const int64_t diff =
+                static_cast<int64_t>(slots[last & mask].sequence.load(std::memory_order_acquire) - last);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + parts, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = tail.load(std::memory_order_relaxed);
+        }
+
+        for (size_t i = 0; i < parts; i++)
+        {
+            Slot &slot = slots[(pos + i) & mask];
+            const size_t offset = i * kSlotText;
+            const size_t n = std::min(kSlotText, length - offset);
+            std::memcpy(slot.text, text + offset, n);
+            slot.length = static_cast<uint16_t>(n);
+            slot.parts = static_cast<uint16_t>(parts);
+            slot.level = level;
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // 单一消费者（写线程）；下一条记录尚未写完时返回 false
+    bool pop(std::string &text, Level &level)
+    {
+        Slot &first = slots[head & mask];
+        if (first.sequence.load(std::memory_order_acquire) != head + 1)
+            return false;
+        const size_t parts = first.parts;
+        for (size_t i = 1; i < parts; i++)
+        {
+            if (slots[(head + i) & mask].sequence.load(std::memory_order_acquire) != head + i + 1)
+                return false;
+        }
+
+        level = first.level;
+        text.clear();
+        for (size_t i = 0; i < parts; i++)
+        {
+            Slot &slot = slots[(head + i) & mask];
+            text.append(slot.text, slot.length);
+            slot.sequence.store(head + i + mask + 1, std::memory_order_release);
+        }
+        head += parts;
+        return true;
+    }
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) uint64_t head = 0;
+};
+
+std::atomic<int> g_level{static_cast<int>(Level::Info)};
+// 不析构：stop 之后仍可能有线程持有旧指针并写入
+std::atomic<Ring *> g_ring{nullptr};
+std::atomic<bool> g_stopping{false};
+std::atomic<uint64_t> g_dropped{0};
+std::mutex g_controlMutex; // start / stop
+std::mutex g_outputMutex;  // 写线程与同步写出之间的互斥，保证行不交错
+std::thread g_writer;
+
+constexpr std::chrono::milliseconds kIdleSleep(2);
+
+int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+FILE *streamFor(Level level)
+{
+    return level >= Level::Warn ? stderr : stdout;
+}
+
+// 调用方持有 g_outputMutex
+void emit(Level level, const char *text, size_t length)
+{
+    FILE *stream = streamFor(level);
+    std::fwrite(text, 1, length, stream);
+    if (length == 0 || text[length - 1] != '\n')
+        std::fputc('\n', stream);
+}
+
+void writerLoop(Ring *ring)
+{
+    std::string text;
+    text.reserve(kMaxMessage);
+    Level level = Level::Info;
+    uint64_t reportedDrops = 0;
+    for (;;)
+    {
+        const bool stopping = g_stopping.load(std::memory_order_acquire);
+        bool wroteOut = false, wroteErr = false;
+        {
+            std::lock_guard<std::mutex> lock(g_outputMutex);
+            while (ring->pop(text, level))
+            {
+                emit(level, text.data(), text.size());
+                (streamFor(level) == stderr ? wroteErr : wroteOut) = true;
+            }
+            const uint64_t drops = g_dropped.load(std::memory_order_relaxed);
+            if (drops != reportedDrops)
+            {
+                std::fprintf(stderr, "日志缓冲区已满，丢弃 %llu 条日志\n",
+                             static_cast<unsigned long long>(drops - reportedDrops));
+                reportedDrops = drops;
+                wroteErr = true;
+            }
+            if (wroteOut)
+                std::fflush(stdout);
+            if (wroteErr)
+                std::fflush(stderr);
+        }
+        if (stopping)
+            break;
+        if (!wroteOut && !wroteErr)
+            std::this_thread::sleep_for(kIdleSleep);
+    }
+}
+
+// 程序退出时写出剩余日志
+struct Shutdown
+{
+    ~Shutdown()
+    {
+        stop();
+    }
+} g_shutdown;
+} // namespace
+
+const char *levelName(Level level)
+{
+    switch (level)
+    {
+    case Level::Debug:
+        return "debug";
+    case Level::Info:
+        return "info";
+    case Level::Warn:
+        return "warn";
+    case Level::Error:
+        return "error";
+    case Level::Off:
+        return "off";
+    }
+    return "unknown";
+}
+
+bool parseLevel(const std::string &name, Level &level)
+{
+    for (Level candidate : {Level::Debug, Level::Info, Level::Warn, Level::Error, Level::Off})
+    {
+        if (name == levelName(candidate))
+        {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void setLevel(Level level) noexcept
+{
+    g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Level level() noexcept
+{
+    return static_cast<Level>(g_level.load(std::memory_order_relaxed));
+}
+
+bool enabled(Level level) noexcept
+{
+    return level != Level::Off && static_cast<int>(level) >= g_level.load(std::memory_order_relaxed);
+}
+
+void start(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(g_controlMutex);
+    if (g_ring.load(std::memory_order_acquire))
+        return;
+    size_t cap = 64;
+    while (cap < capacity)
+        cap <<= 1;
+    Ring *ring = new Ring(cap);
+    g_stopping.store(false, std::memory_order_relaxed);
+    g_writer = std::thread(writerLoop, ring);
+    g_ring.store(ring, std::memory_order_release);
+}
+
+void stop()
+{
+    std::lock_guard<std::mutex> lock(g_controlMutex);
+    if (!g_ring.exchange(nullptr, std::memory_order_acq_rel))
+        return;
+    g_stopping.store(true, std::memory_order_release);
+    if (g_writer.joinable())
+        g_writer.join();
+}
+
+void write(Level level, Site &site, const char *format, ...)
+{
+    if (!enabled(level))
+        return;
+    uint32_t suppressed = 0;
+    if (site.intervalMs > 0)
+    {
+        const int64_t now = steadyNowNs();
+        int64_t next = site.nextNs.load(std::memory_order_relaxed);
+        if (now < next || !site.nextNs.compare_exchange_strong(next, now + int64_t(site.intervalMs) * 1000000,
+                                                                std::memory_order_relaxed))
+        {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+    // 线程本地缓冲区，热路径上不分配内存
+    thread_local char buffer[kMaxMessage];
+    va_list args;
+    va_start(args, format);
+    const int written = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (written < 0)
+        return;
+    size_t length = std::min(static_cast<size_t>(written), sizeof(buffer) - 1);
+    if (suppressed > 0)
+    {
+        while (length > 0 && buffer[length - 1] == '\n')
+            length--;
+        const int note = std::snprintf(buffer + length, sizeof(buffer) - length, "（此前 %u 条被限流）", suppressed);
+        if (note > 0)
+            length = std::min(length + static_cast<size_t>(note), sizeof(buffer) - 1);
+    }
+
+    Ring *ring = g_ring.load(std::memory_order_acquire);
+    if (ring)
+    {
+        if (!ring->push(level, buffer, length))
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_outputMutex);
+    emit(level, buffer, length);
+    std::fflush(streamFor(level));
+}
+
+uint64_t dropped() noexcept
+{
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace asynclog
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 异步日志：调用线程只把格式化好的文本写入预分配的无锁多生产者环形缓冲区，由后台线程写到 stdout / stderr，
+// 处理线程不会因为终端或管道输出慢而阻塞。缓冲区满时丢弃新记录并计数，由后台线程报告丢弃条数。
+// Debug / Info 写到 stdout，Warn / Error 写到 stderr；消息末尾没有换行时自动补一个。
+// start 之前与 stop 之后直接同步写出，启动阶段与离线工具的输出顺序不变。
+namespace asynclog
+{
+
+enum class Level : uint8_t
+{
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+const char *levelName(Level level);
+
+/**
+ * @brief 解析级别名称（debug / info / warn / error / off）
+ */
+bool parseLevel(const std::string &name, Level &level);
+
+/**
+ * @brief 设置输出级别，低于该级别的日志在格式化之前丢弃；默认 Info
+ */
+void setLevel(Level level) noexcept;
+
+Level level() noexcept;
+
+bool enabled(Level level) noexcept;
+
+/**
+ * @brief 一个日志调用点；由 HIKO_LOG 宏定义为静态变量，保存该位置的限流状态
+ */
+struct Site
+{
+    const char *file;
+    int line;
+    uint32_t intervalMs;                  ///< 两条日志的最小间隔，0 为不限流
+    std::atomic<int64_t> nextNs{0};       ///< 下一条可以输出的时刻（steady_clock）
+    std::atomic<uint32_t> suppressed{0};  ///< 上一条输出之后被限流丢弃的条数
+};
+
+/**
+ * @brief 启动后台写线程，预分配 capacity 条记录（向上取整为 2 的幂，每条 256 字节，长消息占用多条）
+ */
+void start(size_t capacity = 1024);
+
+/**
+ * @brief 写出缓冲区中剩余的日志并停止后台线程，之后的日志同步写出；应在其他线程停止写日志之后调用
+ *
+ * 程序退出时（静态对象析构）也会调用一次。
+ */
+void stop();
+
+/**
+ * @brief 格式化并写入一条日志（printf 格式，单条最长约 8 KB，超出部分截断）；一般通过 HIKO_LOG 宏调用
+ */
+void write(Level level, Site &site, const char *format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+/**
+ * @brief 因缓冲区满而丢弃的日志条数（累计）
+ */
+uint64_t dropped() noexcept;
+
+} // namespace asynclog
+
+// 写一条日志，如 HIKO_LOG(Info, "总帧数: %d", total)
+#define HIKO_LOG(level, ...) HIKO_LOG_EVERY(level, 0, __VA_ARGS__)
+
+// 同一调用点每 intervalMs 毫秒最多写一条，期间被限流的条数附在下一条输出之后
+#define HIKO_LOG_EVERY(level, intervalMs, ...)                                                                         \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (::asynclog::enabled(::asynclog::Level::level))                                                             \
+        {                                                                                                              \
+            static ::asynclog::Site hikoLogSite{__FILE__, __LINE__, (intervalMs)};                                     \
+            ::asynclog::write(::asynclog::Level::level, hikoLogSite, __VA_ARGS__);                                     \
+        }                                                                                                              \
+    } while (0)
@@ -0,0 +1,209 @@
+#include "clockmap.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace clockmap
+{
+
+namespace
+{
+constexpr double kMinSpanS = 1.0;      // 样本覆盖不足 1 s 时不估计漂移，按标称频率
+constexpr double kMaxRateError = 1e-3; // 拟合出超过 1000 ppm 的漂移视为异常样本，按标称频率
+constexpr int64_t kMaxDelayNs = 1000000000; // 到达比映射的曝光时刻晚 1 s 以上视为时间戳跳变
+constexpr int64_t kMaxLatchRttNs = 5000000; // 锁存往返超过 5 ms 的样本不使用
+} // namespace
+
+DeviceClockMapper::DeviceClockMapper(double ticksPerSecond) : ticksPerSecond_(ticksPerSecond > 0 ? ticksPerSecond : 1e9)
+{
+}
+
+void DeviceClockMapper::setTicksPerSecond(double ticksPerSecond)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ticksPerSecond > 0 && ticksPerSecond != ticksPerSecond_)
+    {
+        ticksPerSecond_ = ticksPerSecond;
+        resetLocked();
+    }
+}
+
+double DeviceClockMapper::deviceSeconds(uint64_t deviceTicks) const
+{
+    return static_cast<double>(static_cast<int64_t>(deviceTicks - baseTicks_)) / ticksPerSecond_;
+}
+
+void DeviceClockMapper::observeArrival(uint64_t deviceTicks, int64_t hostNs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (haveBase_)
+    {
+        // 映射出的曝光时刻应早于到达时刻，且只早一个传输延迟；否则设备时间戳发生了回退或跳变
+        int64_t mappedNs = baseHostNs_ + std::llround((offset_ + rate_ * deviceSeconds(deviceTicks)) * 1e9);
+        if (deviceTicks < lastTicks_ || mappedNs - hostNs > kMaxLateNs || hostNs - mappedNs > kMaxDelayNs)
+        {
+            resetLocked();
+            resets_++;
+        }
+    }
+    if (!haveBase_)
+    {
+        haveBase_ = true;
+        baseTicks_ = deviceTicks;
+        baseHostNs_ = hostNs;
+    }
+    lastTicks_ = deviceTicks;
+
+    Sample sample;
+    sample.device = deviceSeconds(deviceTicks);
+    sample.host = (hostNs - baseHostNs_) / 1e9;
+    sample.used = true;
+
+    const int64_t slot = (hostNs - baseHostNs_) / kBucketNs;
+    const size_t index = static_cast<size_t>(slot % static_cast<int64_t>(kBuckets));
+    Sample &bucket = buckets_[index];
+    // 同一时间片内保留传输延迟（host - device）最小的一帧
+    if (!bucket.used || bucketSlot_[index] != slot || sample.host - sample.device < bucket.host - bucket.device)
+    {
+        bucket = sample;
+        bucketSlot_[index] = slot;
+    }
+    refit();
+}
+
+void DeviceClockMapper::observeLatch(uint64_t deviceTicks, int64_t hostBeforeNs, int64_t hostAfterNs)
+{
+    if (hostAfterNs < hostBeforeNs || hostAfterNs - hostBeforeNs > kMaxLatchRttNs)
+        return; // 往返过长（调度被打断）的样本误差太大，丢弃
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t midNs = hostBeforeNs + (hostAfterNs - hostBeforeNs) / 2;
+    if (!haveBase_)
+    {
+        haveBase_ = true;
+        baseTicks_ = deviceTicks;
+        baseHostNs_ = midNs;
+        lastTicks_ = deviceTicks;
+    }
+    Sample &sample = latches_[nextLatch_++ % kLatches];
+    sample.device = deviceSeconds(deviceTicks);
+    sample.host = (midNs - baseHostNs_) / 1e9;
+    sample.used = true;
+    refit();
+}
+
+void DeviceClockMapper::refit()
+{
+    // 最近一个样本的主机时刻，早于窗口的样本不再使用
+    double latest = -std::numeric_limits<double>::infinity();
+    for (const Sample &s : buckets_)
+    {
+        if (s.used && s.host > latest)
+            latest = s.host;
+    }
+    for (const Sample &s : latches_)
+    {
+        if (s.used && s.host > latest)
+            latest = s.host;
+    }
+    const double windowS = static_cast<double>(kBuckets * kBucketNs) / 1e9;
+    auto recent = [&](const Sample &s) { return s.used && s.host >= latest - windowS; };
+
+    // 频率：到达样本（各时间片的最小延迟）的最小二乘斜率
+    double n = 0, meanD = 0, meanH = 0, minD = std::numeric_limits<double>::infinity(), maxD = -minD;
+    for (const Sample &s : buckets_)
+    {
+        if (!recent(s))
+            continue;
+        n++;
+        meanD += s.device;
+        meanH += s.host;
+        minD = std::min(minD, s.device);
+        maxD = std::max(maxD, s.device);
+    }
+    double rate = 1.0;
+    spanS_ = n > 0 ? maxD - minD : 0.0;
+    if (n >= 3 && spanS_ >= kMinSpanS)
+    {
+        meanD /= n;
+        meanH /= n;
+        double sdd = 0, sdh = 0;
+        for (const Sample &s : buckets_)
+        {
+            if (!recent(s))
+                continue;
+            sdd += (s.device - meanD) * (s.device - meanD);
+            sdh += (s.device - meanD) * (s.host - meanH);
+        }
+        if (sdd > 0 && std::fabs(sdh / sdd - 1.0) < kMaxRateError)
+            rate = sdh / sdd;
+    }
+    rate_ = rate;
+
+    // 偏移：有锁存样本时取各锁存样本偏移的中位数（单个样本误差在往返时间的一半以内），否则取到达样本的下包络
+    double latchOffsets[kLatches];
+    size_t latchCount = 0;
+    for (const Sample &s : latches_)
+    {
+        if (recent(s))
+            latchOffsets[latchCount++] = s.host - rate_ * s.device;
+    }
+    latched_ = latchCount > 0;
+    if (latched_)
+    {
+        std::sort(latchOffsets, latchOffsets + latchCount);
+        offset_ = latchCount % 2 ? latchOffsets[latchCount / 2]
+                                 : (latchOffsets[latchCount / 2 - 1] + latchOffsets[latchCount / 2]) / 2;
+        return;
+    }
+    double offset = std::numeric_limits<double>::infinity();
+    for (const Sample &s : buckets_)
+    {
+        if (recent(s))
+            offset = std::min(offset, s.host - rate_ * s.device);
+    }
+    offset_ = std::isfinite(offset) ? offset : 0.0;
+}
+
+bool DeviceClockMapper::toHost(uint64_t deviceTicks, int64_t &hostNs) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!haveBase_)
+        return false;
+    hostNs = baseHostNs_ + std::llround((offset_ + rate_ * deviceSeconds(deviceTicks)) * 1e9);
+    return true;
+}
+
+DeviceClockMapper::Status DeviceClockMapper::status() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Status s;
+    s.valid = haveBase_;
+    s.latched = latched_;
+    s.driftPpm = (rate_ - 1.0) * 1e6;
+    s.spanS = spanS_;
+    s.resets = resets_;
+    return s;
+}
+
+void DeviceClockMapper::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    resetLocked();
+}
+
+void DeviceClockMapper::resetLocked()
+{
+    haveBase_ = false;
+    baseTicks_ = 0;
+    baseHostNs_ = 0;
+    lastTicks_ = 0;
+    buckets_.fill(Sample());
+    latches_.fill(Sample());
+    nextLatch_ = 0;
+    rate_ = 1.0;
+    offset_ = 0.0;
+    latched_ = false;
+    spanS_ = 0.0;
+}
+
+} // namespace clockmap
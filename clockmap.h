@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace clockmap
+{
+
+/**
+ * @brief 设备时间戳 -> 主机 steady_clock 的映射，估计两时钟的偏移与频率漂移
+ *
+ * 模型为 host = offset + rate * device。两类观测：
+ * - 帧到达：帧的设备时间戳（曝光时刻）与 SDK 交付时刻。交付晚于曝光一个非负且抖动的传输延迟，
+ *   每 100 ms 只保留延迟最小的一帧，频率漂移由这些样本的最小二乘拟合得到，偏移取它们的下包络，
+ *   即映射结果等于“传输延迟最小时的到达时刻”，比真实曝光晚一个最小传输延迟（读出 + 传输）。
+ * - 时间戳锁存：在 [hostBefore, hostAfter] 之间读到的设备当前时间，误差不超过往返时间的一半。
+ *   有锁存样本时偏移取最近各锁存样本的中位数，不再包含传输延迟。
+ * 设备时间戳回退（相机重连、时间戳复位）或映射结果明显晚于到达时刻时自动重新开始估计。
+ * 所有方法可在不同线程并发调用。
+ */
+class DeviceClockMapper
+{
+  public:
+    /**
+     * @param ticksPerSecond 设备时钟标称频率（GigE 相机见 GevTimestampTickFrequency，USB3 相机一般为 1e9）
+     */
+    explicit DeviceClockMapper(double ticksPerSecond = 1e9);
+
+    /**
+     * @brief 修改标称频率并重新开始估计
+     */
+    void setTicksPerSecond(double ticksPerSecond);
+
+    /**
+     * @brief 一帧到达：deviceTicks 为曝光时刻的设备时间戳，hostNs 为 SDK 交付时刻（steady_clock 纳秒）
+     */
+    void observeArrival(uint64_t deviceTicks, int64_t hostNs);
+
+    /**
+     * @brief 时间戳锁存：在 hostBeforeNs 与 hostAfterNs 之间读到设备时间 deviceTicks
+     */
+    void observeLatch(uint64_t deviceTicks, int64_t hostBeforeNs, int64_t hostAfterNs);
+
+    /**
+     * @brief 把设备时间戳映射为主机 steady_clock 纳秒；尚无观测时返回 false
+     */
+    bool toHost(uint64_t deviceTicks, int64_t &hostNs) const;
+
+    struct Status
+    {
+        bool valid = false;     ///< 是否已有观测
+        bool latched = false;   ///< 偏移是否来自锁存样本
+        double driftPpm = 0.0;  ///< 设备时钟相对主机时钟的频率偏差
+        double spanS = 0.0;     ///< 拟合频率所用样本覆盖的时长
+        uint64_t resets = 0;    ///< 重新开始估计的次数
+    };
+
+    Status status() const;
+
+    void reset();
+
+  private:
+    static constexpr size_t kBuckets = 128;          // 保留最近 12.8 s 的到达样本
+    static constexpr int64_t kBucketNs = 100000000;  // 每 100 ms 保留延迟最小的一帧
+    static constexpr size_t kLatches = 16;
+    static constexpr int64_t kMaxLateNs = 50000000;  // 映射结果晚于到达超过 50 ms 视为时间戳复位
+
+    struct Sample
+    {
+        double device = 0.0; // 相对 baseTicks_ 的设备秒
+        double host = 0.0;   // 相对 baseHostNs_ 的主机秒（锁存样本取往返中点）
+        bool used = false;
+    };
+
+    void resetLocked();
+    void refit();
+    double deviceSeconds(uint64_t deviceTicks) const;
+
+    mutable std::mutex mutex_;
+    double ticksPerSecond_;
+    bool haveBase_ = false;
+    uint64_t baseTicks_ = 0;
+    int64_t baseHostNs_ = 0;
+    uint64_t lastTicks_ = 0;
+    std::array<Sample, kBuckets> buckets_{}; // 按 100 ms 时间片循环使用
+    int64_t bucketSlot_[kBuckets] = {};      // 每个槽位当前对应的时间片序号
+    std::array<Sample, kLatches> latches_{};
+    size_t nextLatch_ = 0;
+
+    double rate_ = 1.0;   // host 秒 / device 秒
+    double offset_ = 0.0; // device 为 0 时对应的 host 秒
+    bool latched_ = false;
+    double spanS_ = 0.0;
+    uint64_t resets_ = 0;
+};
+
+} // namespace clockmap
@@ -0,0 +1,137 @@
+#include "digitstage.h"
+#include <cmath>
+#include <map>
+#include <opencv2/imgproc.hpp>
+
+namespace armor
+{
+
+bool DigitTemplateClassifier::load(const std::string &path, std::string &error)
+{
+    cv::FileStorage fs;
+    try
+    {
+        fs.open(path, cv::FileStorage::READ);
+    }
+    catch (const cv::Exception &e)
+    {
+        error = std::string("无法解析第一级分类器文件: ") + e.what();
+        return false;
+    }
+    if (!fs.isOpened())
+    {
+        error = std::string("无法打开第一级分类器文件: ") + path;
+        return false;
+    }
+
+    int size = 0;
+    cv::Mat templates;
+    std::vector<int> classIds;
+    fs["size"] >> size;
+    fs["templates"] >> templates;
+    fs["class_ids"] >> classIds;
+    if (size != kSize || templates.type() != CV_32F || templates.cols != kSize * kSize ||
+        templates.rows != static_cast<int>(classIds.size()) || templates.rows < 2)
+    {
+        error = std::string("第一级分类器文件格式不符: ") + path;
+        return false;
+    }
+
+    fs["min_margin"] >> minMargin;
+    fs["min_score"] >> minScore;
+    templates_ = templates;
+    classIds_ = classIds;
+    return true;
+}
+
+bool DigitTemplateClassifier::save(const std::string &path) const
+{
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened())
+        return false;
+    fs << "size" << kSize;
+    fs << "min_margin" << minMargin;
+    fs << "min_score" << minScore;
+    fs << "class_ids" << classIds_;
+    fs << "templates" << templates_;
+    return true;
+}
+
+void DigitTemplateClassifier::fit(const std::vector<cv::Mat> &features, const std::vector<int> &classIds)
+{
+    std::map<int, cv::Mat> sums;
+    for (size_t i = 0; i < features.size() && i < classIds.size(); i++)
+    {
+        cv::Mat &sum = sums[classIds[i]];
+        if (sum.empty())
+            sum = cv::Mat::zeros(1, kSize * kSize, CV_32F);
+        sum += features[i];
+    }
+
+    templates_.create(static_cast<int>(sums.size()), kSize * kSize, CV_32F);
+    classIds_.clear();
+    int row = 0;
+    for (const auto &entry : sums)
+    {
+        cv::normalize(entry.second, templates_.row(row++));
+        classIds_.push_back(entry.first);
+    }
+}
+
+bool DigitTemplateClassifier::extractFeature(const cv::Mat &blob, int sample, cv::Mat &feature)
+{
+    if (blob.dims != 4 || blob.type() != CV_32F || sample < 0 || sample >= blob.size[0])
+        return false;
+
+    const int rows = blob.size[2], cols = blob.size[3];
+    const size_t offset = static_cast<size_t>(sample) * blob.size[1] * rows * cols;
+    cv::Mat plane(rows, cols, CV_32F, const_cast<float *>(blob.ptr<float>()) + offset);
+
+    // 区域平均下采样，宽高比不同的输入统一拉伸到 kSize x kSize
+    cv::Mat small;
+    cv::resize(plane, small, cv::Size(kSize, kSize), 0, 0, cv::INTER_AREA);
+    small = small.reshape(1, 1);
+    small -= cv::mean(small)[0];
+    double norm = cv::norm(small);
+    if (norm < 1e-6)
+        return false;
+    small.convertTo(feature, CV_32F, 1.0 / norm);
+    return true;
+}
+
+DigitTemplateClassifier::Prediction DigitTemplateClassifier::predict(const cv::Mat &feature) const
+{
+    Prediction prediction;
+    if (templates_.empty() || feature.cols != templates_.cols)
+        return prediction;
+
+    // 单遍 softmax：expSum 为各类 exp((score - best) / T) 之和，最高分变化时按新旧最高分之差重新缩放
+    float best = -2.0f, second = -2.0f;
+    double expSum = 0.0;
+    int bestRow = -1;
+    for (int r = 0; r < templates_.rows; r++)
+    {
+        float score = static_cast<float>(templates_.row(r).dot(feature));
+        if (score > best)
+        {
+            expSum = expSum * std::exp((best - score) / kScoreTemperature) + 1.0;
+            second = best;
+            best = score;
+            bestRow = r;
+        }
+        else
+        {
+            expSum += std::exp((score - best) / kScoreTemperature);
+            if (score > second)
+                second = score;
+        }
+    }
+
+    prediction.classId = classIds_[bestRow];
+    prediction.score = best;
+    prediction.margin = best - second;
+    prediction.probability = static_cast<float>(1.0 / expSum);
+    return prediction;
+}
+
+} // namespace armor
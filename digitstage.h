@@ -0,0 +1,80 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+namespace armor
+{
+
+/**
+ * @brief 级联分类的第一级：32x32 下采样二值图上的模板相关分类器
+ *
+ * 每个类别保存一个去均值、单位范数的平均模板，得分为输入特征与模板的归一化相关系数。
+ * 最高分与次高分之差（margin）不低于 minMargin 且最高分不低于 minScore 时直接给出结果，
+ * 否则交给网络。归一化相关对输入的正比例仿射变换不敏感，因此可以直接在网络输入张量上计算。
+ */
+class DigitTemplateClassifier
+{
+  public:
+    static constexpr int kSize = 32; ///< 特征图边长
+    /// 相关系数换算为类别概率的 softmax 温度：margin 达到默认 minMargin（0.2）时最高类概率约 0.98（两类）
+    static constexpr float kScoreTemperature = 0.05f;
+
+    struct Prediction
+    {
+        int classId = -1;   ///< 与网络输出相同的类别下标
+        float score = 0.0f; ///< 最高的归一化相关系数
+        float margin = 0.0f; ///< 最高分与次高分之差
+        float probability = 0.0f; ///< 各类相关系数按 kScoreTemperature 做 softmax 后最高类的概率，与网络输出同量纲
+    };
+
+    /**
+     * @brief 从 fit 工具生成的 YAML 文件加载模板与阈值
+     */
+    bool load(const std::string &path, std::string &error);
+    bool save(const std::string &path) const;
+
+    /**
+     * @brief 由特征与类别下标拟合各类平均模板（阈值不变）
+     */
+    void fit(const std::vector<cv::Mat> &features, const std::vector<int> &classIds);
+
+    /**
+     * @brief 从网络输入张量（1xCxHxW 或 NxCxHxW）第 sample 个样本的第一个通道提取特征
+     * @param feature 输出 1 x kSize*kSize 的浮点特征，去均值并归一化为单位范数
+     * @return 输入为常数图像时返回 false
+     */
+    static bool extractFeature(const cv::Mat &blob, int sample, cv::Mat &feature);
+
+    Prediction predict(const cv::Mat &feature) const;
+
+    bool accept(const Prediction &prediction) const
+    {
+        return prediction.classId >= 0 && prediction.margin >= minMargin && prediction.score >= minScore;
+    }
+
+    bool empty() const noexcept
+    {
+        return templates_.empty();
+    }
+
+    const cv::Mat &templates() const noexcept
+    {
+        return templates_;
+    }
+
+    const std::vector<int> &classIds() const noexcept
+    {
+        return classIds_;
+    }
+
+    float minMargin = 0.2f; ///< 直接给出结果所需的最小 margin
+    float minScore = 0.3f;  ///< 直接给出结果所需的最小相关系数
+
+  private:
+    cv::Mat templates_;         ///< 每行一个类别的模板（CV_32F，单位范数）
+    std::vector<int> classIds_; ///< 每行模板对应的类别下标
+};
+
+} // namespace armor
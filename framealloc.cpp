@@ -0,0 +1,176 @@
+#include "framealloc.h"
+#include <new>
+
+namespace framealloc
+{
+
+PooledMatAllocator::~PooledMatAllocator()
+{
+    for (Bucket &bucket : buckets_)
+    {
+        while (FreeBlock *block = bucket.head)
+        {
+            bucket.head = block->next;
+            cv::fastFree(block);
+        }
+    }
+}
+
+int PooledMatAllocator::sizeClass(size_t bytes, size_t &classBytes)
+{
+    if (bytes <= (size_t(1) << kMinShift))
+    {
+        classBytes = size_t(1) << kMinShift;
+        return 0;
+    }
+    // 2^k < bytes <= 2^(k+1)，区间等分为 kStepsPerDoubling 级
+    int k = 0;
+    for (size_t v = bytes - 1; v >>= 1;)
+        k++;
+    if (k >= kMaxShift)
+    {
+        classBytes = bytes;
+        return -1;
+    }
+    const size_t base = size_t(1) << k;
+    const size_t step = base / kStepsPerDoubling;
+    const size_t m = (bytes - base + step - 1) / step;
+    classBytes = base + m * step;
+    return (k - kMinShift) * kStepsPerDoubling + static_cast<int>(m);
+}
+
+void *PooledMatAllocator::acquire(size_t bytes) const
+{
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    size_t classBytes = 0;
+    int index = sizeClass(bytes, classBytes);
+    if (index >= 0)
+    {
+        Bucket &bucket = buckets_[index];
+        std::lock_guard<std::mutex> lock(bucket.mutex);
+        if (FreeBlock *block = bucket.head)
+        {
+            bucket.head = block->next;
+            return block;
+        }
+    }
+    systemAllocations_.fetch_add(1, std::memory_order_relaxed);
+    reservedBytes_.fetch_add(classBytes, std::memory_order_relaxed);
+    return cv::fastMalloc(classBytes);
+}
+
+void PooledMatAllocator::release(void *block, size_t bytes) const
+{
+    size_t classBytes = 0;
+    int index = sizeClass(bytes, classBytes);
+    if (index < 0)
+    {
+        reservedBytes_.fetch_sub(classBytes, std::memory_order_relaxed);
+        cv::fastFree(block);
+        return;
+    }
+    Bucket &bucket = buckets_[index];
+    FreeBlock *node = static_cast<FreeBlock *>(block);
+    std::lock_guard<std::mutex> lock(bucket.mutex);
+    node->next = bucket.head;
+    bucket.head = node;
+}
+
+// 步长计算与 OpenCV 默认分配器相同，只有数据块与 UMatData 的来源不同
+cv::UMatData *PooledMatAllocator::allocate(int dims, const int *sizes, int type, void *data0, size_t *step,
+                                           cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--)
+    {
+        if (step)
+        {
+            if (data0 && step[i] != CV_AUTOSTEP)
+            {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar *data = data0 ? static_cast<uchar *>(data0) : static_cast<uchar *>(acquire(total));
+    cv::UMatData *u = new (acquire(sizeof(cv::UMatData))) cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0)
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+}
+
+bool PooledMatAllocator::allocate(cv::UMatData *u, cv::AccessFlag /*accessFlags*/,
+                                  cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return u != nullptr;
+}
+
+void PooledMatAllocator::deallocate(cv::UMatData *u) const
+{
+    if (!u)
+        return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+        release(u->origdata, u->size);
+    u->~UMatData();
+    release(u, sizeof(cv::UMatData));
+}
+
+PooledMatAllocator::Stats PooledMatAllocator::stats() const
+{
+    Stats s;
+    s.allocations = allocations_.load(std::memory_order_relaxed);
+    s.systemAllocations = systemAllocations_.load(std::memory_order_relaxed);
+    s.reservedBytes = reservedBytes_.load(std::memory_order_relaxed);
+    return s;
+}
+
+PooledMatAllocator &installPooledMatAllocator()
+{
+    static PooledMatAllocator *allocator = new PooledMatAllocator();
+    cv::Mat::setDefaultAllocator(allocator);
+    return *allocator;
+}
+
+FrameArena::FrameArena(size_t initialBytes) : buffer_(new std::byte[initialBytes]), capacity_(initialBytes)
+{
+    arena_.emplace(buffer_.get(), capacity_, &upstream_);
+}
+
+void FrameArena::reset()
+{
+    // 析构单调内存区即归还本帧向上游申请的全部内存
+    arena_.reset();
+    if (upstream_.bytes > 0)
+    {
+        overflows_ += upstream_.count;
+        capacity_ += upstream_.bytes;
+        buffer_.reset(new std::byte[capacity_]);
+        upstream_.bytes = 0;
+        upstream_.count = 0;
+    }
+    arena_.emplace(buffer_.get(), capacity_, &upstream_);
+}
+
+void *FrameArena::UpstreamResource::do_allocate(size_t size, size_t alignment)
+{
+    bytes += size;
+    count++;
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void FrameArena::UpstreamResource::do_deallocate(void *p, size_t size, size_t alignment)
+{
+    std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+}
+
+} // namespace framealloc
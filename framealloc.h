@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+
+namespace framealloc
+{
+
+/**
+ * @brief 按尺寸分级缓存数据块的 cv::Mat 分配器
+ *
+ * 释放的数据块按尺寸级别挂回空闲链表，之后同级别的分配直接取用，稳定运行后每帧的临时 Mat
+ * 不再进入系统分配器。每个 2 的幂区间再等分为 4 级，按级别取整浪费不超过 25%；超过 256 MB 的
+ * 分配直接交给 cv::fastMalloc。UMatData 头同样从池中分配。缓存的内存不归还系统。
+ * 可在任意线程并发分配与释放。
+ */
+class PooledMatAllocator : public cv::MatAllocator
+{
+  public:
+    struct Stats
+    {
+        uint64_t allocations = 0;       ///< 数据块分配次数（含 UMatData 头）
+        uint64_t systemAllocations = 0; ///< 其中未命中缓存、向系统申请内存的次数
+        size_t reservedBytes = 0;       ///< 向系统申请的内存总量（使用中与空闲缓存）
+    };
+
+    PooledMatAllocator() = default;
+    ~PooledMatAllocator() override;
+
+    PooledMatAllocator(const PooledMatAllocator &) = delete;
+    PooledMatAllocator &operator=(const PooledMatAllocator &) = delete;
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag flags,
+                           cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData *data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData *data) const override;
+
+    Stats stats() const;
+
+  private:
+    static constexpr int kMinShift = 6;  // 最小级别 64 字节
+    static constexpr int kMaxShift = 28; // 超过 2^28 字节不缓存
+    static constexpr int kStepsPerDoubling = 4;
+    static constexpr int kClassCount = (kMaxShift - kMinShift) * kStepsPerDoubling + 1;
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct alignas(64) Bucket
+    {
+        std::mutex mutex;
+        FreeBlock *head = nullptr;
+    };
+
+    // bytes 所属的级别与该级别的块大小，超出缓存范围时返回 -1
+    static int sizeClass(size_t bytes, size_t &classBytes);
+    void *acquire(size_t bytes) const;
+    void release(void *block, size_t bytes) const;
+
+    mutable Bucket buckets_[kClassCount];
+    mutable std::atomic<uint64_t> allocations_{0};
+    mutable std::atomic<uint64_t> systemAllocations_{0};
+    mutable std::atomic<size_t> reservedBytes_{0};
+};
+
+/**
+ * @brief 把进程级的 PooledMatAllocator 设为 cv::Mat 的默认分配器，应在创建任何工作线程之前调用
+ *
+ * 实例永不析构：静态 Mat 可能在退出时才释放。之前已分配的 Mat 仍由原分配器释放。
+ */
+PooledMatAllocator &installPooledMatAllocator();
+
+/**
+ * @brief 单帧临时容器使用的单调内存区（std::pmr），帧之间整体重置
+ *
+ * 本帧的容器从预留缓冲区中顺序分配，释放不做任何事，reset 一次性回收。缓冲区不够时向上游
+ * （new/delete）申请，下一次 reset 按溢出的大小扩大缓冲区，几帧之后不再向上游申请。
+ * 同一时刻只能由一个线程使用；reset 之前本帧从 resource() 分配的容器必须已经析构。
+ */
+class FrameArena
+{
+  public:
+    explicit FrameArena(size_t initialBytes = 16 * 1024);
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    std::pmr::memory_resource *resource() noexcept
+    {
+        return &*arena_;
+    }
+
+    void reset();
+
+    size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    /**
+     * @brief 缓冲区不够、向上游申请内存的累计次数
+     */
+    uint64_t overflows() const noexcept
+    {
+        return overflows_ + upstream_.count;
+    }
+
+  private:
+    // 记录申请量并转发给 new/delete
+    class UpstreamResource : public std::pmr::memory_resource
+    {
+      public:
+        size_t bytes = 0;
+        uint64_t count = 0;
+
+      private:
+        void *do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void *p, size_t size, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    std::unique_ptr<std::byte[]> buffer_;
+    size_t capacity_ = 0;
+    uint64_t overflows_ = 0;
+    UpstreamResource upstream_;
+    std::optional<std::pmr::monotonic_buffer_resource> arena_;
+};
+
+} // namespace framealloc
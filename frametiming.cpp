@@ -0,0 +1,247 @@
+#include "frametiming.h"
+#include "trace.h"
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace frametiming
+{
+
+namespace
+{
+// 每个 2 的幂区间分为 32 级；小于 64 ns 的值各占一级
+constexpr int kSubBucketBits = 5;
+constexpr int kSubBuckets = 1 << kSubBucketBits;
+constexpr int kMaxBits = 40; // 约 1100 s，更大的值计入最后一级
+constexpr int kBucketCount = 2 * kSubBuckets + (kMaxBits - kSubBucketBits - 1) * kSubBuckets;
+constexpr int kStageCount = static_cast<int>(Stage::Count);
+
+int highestBit(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int bit = 0;
+    while (v >>= 1)
+        bit++;
+    return bit;
+#endif
+}
+
+int bucketIndex(uint64_t ns)
+{
+    if (ns < 2 * kSubBuckets)
+        return static_cast<int>(ns);
+    int bit = highestBit(ns);
+    if (bit >= kMaxBits)
+        return kBucketCount - 1;
+    int shift = bit - kSubBucketBits;
+    return 2 * kSubBuckets + (shift - 1) * kSubBuckets + static_cast<int>((ns >> shift) - kSubBuckets);
+}
+
+// 区间内的最大值
+uint64_t bucketUpperNs(int index)
+{
+    if (index < 2 * kSubBuckets)
+        return static_cast<uint64_t>(index);
+    int j = index - 2 * kSubBuckets;
+    int shift = j / kSubBuckets + 1;
+    uint64_t lower = static_cast<uint64_t>(j % kSubBuckets + kSubBuckets) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+// 一个线程的全部直方图，只由所属线程写入
+struct ThreadHistograms
+{
+    std::atomic<uint64_t> counts[kStageCount][kBucketCount] = {};
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadHistograms>> threads; // 线程退出后保留，数据仍计入汇总
+};
+
+Registry &registry()
+{
+    // 不析构：线程可能在静态对象析构之后才退出
+    static Registry *instance = new Registry();
+    return *instance;
+}
+
+ThreadHistograms &localHistograms()
+{
+    thread_local ThreadHistograms *histograms = [] {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.emplace_back(new ThreadHistograms());
+        return r.threads.back().get();
+    }();
+    return *histograms;
+}
+
+double toMs(uint64_t ns)
+{
+    return ns / 1e6;
+}
+
+thread_local uint64_t t_frameId = 0;
+
+uint64_t toNs(std::chrono::steady_clock::time_point t)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+}
+
+uint64_t durationNs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return static_cast<uint64_t>(ns > 0 ? ns : 0);
+}
+
+void addToHistogram(Stage stage, uint64_t ns) noexcept
+{
+    // 只有本线程写入，读改写不需要原子指令
+    std::atomic<uint64_t> &count = localHistograms().counts[static_cast<int>(stage)][bucketIndex(ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+} // namespace
+
+const char *stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::Grab:
+        return "grab";
+    case Stage::Convert:
+        return "convert";
+    case Stage::Resize:
+        return "resize";
+    case Stage::Preprocess:
+        return "preprocess";
+    case Stage::Contours:
+        return "contours";
+    case Stage::Pairing:
+        return "pairing";
+    case Stage::Pnp:
+        return "pnp";
+    case Stage::Warp:
+        return "warp";
+    case Stage::Inference:
+        return "inference";
+    case Stage::Display:
+        return "display";
+    case Stage::Frame:
+        return "frame";
+    case Stage::Delivery:
+        return "delivery";
+    case Stage::Latency:
+        return "latency";
+    case Stage::Count:
+        break;
+    }
+    return "?";
+}
+
+void record(Stage stage, std::chrono::steady_clock::time_point start,
+            std::chrono::steady_clock::time_point end) noexcept
+{
+    uint64_t ns = durationNs(start, end);
+    addToHistogram(stage, ns);
+    if (trace::active())
+        trace::span(stageName(stage), toNs(start), ns, t_frameId);
+}
+
+void setFrame(uint64_t frameId) noexcept
+{
+    t_frameId = frameId;
+}
+
+void recordFrame(uint64_t frameId, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end, int candidates, int inferences) noexcept
+{
+    uint64_t ns = durationNs(start, end);
+    addToHistogram(Stage::Frame, ns);
+    if (trace::active())
+    {
+        trace::span(stageName(Stage::Frame), toNs(start), ns, frameId, candidates, inferences);
+        trace::frameCompleted(ns);
+    }
+}
+
+Reporter::Reporter() : last_(static_cast<size_t>(kStageCount) * kBucketCount, 0)
+{
+}
+
+std::vector<StageSummary> Reporter::take()
+{
+    std::vector<uint64_t> total(last_.size(), 0);
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto &thread : r.threads)
+        {
+            for (int s = 0; s < kStageCount; s++)
+            {
+                for (int b = 0; b < kBucketCount; b++)
+                    total[s * kBucketCount + b] += thread->counts[s][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::vector<StageSummary> summaries;
+    summaries.reserve(kStageCount);
+    for (int s = 0; s < kStageCount; s++)
+    {
+        const uint64_t *current = &total[s * kBucketCount];
+        const uint64_t *previous = &last_[s * kBucketCount];
+        StageSummary summary;
+        summary.stage = static_cast<Stage>(s);
+        for (int b = 0; b < kBucketCount; b++)
+            summary.count += current[b] - previous[b];
+        if (summary.count > 0)
+        {
+            // 各分位数对应的样本序号（从 1 开始）
+            const uint64_t rank50 = (summary.count * 50 + 99) / 100;
+            const uint64_t rank90 = (summary.count * 90 + 99) / 100;
+            const uint64_t rank99 = (summary.count * 99 + 99) / 100;
+            uint64_t seen = 0;
+            for (int b = 0; b < kBucketCount; b++)
+            {
+                uint64_t n = current[b] - previous[b];
+                if (n == 0)
+                    continue;
+                double upperMs = toMs(bucketUpperNs(b));
+                if (seen < rank50 && seen + n >= rank50)
+                    summary.p50Ms = upperMs;
+                if (seen < rank90 && seen + n >= rank90)
+                    summary.p90Ms = upperMs;
+                if (seen < rank99 && seen + n >= rank99)
+                    summary.p99Ms = upperMs;
+                summary.maxMs = upperMs;
+                seen += n;
+            }
+        }
+        summaries.push_back(summary);
+    }
+    last_.swap(total);
+    return summaries;
+}
+
+std::string Reporter::format(const std::vector<StageSummary> &summaries)
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    for (const StageSummary &s : summaries)
+    {
+        if (s.count == 0)
+            continue;
+        oss << "  " << std::left << std::setw(10) << stageName(s.stage) << std::right << " | n " << std::setw(6)
+            << s.count << " | p50 " << std::setw(7) << s.p50Ms << " | p90 " << std::setw(7) << s.p90Ms << " | p99 "
+            << std::setw(7) << s.p99Ms << " | max " << std::setw(7) << s.maxMs << " ms\n";
+    }
+    return oss.str();
+}
+
+} // namespace frametiming
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 帧耗时埋点：各阶段耗时写入每个线程独立的对数分级直方图（HDR 风格，相对误差 < 3.2%），
+// 写入只有一次无竞争的原子读写，不加锁；Reporter 周期性汇总所有线程，输出各阶段分位数。
+// 开启逐帧追踪（trace.h）时，同一个埋点同时写入追踪缓冲区。
+// 编译时不定义 HIKO_FRAME_TIMING（CMake 选项 HIKO_FRAME_TIMING=OFF）时下列宏展开为空，埋点不产生任何代码。
+namespace frametiming
+{
+
+enum class Stage
+{
+    Grab,       // 等待并取得相机图像（顺序模式下含像素格式转换）
+    Convert,    // 像素格式转换为 BGR
+    Resize,     // 粗到精搜索图像缩小
+    Preprocess, // 灰度、模糊、阈值、形态学
+    Contours,   // 轮廓提取与灯条拟合
+    Pairing,    // 灯条配对、全分辨率精修与轨迹关联
+    Pnp,        // 单个装甲板的 PnP 解算
+    Warp,       // 单个装甲板的透视变换与网络输入生成
+    Inference,  // 单个装甲板的分类推理（含级联第一级）
+    Display,    // 预览线程绘制与显示一帧
+    Frame,      // 端到端：取得图像到检测结果可用
+    Delivery,   // 曝光（设备时间戳映射到主机时钟）到 SDK 交付
+    Latency,    // 曝光到检测结果发布，即结果发布时的“年龄”
+    Count
+};
+
+const char *stageName(Stage stage);
+
+/**
+ * @brief 记录一次耗时到当前线程的直方图；开启追踪时同时记录一个区间，归属当前线程的帧号
+ */
+void record(Stage stage, std::chrono::steady_clock::time_point start,
+            std::chrono::steady_clock::time_point end) noexcept;
+
+/**
+ * @brief 设置当前线程之后的埋点所属的帧号（仅用于追踪）
+ */
+void setFrame(uint64_t frameId) noexcept;
+
+/**
+ * @brief 记录一帧的端到端耗时；追踪区间附带本帧的候选灯条数与推理次数，超过慢帧阈值时请求转储
+ */
+void recordFrame(uint64_t frameId, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end, int candidates, int inferences) noexcept;
+
+// 作用域计时：构造时开始，析构时记录
+class ScopedTimer
+{
+  public:
+    explicit ScopedTimer(Stage stage) noexcept : stage_(stage), start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        record(stage_, start_, std::chrono::steady_clock::now());
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  private:
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 单个阶段在一个统计窗口内的分位数（毫秒，取所在直方图区间的上界）
+struct StageSummary
+{
+    Stage stage = Stage::Frame;
+    uint64_t count = 0;
+    double p50Ms = 0.0;
+    double p90Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+/**
+ * @brief 汇总所有线程的直方图；每次 take 返回自上次 take 以来的数据（应由单一线程周期性调用）
+ *
+ * 各线程的直方图只增不减，Reporter 保存上次的累计值做差，不需要清零写入方的数据。
+ */
+class Reporter
+{
+  public:
+    Reporter();
+
+    std::vector<StageSummary> take();
+
+    // 多行文本，只包含窗口内有数据的阶段
+    static std::string format(const std::vector<StageSummary> &summaries);
+
+  private:
+    std::vector<uint64_t> last_; // 上次 take 时各阶段各区间的累计计数
+};
+
+} // namespace frametiming
+
+#define HIKO_TIMING_CONCAT_(a, b) a##b
+#define HIKO_TIMING_CONCAT(a, b) HIKO_TIMING_CONCAT_(a, b)
+
+#ifdef HIKO_FRAME_TIMING
+// 计时到当前作用域结束
+#define HIKO_TIME_SCOPE(stage)                                                                                         \
+    ::frametiming::ScopedTimer HIKO_TIMING_CONCAT(hikoScopedTimer_, __LINE__)(::frametiming::Stage::stage)
+// 声明一个起始时刻，配合 HIKO_TIME_SINCE 使用
+#define HIKO_TIME_POINT(name) const auto name = std::chrono::steady_clock::now()
+// 记录从 start（steady_clock 时刻）到现在的耗时
+#define HIKO_TIME_SINCE(stage, start)                                                                                  \
+    ::frametiming::record(::frametiming::Stage::stage, (start), std::chrono::steady_clock::now())
+// 记录 start 到 end 两个 steady_clock 时刻之间的耗时
+#define HIKO_TIME_BETWEEN(stage, start, end) ::frametiming::record(::frametiming::Stage::stage, (start), (end))
+// 当前线程之后的埋点属于 frameId 帧
+#define HIKO_TIME_FRAME_ID(frameId) ::frametiming::setFrame(frameId)
+// 一帧结束：记录从 start 到现在的端到端耗时
+#define HIKO_TIME_FRAME(frameId, start, candidates, inferences)                                                        \
+    ::frametiming::recordFrame((frameId), (start), std::chrono::steady_clock::now(), (candidates), (inferences))
+#else
+#define HIKO_TIME_SCOPE(stage) ((void)0)
+#define HIKO_TIME_POINT(name) ((void)0)
+#define HIKO_TIME_SINCE(stage, start) ((void)0)
+#define HIKO_TIME_BETWEEN(stage, start, end) ((void)0)
+#define HIKO_TIME_FRAME_ID(frameId) ((void)0)
+#define HIKO_TIME_FRAME(frameId, start, candidates, inferences) ((void)0)
+#endif
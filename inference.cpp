@@ -0,0 +1,587 @@
+#include "inference.h"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <opencv2/dnn.hpp>
+
+#ifdef HIKO_WITH_ONNXRUNTIME
+#include <onnxruntime_cxx_api.h>
+#endif
+
+namespace armor
+{
+namespace
+{
+// 推理输出拷贝为每个样本一行，调用方拿到结果后上下文即可交给其它线程
+void copyRows(const cv::Mat &out, int batch, cv::Mat &output)
+{
+    cv::Mat flat = out.isContinuous() ? out : out.clone();
+    flat.reshape(1, batch).copyTo(output);
+}
+
+// 把归一化与三组输入通道权重合并进第一层卷积：
+//   sum_c W_c * (v - m_c) / s_c + b = (sum_c W_c / s_c) * v + (b - sum_c m_c / s_c * sum(W_c))
+bool foldInputChannels(cv::dnn::Net &net, const std::array<float, 3> &mean, const std::array<float, 3> &stdv)
+{
+    std::vector<std::string> names = net.getLayerNames();
+    if (names.empty())
+        return false;
+    int layerId = net.getLayerId(names.front());
+    cv::Ptr<cv::dnn::Layer> layer = net.getLayer(layerId);
+    if (!layer || layer->type != "Convolution" || layer->blobs.size() < 2)
+        return false;
+
+    const cv::Mat &weights = layer->blobs[0];
+    const cv::Mat &bias = layer->blobs[1];
+    if (weights.dims != 4 || weights.size[1] != 3 || weights.type() != CV_32F || !weights.isContinuous() ||
+        bias.type() != CV_32F || bias.total() != static_cast<size_t>(weights.size[0]))
+        return false;
+
+    const int outChannels = weights.size[0];
+    const int kernel = weights.size[2] * weights.size[3];
+    int dims[4] = {outChannels, 1, weights.size[2], weights.size[3]};
+    cv::Mat foldedWeights(4, dims, CV_32F);
+    cv::Mat foldedBias = bias.clone();
+
+    const float *w = weights.ptr<float>();
+    float *fw = foldedWeights.ptr<float>();
+    float *fb = foldedBias.ptr<float>();
+    for (int o = 0; o < outChannels; o++)
+    {
+        double shift = 0.0;
+        for (int k = 0; k < kernel; k++)
+        {
+            double sum = 0.0;
+            for (int c = 0; c < 3; c++)
+            {
+                double wv = w[(static_cast<size_t>(o) * 3 + c) * kernel + k];
+                sum += wv / stdv[c];
+                shift += wv * mean[c] / stdv[c];
+            }
+            fw[static_cast<size_t>(o) * kernel + k] = static_cast<float>(sum);
+        }
+        fb[o] = static_cast<float>(fb[o] - shift);
+    }
+
+    net.setParam(layerId, 0, foldedWeights);
+    net.setParam(layerId, 1, foldedBias);
+    return true;
+}
+
+// 最小的 protobuf 线格式读取器，只用于从 ONNX 模型中取出输入张量的形状，不依赖 protobuf 库
+class ProtoReader
+{
+  public:
+    enum WireType
+    {
+        kVarint = 0,
+        kFixed64 = 1,
+        kLengthDelimited = 2,
+        kFixed32 = 5,
+    };
+
+    ProtoReader(const uchar *data, size_t size) : p_(data), end_(data + size)
+    {
+    }
+
+    // 读取下一个字段的编号与线类型，到达末尾或数据损坏时返回 false
+    bool next(uint32_t &field, uint32_t &wireType)
+    {
+        uint64_t tag = 0;
+        if (p_ == end_ || !varint(tag))
+            return false;
+        field = static_cast<uint32_t>(tag >> 3);
+        wireType = static_cast<uint32_t>(tag & 7);
+        return field != 0;
+    }
+
+    bool varint(uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && p_ != end_; shift += 7)
+        {
+            uchar byte = *p_++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    // 长度前缀字段：返回指向其内容的子读取器
+    bool message(ProtoReader &sub)
+    {
+        uint64_t length = 0;
+        if (!varint(length) || length > static_cast<uint64_t>(end_ - p_))
+            return false;
+        sub = ProtoReader(p_, static_cast<size_t>(length));
+        p_ += length;
+        return true;
+    }
+
+    bool string(std::string &value)
+    {
+        ProtoReader sub(nullptr, 0);
+        if (!message(sub))
+            return false;
+        value.assign(reinterpret_cast<const char *>(sub.p_), sub.end_ - sub.p_);
+        return true;
+    }
+
+    bool skip(uint32_t wireType)
+    {
+        uint64_t value = 0;
+        ProtoReader sub(nullptr, 0);
+        switch (wireType)
+        {
+        case kVarint:
+            return varint(value);
+        case kFixed64:
+            return advance(8);
+        case kLengthDelimited:
+            return message(sub);
+        case kFixed32:
+            return advance(4);
+        default:
+            return false;
+        }
+    }
+
+  private:
+    bool advance(size_t count)
+    {
+        if (count > static_cast<size_t>(end_ - p_))
+            return false;
+        p_ += count;
+        return true;
+    }
+
+    const uchar *p_;
+    const uchar *end_;
+};
+
+// ONNX 字段编号（onnx.proto）
+constexpr uint32_t kModelGraph = 7;
+constexpr uint32_t kGraphInitializer = 5;
+constexpr uint32_t kGraphInput = 11;
+constexpr uint32_t kTensorName = 8;
+constexpr uint32_t kValueInfoName = 1;
+constexpr uint32_t kValueInfoType = 2;
+constexpr uint32_t kTypeTensor = 1;
+constexpr uint32_t kTensorTypeShape = 2;
+constexpr uint32_t kShapeDim = 1;
+constexpr uint32_t kDimValue = 1;
+
+// 在消息中找到编号为 target 的第一个子消息
+bool findMessage(ProtoReader reader, uint32_t target, ProtoReader &found)
+{
+    uint32_t field = 0, wireType = 0;
+    while (reader.next(field, wireType))
+    {
+        if (field == target && wireType == ProtoReader::kLengthDelimited)
+            return reader.message(found);
+        if (!reader.skip(wireType))
+            return false;
+    }
+    return false;
+}
+
+// TypeProto -> tensor_type.shape.dim[]，没有给出 dim_value 的维度记为 -1
+bool readTensorShape(ProtoReader type, std::vector<int64_t> &shape)
+{
+    ProtoReader tensor(nullptr, 0), shapeProto(nullptr, 0);
+    if (!findMessage(type, kTypeTensor, tensor) || !findMessage(tensor, kTensorTypeShape, shapeProto))
+        return false;
+
+    shape.clear();
+    uint32_t field = 0, wireType = 0;
+    while (shapeProto.next(field, wireType))
+    {
+        if (field != kShapeDim || wireType != ProtoReader::kLengthDelimited)
+        {
+            if (!shapeProto.skip(wireType))
+                return false;
+            continue;
+        }
+        ProtoReader dim(nullptr, 0);
+        if (!shapeProto.message(dim))
+            return false;
+        int64_t size = -1;
+        uint32_t dimField = 0, dimWire = 0;
+        while (dim.next(dimField, dimWire))
+        {
+            uint64_t value = 0;
+            if (dimField == kDimValue && dimWire == ProtoReader::kVarint && dim.varint(value))
+                size = static_cast<int64_t>(value) > 0 ? static_cast<int64_t>(value) : -1;
+            else if (!dim.skip(dimWire))
+                return false;
+        }
+        shape.push_back(size);
+    }
+    return true;
+}
+
+class OpenCvSession : public InferenceSession
+{
+  public:
+    explicit OpenCvSession(cv::dnn::Net net) : net_(std::move(net))
+    {
+    }
+
+    bool run(const cv::Mat &blob, cv::Mat &output, std::string &error) override
+    {
+        try
+        {
+            net_.setInput(blob);
+            // forward() 的输出引用网络内部缓冲区，必须在本上下文内拷贝出来
+            copyRows(net_.forward(), blob.size[0], output);
+        }
+        catch (const cv::Exception &e)
+        {
+            error = std::string("推理失败: ") + e.what();
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    cv::dnn::Net net_;
+};
+
+// OpenCV DNN 后端：cv::dnn::Net 的拷贝共享内部状态，每个上下文都从模型数据重新解析一份
+class OpenCvBackend : public InferenceBackend
+{
+  public:
+    OpenCvBackend(const std::vector<uchar> &model, const BackendOptions &options,
+                  const std::vector<cv::Mat> &calibration)
+        : model_(model), options_(options), calibration_(calibration)
+    {
+        // 量化后的网络不再做输入通道折叠
+        if (options_.type == BackendType::OpenCvInt8)
+            options_.foldInputChannels = false;
+    }
+
+    BackendType type() const override
+    {
+        return options_.type;
+    }
+
+    int inputChannels() const override
+    {
+        return options_.foldInputChannels ? 1 : 3;
+    }
+
+    std::unique_ptr<InferenceSession> createSession(std::string &error) const override
+    {
+        try
+        {
+            cv::dnn::Net net = cv::dnn::readNetFromONNX(model_);
+            net.setPreferableBackend(cv::dnn::DNN_BACKEND_DEFAULT);
+            net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+            if (options_.foldInputChannels && !foldInputChannels(net, options_.foldMean, options_.foldStd))
+            {
+                error = "第一层不是带偏置的三通道卷积，无法折叠输入通道";
+                return nullptr;
+            }
+            if (options_.type == BackendType::OpenCvInt8)
+            {
+                // 静态量化：用校准输入统计各层激活范围，权重与激活均为 INT8，输入输出保持浮点
+                net = net.quantize(calibration_, CV_32F, CV_32F);
+                net.setPreferableBackend(cv::dnn::DNN_BACKEND_DEFAULT);
+                net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+            }
+            return std::make_unique<OpenCvSession>(std::move(net));
+        }
+        catch (const cv::Exception &e)
+        {
+            error = e.what();
+            return nullptr;
+        }
+    }
+
+  private:
+    std::vector<uchar> model_;
+    BackendOptions options_;
+    std::vector<cv::Mat> calibration_;
+};
+
+#ifdef HIKO_WITH_ONNXRUNTIME
+Ort::Env &ortEnv()
+{
+    static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "hiko");
+    return env;
+}
+
+class OrtSession : public InferenceSession
+{
+  public:
+    OrtSession(std::shared_ptr<Ort::Session> session, const std::string &inputName, const std::string &outputName)
+        : session_(std::move(session)), inputName_(inputName), outputName_(outputName),
+          memory_(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault))
+    {
+    }
+
+    bool run(const cv::Mat &blob, cv::Mat &output, std::string &error) override
+    {
+        try
+        {
+            std::array<int64_t, 4> shape = {blob.size[0], blob.size[1], blob.size[2], blob.size[3]};
+            Ort::Value input = Ort::Value::CreateTensor<float>(memory_, const_cast<float *>(blob.ptr<float>()),
+                                                               blob.total(), shape.data(), shape.size());
+            const char *inputNames[] = {inputName_.c_str()};
+            const char *outputNames[] = {outputName_.c_str()};
+            std::vector<Ort::Value> outputs =
+                session_->Run(Ort::RunOptions{nullptr}, inputNames, &input, 1, outputNames, 1);
+
+            size_t count = outputs[0].GetTensorTypeAndShapeInfo().GetElementCount();
+            cv::Mat out(1, static_cast<int>(count), CV_32F, outputs[0].GetTensorMutableData<float>());
+            copyRows(out, blob.size[0], output);
+        }
+        catch (const Ort::Exception &e)
+        {
+            error = std::string("推理失败: ") + e.what();
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    std::shared_ptr<Ort::Session> session_;
+    std::string inputName_;
+    std::string outputName_;
+    Ort::MemoryInfo memory_;
+};
+
+// ONNX Runtime 后端：Ort::Session::Run 可并发调用，所有上下文共享同一个会话，
+// 每次推理内部使用 intraOpThreads 个线程
+class OrtBackend : public InferenceBackend
+{
+  public:
+    OrtBackend(const std::vector<uchar> &model, const BackendOptions &options)
+    {
+        Ort::SessionOptions sessionOptions;
+        sessionOptions.SetIntraOpNumThreads(std::max(0, options.intraOpThreads));
+        sessionOptions.SetInterOpNumThreads(1);
+        sessionOptions.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+        if (!options.cacheFile.empty() && std::ifstream(options.cacheFile).good())
+        {
+            // 缓存文件可能是上次写入中断留下的残缺文件，加载失败时回退到 ONNX 模型并重新生成
+            try
+            {
+                Ort::SessionOptions cachedOptions = sessionOptions.Clone();
+                cachedOptions.AddConfigEntry("session.load_model_format", "ORT");
+                session_ = std::make_shared<Ort::Session>(ortEnv(), options.cacheFile.c_str(), cachedOptions);
+                fromCache_ = true;
+            }
+            catch (const Ort::Exception &)
+            {
+                session_.reset();
+            }
+        }
+        if (!session_)
+        {
+            if (!options.cacheFile.empty())
+            {
+                // 只保存与硬件无关的图优化结果，其余优化在加载缓存时再做
+                sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+                sessionOptions.SetOptimizedModelFilePath(options.cacheFile.c_str());
+                sessionOptions.AddConfigEntry("session.save_model_format", "ORT");
+            }
+            session_ = std::make_shared<Ort::Session>(ortEnv(), model.data(), model.size(), sessionOptions);
+        }
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        inputName_ = session_->GetInputNameAllocated(0, allocator).get();
+        outputName_ = session_->GetOutputNameAllocated(0, allocator).get();
+    }
+
+    BackendType type() const override
+    {
+        return BackendType::OnnxRuntime;
+    }
+
+    int inputChannels() const override
+    {
+        return 3;
+    }
+
+    bool loadedFromCache() const override
+    {
+        return fromCache_;
+    }
+
+    std::unique_ptr<InferenceSession> createSession(std::string &) const override
+    {
+        return std::make_unique<OrtSession>(session_, inputName_, outputName_);
+    }
+
+  private:
+    std::shared_ptr<Ort::Session> session_;
+    bool fromCache_ = false;
+    std::string inputName_;
+    std::string outputName_;
+};
+#endif // HIKO_WITH_ONNXRUNTIME
+} // namespace
+
+const char *backendName(BackendType type)
+{
+    switch (type)
+    {
+    case BackendType::OpenCvDnn:
+        return "opencv";
+    case BackendType::OpenCvInt8:
+        return "opencv-int8";
+    case BackendType::OnnxRuntime:
+        return "onnxruntime";
+    }
+    return "unknown";
+}
+
+bool parseBackendType(const std::string &name, BackendType &type)
+{
+    for (BackendType candidate : {BackendType::OpenCvDnn, BackendType::OpenCvInt8, BackendType::OnnxRuntime})
+    {
+        if (name == backendName(candidate))
+        {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool backendAvailable(BackendType type)
+{
+#ifdef HIKO_WITH_ONNXRUNTIME
+    (void)type;
+    return true;
+#else
+    return type != BackendType::OnnxRuntime;
+#endif
+}
+
+uint64_t modelHash(const std::vector<uchar> &model)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (uchar byte : model)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool readOnnxInputShape(const std::vector<uchar> &model, std::vector<int64_t> &shape, std::string &error)
+{
+    ProtoReader graph(nullptr, 0);
+    if (!findMessage(ProtoReader(model.data(), model.size()), kModelGraph, graph))
+    {
+        error = "无法解析 ONNX 模型中的计算图";
+        return false;
+    }
+
+    // 旧版本模型把权重也列为图输入，需排除与初始化器同名的输入
+    std::set<std::string> initializers;
+    std::vector<ProtoReader> inputs;
+    uint32_t field = 0, wireType = 0;
+    while (graph.next(field, wireType))
+    {
+        ProtoReader sub(nullptr, 0), name(nullptr, 0);
+        if ((field == kGraphInitializer || field == kGraphInput) && wireType == ProtoReader::kLengthDelimited)
+        {
+            if (!graph.message(sub))
+                break;
+            if (field == kGraphInput)
+            {
+                inputs.push_back(sub);
+                continue;
+            }
+            uint32_t tensorField = 0, tensorWire = 0;
+            while (sub.next(tensorField, tensorWire))
+            {
+                std::string tensorName;
+                if (tensorField == kTensorName && tensorWire == ProtoReader::kLengthDelimited)
+                {
+                    if (sub.string(tensorName))
+                        initializers.insert(tensorName);
+                    break;
+                }
+                if (!sub.skip(tensorWire))
+                    break;
+            }
+        }
+        else if (!graph.skip(wireType))
+        {
+            break;
+        }
+    }
+
+    for (ProtoReader input : inputs)
+    {
+        std::string name;
+        ProtoReader type(nullptr, 0);
+        bool hasType = false;
+        uint32_t inputField = 0, inputWire = 0;
+        while (input.next(inputField, inputWire))
+        {
+            bool ok = true;
+            if (inputField == kValueInfoName && inputWire == ProtoReader::kLengthDelimited)
+                ok = input.string(name);
+            else if (inputField == kValueInfoType && inputWire == ProtoReader::kLengthDelimited)
+                ok = hasType = input.message(type);
+            else
+                ok = input.skip(inputWire);
+            if (!ok)
+                break;
+        }
+        if (initializers.count(name))
+            continue;
+        if (!hasType || !readTensorShape(type, shape))
+        {
+            error = "ONNX 模型输入 " + name + " 没有张量形状";
+            return false;
+        }
+        return true;
+    }
+    error = "ONNX 模型没有输入";
+    return false;
+}
+
+std::unique_ptr<InferenceBackend> createInferenceBackend(const std::vector<uchar> &model, const BackendOptions &options,
+                                                         const std::vector<cv::Mat> &calibration, std::string &error)
+{
+    switch (options.type)
+    {
+    case BackendType::OpenCvDnn:
+        return std::make_unique<OpenCvBackend>(model, options, calibration);
+    case BackendType::OpenCvInt8:
+        if (calibration.empty())
+        {
+            error = "INT8 量化需要校准输入";
+            return nullptr;
+        }
+        return std::make_unique<OpenCvBackend>(model, options, calibration);
+    case BackendType::OnnxRuntime:
+#ifdef HIKO_WITH_ONNXRUNTIME
+        try
+        {
+            return std::make_unique<OrtBackend>(model, options);
+        }
+        catch (const Ort::Exception &e)
+        {
+            error = e.what();
+            return nullptr;
+        }
+#else
+        error = "未启用 ONNX Runtime 支持（以 -DHIKO_WITH_ONNXRUNTIME=ON 重新编译）";
+        return nullptr;
+#endif
+    }
+    error = "未知的推理后端";
+    return nullptr;
+}
+
+} // namespace armor
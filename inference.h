@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+namespace armor
+{
+
+/**
+ * @brief 推理后端类型
+ */
+enum class BackendType
+{
+    OpenCvDnn,   ///< OpenCV DNN，CPU 目标
+    OpenCvInt8,  ///< OpenCV DNN 静态 INT8 量化（加载时用校准输入量化权重与激活）
+    OnnxRuntime, ///< ONNX Runtime CPU（需以 HIKO_WITH_ONNXRUNTIME 编译）
+};
+
+/**
+ * @brief 后端名称（opencv / opencv-int8 / onnxruntime），用于命令行与日志
+ */
+const char *backendName(BackendType type);
+
+/**
+ * @brief 按名称解析后端类型
+ * @return 名称无法识别时返回 false
+ */
+bool parseBackendType(const std::string &name, BackendType &type);
+
+/**
+ * @brief 当前构建是否包含该后端
+ */
+bool backendAvailable(BackendType type);
+
+struct BackendOptions
+{
+    BackendType type = BackendType::OpenCvDnn;
+    int intraOpThreads = 1; ///< ONNX Runtime 单次推理的内部线程数（<= 0 由运行时决定）
+
+    /// OpenCV DNN：把三个相同的输入通道连同归一化参数折叠进第一层卷积，网络改为接收 [0,1] 单通道输入
+    bool foldInputChannels = false;
+    std::array<float, 3> foldMean{};
+    std::array<float, 3> foldStd{};
+
+    /// ONNX Runtime：优化后模型（ORT 格式）的缓存文件。文件存在时直接加载，跳过解析与图优化；
+    /// 不存在或无法加载时从 ONNX 模型创建会话并把优化结果写入该文件。为空表示不使用缓存
+    std::string cacheFile;
+};
+
+/**
+ * @brief 单个推理上下文，同一时刻只能被一个线程使用
+ */
+class InferenceSession
+{
+  public:
+    virtual ~InferenceSession() = default;
+
+    /**
+     * @brief 执行一次推理
+     * @param blob NxCxHxW 浮点输入张量
+     * @param output 输出 N 行的浮点矩阵，每行为一个样本的各类得分
+     * @param error 失败时写入错误信息
+     */
+    virtual bool run(const cv::Mat &blob, cv::Mat &output, std::string &error) = 0;
+};
+
+/**
+ * @brief 推理后端：持有只读的模型定义，为每个并发调用者创建独立的推理上下文
+ */
+class InferenceBackend
+{
+  public:
+    virtual ~InferenceBackend() = default;
+
+    virtual BackendType type() const = 0;
+
+    /**
+     * @brief 网络输入通道数（折叠输入通道后为 1）
+     */
+    virtual int inputChannels() const = 0;
+
+    /**
+     * @brief 是否直接从 BackendOptions::cacheFile 加载，未重新解析与优化模型
+     */
+    virtual bool loadedFromCache() const
+    {
+        return false;
+    }
+
+    /**
+     * @brief 创建一个推理上下文，失败时返回 nullptr 并写入 error；可在任意线程调用
+     */
+    virtual std::unique_ptr<InferenceSession> createSession(std::string &error) const = 0;
+};
+
+/**
+ * @brief 模型文件内容的 64 位 FNV-1a 哈希，作为模型缓存的键
+ */
+uint64_t modelHash(const std::vector<uchar> &model);
+
+/**
+ * @brief 从 ONNX 模型中读取第一个（非初始化器）输入张量的形状
+ * @param shape 输出各维大小，动态维度为 -1
+ * @return 模型无法解析或没有输入时返回 false 并写入 error
+ */
+bool readOnnxInputShape(const std::vector<uchar> &model, std::vector<int64_t> &shape, std::string &error);
+
+/**
+ * @brief 由内存中的 ONNX 模型创建推理后端
+ * @param model ONNX 模型文件内容
+ * @param options 后端类型与参数
+ * @param calibration OpenCvInt8 的校准输入（1xCxHxW 张量），其它后端忽略
+ * @param error 失败时写入错误信息
+ */
+std::unique_ptr<InferenceBackend> createInferenceBackend(const std::vector<uchar> &model, const BackendOptions &options,
+                                                         const std::vector<cv::Mat> &calibration, std::string &error);
+
+} // namespace armor
@@ -0,0 +1,204 @@
+#include "labelcache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+Point2f plateCenter(const ArmorDetection &det)
+{
+    return (det.corners[0] + det.corners[1] + det.corners[2] + det.corners[3]) * 0.25f;
+}
+
+float plateWidth(const ArmorDetection &det)
+{
+    Point2f d = det.rightBar.center - det.leftBar.center;
+    return sqrt(d.dot(d));
+}
+} // namespace
+
+LabelCache::LabelCache() : LabelCache(Params())
+{
+}
+
+LabelCache::LabelCache(const Params &params) : m_params(params)
+{
+}
+
+void LabelCache::beginFrame()
+{
+    m_frame++;
+    m_entries.erase(remove_if(m_entries.begin(), m_entries.end(),
+                              [this](const Entry &e) {
+                                  return m_frame - e.lastSeenFrame > static_cast<uint64_t>(m_params.maxUnseenFrames);
+                              }),
+                    m_entries.end());
+    for (Entry &e : m_entries)
+        e.claimed = false;
+}
+
+bool LabelCache::computeSignature(const Mat &frontView, Signature &signature)
+{
+    if (frontView.empty())
+        return false;
+    // 先在彩色图上缩小再转灰度，只处理 64 个像素
+    Mat small;
+    resize(frontView, small, Size(8, 8), 0, 0, INTER_AREA);
+    Mat gray(8, 8, CV_8UC1, signature.data());
+    if (small.channels() == 3)
+        cvtColor(small, gray, COLOR_BGR2GRAY);
+    else if (small.channels() == 1)
+        small.copyTo(gray);
+    else
+        return false;
+    return true;
+}
+
+LabelCache::Entry *LabelCache::findEntry(const ArmorDetection &det)
+{
+    // 优先使用跟踪器给出的 ID
+    if (det.trackId >= 0)
+    {
+        for (Entry &e : m_entries)
+        {
+            if (!e.claimed && e.trackId == det.trackId)
+                return &e;
+        }
+    }
+
+    // 否则按中心点连续性匹配最近的条目
+    Point2f center = plateCenter(det);
+    float width = max(1.0f, plateWidth(det));
+    Entry *best = nullptr;
+    float bestShift = m_params.maxCenterShift;
+    for (Entry &e : m_entries)
+    {
+        if (e.claimed || (det.trackId >= 0 && e.trackId >= 0 && e.trackId != det.trackId))
+            continue;
+        Point2f d = center - e.center;
+        float shift = sqrt(d.dot(d)) / max(width, e.width);
+        if (shift <= bestShift)
+        {
+            bestShift = shift;
+            best = &e;
+        }
+    }
+    return best;
+}
+
+LabelCache::Entry *LabelCache::entryById(uint64_t id)
+{
+    for (Entry &e : m_entries)
+    {
+        if (e.id == id)
+            return &e;
+    }
+    return nullptr;
+}
+
+bool LabelCache::lookup(ArmorDetection &det, const Mat &frontView, LabelTicket &ticket)
+{
+    m_stats.lookups++;
+    Entry *entry = findEntry(det);
+    if (!entry)
+    {
+        // 新装甲板：先登记一个没有结果的条目，写回之前的后续帧通过它关联到同一块装甲板
+        m_entries.emplace_back();
+        entry = &m_entries.back();
+        entry->id = m_nextId++;
+    }
+    ticket.entry = entry->id;
+    ticket.frame = m_frame;
+    ticket.modelGeneration = m_modelGeneration;
+
+    // 位置连续即视为同一块装甲板，无论是否复用都更新位置，避免下一帧丢失关联
+    entry->claimed = true;
+    entry->lastSeenFrame = m_frame;
+    entry->center = plateCenter(det);
+    entry->width = plateWidth(det);
+    if (det.trackId >= 0)
+        entry->trackId = det.trackId;
+
+    uint64_t age = m_frame - entry->inferenceFrame;
+    if (age >= static_cast<uint64_t>(m_params.refreshInterval))
+        return false;
+    if (entry->confidence * pow(m_params.confidenceDecay, static_cast<double>(age)) < m_params.minConfidence)
+        return false;
+
+    Signature signature;
+    if (!computeSignature(frontView, signature))
+        return false;
+    int diff = 0;
+    for (size_t i = 0; i < signature.size(); i++)
+        diff += abs(int(signature[i]) - int(entry->signature[i]));
+    if (diff > m_params.maxAppearanceDiff * signature.size())
+        return false;
+
+    det.classified = true;
+    det.classId = entry->classId;
+    det.confidence = entry->confidence;
+    det.label = entry->label;
+    m_stats.hits++;
+    return true;
+}
+
+void LabelCache::store(const ArmorDetection &det, const Mat &frontView, const LabelTicket &ticket)
+{
+    if (ticket.modelGeneration != m_modelGeneration)
+        return;
+    // 查询之后条目可能已过期删除，此时按新装甲板重新登记
+    Entry *entry = entryById(ticket.entry);
+
+    Signature signature;
+    if (!det.classified || !computeSignature(frontView, signature))
+    {
+        if (entry)
+            m_entries.erase(m_entries.begin() + (entry - m_entries.data()));
+        return;
+    }
+
+    if (!entry)
+    {
+        m_entries.emplace_back();
+        entry = &m_entries.back();
+        entry->id = m_nextId++;
+        entry->claimed = ticket.frame == m_frame;
+    }
+    // 写回之前已有更新的帧查询过这块装甲板时，位置保留较新的一次
+    if (ticket.frame >= entry->lastSeenFrame)
+    {
+        entry->trackId = det.trackId;
+        entry->center = plateCenter(det);
+        entry->width = plateWidth(det);
+        entry->lastSeenFrame = ticket.frame;
+    }
+    entry->inferenceFrame = ticket.frame;
+    entry->signature = signature;
+    entry->classId = det.classId;
+    entry->confidence = det.confidence;
+    entry->label = det.label;
+}
+
+LabelCache::Stats LabelCache::takeStats()
+{
+    Stats stats = m_stats;
+    m_stats = Stats();
+    return stats;
+}
+
+void LabelCache::clear()
+{
+    m_entries.clear();
+    m_stats = Stats();
+}
+
+void LabelCache::setModelGeneration(uint64_t generation)
+{
+    if (generation == m_modelGeneration)
+        return;
+    m_modelGeneration = generation;
+    m_entries.clear();
+}
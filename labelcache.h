@@ -0,0 +1,88 @@
+#pragma once
+
+#include "process.h"
+#include <array>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// 装甲板分类结果的时间缓存：同一块装甲板（按 trackId 或相邻帧中心连续性判定）在置信度保持较高、
+// 外观无明显变化时复用上一次的分类结果，跳过网络推理。
+// 以下任一条件成立时强制重新推理：
+//   - 距离上次推理已超过 refreshInterval 帧
+//   - 缓存置信度按帧衰减后低于 minConfidence
+//   - 正面视图的缩略图与上次推理时的平均绝对差超过 maxAppearanceDiff
+// 查询与写回通过 LabelTicket 对应，中间可以插入其它帧的查询（流水线中推理在两者之间并行执行）。
+// 非线程安全，同一实例只能在一个线程上使用。
+class LabelCache
+{
+public:
+    struct Params
+    {
+        float maxCenterShift = 0.5f;    // 无 trackId 时中心点允许的帧间位移（相对装甲板宽度）
+        double minConfidence = 0.6;     // 衰减后的类别概率（0~1，即 MatchResult::confidence）低于此值时重新推理
+        double confidenceDecay = 0.97;  // 每帧的置信度衰减系数
+        int refreshInterval = 30;       // 最多连续复用多少帧后强制重新推理
+        double maxAppearanceDiff = 12.0; // 8x8 灰度缩略图平均绝对差阈值（0~255）
+        int maxUnseenFrames = 5;        // 条目多少帧未被匹配后删除
+    };
+
+    struct Stats
+    {
+        uint64_t lookups = 0; // 查询次数（每块装甲板一次）
+        uint64_t hits = 0;    // 复用缓存、跳过推理的次数
+    };
+
+    LabelCache();
+    explicit LabelCache(const Params &params);
+
+    // 每帧分类之前调用一次，推进帧计数并淘汰过期条目
+    void beginFrame();
+
+    // 查询缓存：命中且无需重新推理时填充 det 的分类字段并返回 true。
+    // frontView 为该装甲板的正面视图，用于外观变化检测。未命中时为这块装甲板认领（或新建）一个条目，
+    // ticket 记录该条目，推理完成后交给 store；后续帧在写回之前查询到该条目时同样视为未命中
+    bool lookup(ArmorDetection &det, const cv::Mat &frontView, LabelTicket &ticket);
+
+    // 按 lookup 给出的 ticket 写回一次推理结果（det.classified 为 false 时删除对应条目）。
+    // 同一实例上各次 store 须按帧顺序调用；模型在查询之后更换时结果被丢弃
+    void store(const ArmorDetection &det, const cv::Mat &frontView, const LabelTicket &ticket);
+
+    // 取出并清零统计数据
+    Stats takeStats();
+    void clear();
+
+    // 记录当前分类模型的发布序号（见 armor::getGlobalArmorMatcher），模型更换后丢弃旧模型的结果
+    void setModelGeneration(uint64_t generation);
+
+private:
+    using Signature = std::array<uint8_t, 64>;
+
+    struct Entry
+    {
+        uint64_t id = 0;             // 条目编号（从 1 开始），LabelTicket 据此找回条目
+        int trackId = -1;
+        cv::Point2f center;
+        float width = 0.0f;
+        uint64_t inferenceFrame = 0; // 最近一次推理所在帧（0 表示尚无推理结果）
+        uint64_t lastSeenFrame = 0;
+        Signature signature{};      // 推理时的外观缩略图
+        int classId = -1;
+        double confidence = 0.0;    // 尚无推理结果时为 0，查询总是未命中
+        std::string label;
+        bool claimed = false;       // 本帧是否已被某块装甲板匹配
+    };
+
+    Entry *findEntry(const ArmorDetection &det);
+    Entry *entryById(uint64_t id);
+    static bool computeSignature(const cv::Mat &frontView, Signature &signature);
+
+    Params m_params;
+    std::vector<Entry> m_entries;
+    uint64_t m_frame = 0;
+    uint64_t m_nextId = 1;
+    uint64_t m_modelGeneration = 0;
+    Stats m_stats;
+    cv::Mat m_thumb; // 缩略图工作缓冲区
+};
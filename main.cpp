@@ -1,13 +1,20 @@
 #include "HikCamera.h"
+#include "alloccount.h"
+#include "asynclog.h"
+#include "frametiming.h"
+#include "trace.h"
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <csignal>
 #include <cstdlib>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <system_error>
 #include <thread>
@@ -15,28 +22,733 @@
 
 #ifdef USE_OPENCV
 #include "ArmorMatcher.h"
+#include "clockmap.h"
+#include "framealloc.h"
+#include "pipeline.h"
+#include "preview.h"
 #include "process.h"
+#include "labelcache.h"
+#include "modelreloader.h"
+#include "render.h"
+#include "tracker.h"
 #include <opencv2/opencv.hpp>
 #endif
 
 // 全局标志，用于优雅退出
 std::atomic<bool> g_running(true);
+// 收到的退出信号，由主循环结束后输出（信号处理函数中不写日志）
+std::atomic<int> g_stopSignal(0);
 
 // 信号处理函数
 void signalHandler(int signal)
 {
     if (signal == SIGINT || signal == SIGTERM)
     {
-        std::cout << "\nReceived signal " << signal << ", stopping..." << std::endl;
+        g_stopSignal = signal;
         g_running = false;
     }
+#ifdef SIGUSR1
+    else if (signal == SIGUSR1)
+    {
+        // 只设置标志，由主循环写文件
+        trace::requestDump();
+    }
+#endif
+}
+
+// 有追踪转储请求（按键、SIGUSR1、慢帧）时写出追踪文件
+static void pollTraceDump()
+{
+    std::string path;
+    if (trace::dumpIfRequested(&path))
+        HIKO_LOG(Info, "追踪已写出: %s", path.c_str());
+}
+
+#ifdef HIKO_ALLOC_COUNT
+// 分配计数的周期性输出：每 5 秒输出各阶段每帧的分配次数、字节与缺页。
+// 开启调用点采集时，启动 10 秒（模型加载、缓冲区与内存池预热）之后开始采集，并输出窗口内分配最多的调用点
+struct AllocReport
+{
+    explicit AllocReport(bool captureSites) : sites(captureSites)
+    {
+    }
+
+    void poll(std::chrono::steady_clock::time_point now, uint64_t frames)
+    {
+        if (now - last < std::chrono::seconds(5))
+            return;
+        HIKO_LOG(Info, "内存分配（每帧平均）:\n%s",
+                 alloccount::Reporter::format(reporter.take(), frames - lastFrames).c_str());
+        if (capturing)
+            HIKO_LOG(Info, "分配调用点:\n%s", alloccount::formatSites(alloccount::takeSites(5)).c_str());
+        else if (sites && now - start >= std::chrono::seconds(10))
+        {
+            alloccount::setSiteCapture(true);
+            capturing = true;
+            HIKO_LOG(Info, "开始采集分配调用点");
+        }
+        lastFrames = frames;
+        last = now;
+    }
+
+    alloccount::Reporter reporter;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last = start;
+    uint64_t lastFrames = 0;
+    bool sites = false;
+    bool capturing = false;
+};
+#endif
+
+#ifdef USE_OPENCV
+// 保存图像到当前目录
+static void saveCapture(const cv::Mat &image)
+{
+    std::string filename =
+        "capture_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".jpg";
+    cv::imwrite(filename, image);
+    HIKO_LOG(Info, "图像已保存: %s", filename.c_str());
+}
+
+// 按 1.5 倍的级数调整曝光；只在采集线程上调用（相机控制与取图、重连使用同一句柄，不跨线程访问）
+static void applyExposureSteps(hik::HikCamera &camera, int steps)
+{
+    float currentExposure = camera.GetExposureTime();
+    float newExposure = currentExposure * std::pow(1.5f, static_cast<float>(steps));
+    camera.SetExposureTime(newExposure);
+    HIKO_LOG(Info, "曝光时间: %g -> %g us", currentExposure, camera.GetExposureTime());
+}
+
+// 处理预览线程回传的键盘事件；返回 true 表示请求保存当前帧。
+// 曝光调整只累加到 exposureSteps，由调用方交给采集线程执行
+static bool handlePreviewKey(int key, int &exposureSteps)
+{
+    if (key == 27 || key == 'q' || key == 'Q')
+    { // ESC 或 Q 键退出
+        HIKO_LOG(Info, "\n用户请求退出...");
+        g_running = false;
+    }
+    else if (key == 's' || key == 'S')
+    { // S 键保存图像
+        return true;
+    }
+    else if (key == 't' || key == 'T')
+    { // T 键转储逐帧追踪
+        trace::requestDump();
+    }
+    else if (key == '+' || key == '=')
+    { // + 键增加曝光
+        exposureSteps++;
+    }
+    else if (key == '-' || key == '_')
+    { // - 键减少曝光
+        exposureSteps--;
+    }
+    return false;
+}
+
+// steady_clock 时刻换算为秒，用作跟踪器的帧时间
+static double steadySeconds(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+// 设备时间戳到主机时钟的映射：采集线程写入帧到达样本，并每秒写入一次锁存样本
+static clockmap::DeviceClockMapper g_deviceClock;
+static bool g_latchSupported = true;
+
+static std::chrono::steady_clock::time_point steadyFromNs(int64_t ns)
+{
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+// 一帧的曝光时刻：设备时间戳映射到主机 steady_clock，相机不提供时间戳时退化为 SDK 交付时刻；
+// 映射误差使结果晚于交付时刻时取交付时刻。同时记录曝光到交付的时延
+static std::chrono::steady_clock::time_point frameExposure(const hik::ImageData &image)
+{
+    int64_t exposedNs = image.hostTimestamp;
+    if (image.deviceTimestamp != 0)
+    {
+        g_deviceClock.observeArrival(image.deviceTimestamp, image.hostTimestamp);
+        int64_t mappedNs = 0;
+        if (g_deviceClock.toHost(image.deviceTimestamp, mappedNs))
+            exposedNs = std::min(mappedNs, image.hostTimestamp);
+    }
+    std::chrono::steady_clock::time_point exposed = steadyFromNs(exposedNs);
+    HIKO_TIME_BETWEEN(Delivery, exposed, steadyFromNs(image.hostTimestamp));
+    return exposed;
+}
+
+// 锁存一次设备时间戳，映射偏移从“经过最小传输延迟的到达时刻”校正为曝光时刻；相机不支持时不再尝试
+static void latchDeviceClock(hik::HikCamera &camera)
+{
+    if (!g_latchSupported)
+        return;
+    uint64_t ticks = 0;
+    int64_t before = 0, after = 0;
+    if (camera.LatchDeviceTimestamp(ticks, before, after))
+    {
+        g_deviceClock.observeLatch(ticks, before, after);
+        return;
+    }
+    g_latchSupported = false;
+    HIKO_LOG(Info, "相机不支持时间戳锁存，曝光时刻按帧到达时刻估计（偏晚一个最小传输延迟）");
+}
+
+static std::string formatClockStatus()
+{
+    clockmap::DeviceClockMapper::Status status = g_deviceClock.status();
+    std::ostringstream oss;
+    if (!status.valid)
+    {
+        oss << "设备时钟: 无设备时间戳，曝光时刻取 SDK 交付时刻";
+        return oss.str();
+    }
+    oss << std::fixed << std::setprecision(2) << "设备时钟: 漂移 " << status.driftPpm << " ppm (样本 "
+        << std::setprecision(1) << status.spanS << " s) | 偏移来自 " << (status.latched ? "时间戳锁存" : "到达下包络")
+        << " | 重新估计 " << status.resets << " 次";
+    return oss.str();
+}
+
+// 分类缓存统计：命中数 / 查询数，命中即跳过一次网络推理
+static std::string formatLabelCacheStats(uint64_t hits, uint64_t lookups)
+{
+    std::ostringstream oss;
+    oss << "分类缓存命中 " << hits << "/" << lookups;
+    if (lookups > 0)
+        oss << " (" << std::fixed << std::setprecision(1) << 100.0 * hits / lookups << "%)";
+    return oss.str();
+}
+
+// Mat 内存池统计：since 为上次输出时的快照，稳定运行后本周期的系统分配次数应为 0
+static std::string formatAllocatorStats(const framealloc::PooledMatAllocator::Stats &stats,
+                                        const framealloc::PooledMatAllocator::Stats &since)
+{
+    std::ostringstream oss;
+    oss << "Mat 内存池: 分配 " << stats.allocations - since.allocations << " 次，其中系统分配 "
+        << stats.systemAllocations - since.systemAllocations << " 次，占用 " << std::fixed << std::setprecision(1)
+        << stats.reservedBytes / (1024.0 * 1024.0) << " MB";
+    return oss.str();
+}
+
+static std::string formatLoadStats(const armor::ArmorMatcher::LoadStats &stats)
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << "模型加载 " << stats.loadMs << " ms"
+        << (stats.cacheHit ? "（使用缓存）" : "") << "，预热 " << stats.warmupMs << " ms";
+    return oss.str();
+}
+
+// 命令行中与分类模型相关的设置
+struct MatcherConfig
+{
+    armor::BackendOptions backend;
+    std::string calibrationDir; // INT8 量化校准图像目录（保存的装甲板正面视图）
+    std::string firstStagePath; // 级联第一级模板文件（tools/cascade_fit 生成）
+    std::string cacheDir;       // 模型缓存目录（为空不缓存）
+    std::vector<int> warmupBatchSizes{1};
+    int warmupContexts = 1; // 加载时预热的推理上下文数，等于并发分类的线程数
+};
+
+// 在加载模型之前应用推理后端与校准设置
+static void configureMatcher(armor::ArmorMatcher &matcher, const MatcherConfig &config)
+{
+    matcher.setBackend(config.backend);
+    matcher.setModelCacheDir(config.cacheDir);
+    matcher.setWarmup(config.warmupBatchSizes, config.warmupContexts);
+    if (!config.firstStagePath.empty())
+    {
+        if (matcher.loadFirstStage(config.firstStagePath))
+            std::cout << "级联第一级已加载: " << config.firstStagePath << std::endl;
+        else
+            std::cerr << matcher.lastError() << std::endl;
+    }
+    if (config.backend.type != armor::BackendType::OpenCvInt8 || config.calibrationDir.empty())
+        return;
+    std::vector<cv::String> files;
+    cv::glob(config.calibrationDir + "/*", files, false);
+    std::vector<cv::Mat> images;
+    for (const cv::String &file : files)
+    {
+        cv::Mat image = cv::imread(file, cv::IMREAD_COLOR);
+        if (!image.empty())
+            images.push_back(image);
+    }
+    std::cout << "INT8 校准图像: " << images.size() << " 张" << std::endl;
+    matcher.setCalibrationImages(std::move(images));
 }
 
+// 流水线模式下在各阶段之间传递的帧上下文
+struct PipelineFrame
+{
+    uint64_t sequence = 0;
+    double timestamp = 0.0;                         // 曝光时刻 (s)，跟踪器的帧时间
+    std::chrono::steady_clock::time_point exposed;  // 曝光时刻，结果时延的起点
+    std::chrono::steady_clock::time_point grabbed;  // 采集完成时刻，端到端耗时的起点
+    hik::ImageData raw;                             // 原始图像（指向 rawBuffer）
+    std::vector<unsigned char> rawBuffer;           // 原始图像数据，随上下文复用
+    cv::Mat bgr;                                    // 全分辨率 BGR 图像，随上下文复用
+    DetectionFrame detection;                       // 缩放后的检测输入与各阶段结果
+    framealloc::FrameArena arena;                   // 各阶段的临时容器，上下文重新进入流水线时重置
+};
+
+// 流水线模式：采集、转换、分割、配对/PnP、分类、输出分别运行在各自的线程上，
+// 吞吐量取决于最慢的阶段而不是所有阶段耗时之和
+static void runPipelined(hik::HikCamera &camera, unsigned int deviceIndex, bool headless, PreviewThread &preview,
+                         int workers, float searchScale, const framealloc::PooledMatAllocator *matAllocator,
+                         bool allocSites)
+{
+    pipeline::FramePipeline<PipelineFrame> frames(8, 4);
+    std::atomic<uint64_t> outputFrames(0);
+    std::atomic<bool> saveRequested(false);
+    // 相机控制请求：主线程只记录，由 source（采集线程）在两次取图之间执行，
+    // 避免与取图、重连（关闭并重新创建句柄）并发访问同一相机
+    std::atomic<int> pendingExposureSteps(0);
+    std::atomic<bool> latchRequested(false);
+    // 只由保序阶段访问：tracker 由 track；分类缓存由 track（查询）与 label_store（写回），
+    // 两个阶段在不同线程上，经 labelsMutex 互斥
+    ArmorTracker tracker;
+    LabelCache labels;
+    std::mutex labelsMutex;
+    // 成功取得的帧数，与流水线随后分配的 sequence 相同，仅 source 线程访问
+    uint64_t grabbedFrames = 0;
+
+    frames.setSource([&](PipelineFrame &ctx) {
+        if (int steps = pendingExposureSteps.exchange(0))
+            applyExposureSteps(camera, steps);
+        if (latchRequested.exchange(false))
+            latchDeviceClock(camera);
+        HIKO_TIME_FRAME_ID(grabbedFrames);
+        HIKO_TIME_POINT(grabStart);
+        bool grabbed = false;
+        {
+            HIKO_ALLOC_STAGE(Grab);
+            grabbed = camera.GrabImageInto(ctx.raw, ctx.rawBuffer, 1000);
+        }
+        if (grabbed)
+        {
+            grabbedFrames++;
+            HIKO_TIME_SINCE(Grab, grabStart);
+            ctx.grabbed = std::chrono::steady_clock::now();
+            ctx.exposed = frameExposure(ctx.raw);
+            ctx.timestamp = steadySeconds(ctx.exposed);
+            return true;
+        }
+
+        // 获取图像失败，尝试重连
+        HIKO_LOG(Error, "GrabImage 失败，尝试重连...");
+        if (camera.Reconnect(deviceIndex, 5, 500))
+        {
+            HIKO_LOG(Info, "重连成功，继续采集");
+        }
+        else
+        {
+            HIKO_LOG(Error, "重连失败，短暂休眠后重试");
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return false;
+    });
+
+    frames.addStage("convert", 1, [&](PipelineFrame &ctx) {
+        HIKO_TIME_FRAME_ID(ctx.sequence);
+        // 上下文上一次携带的帧已经输出完毕
+        ctx.arena.reset();
+        ctx.detection.arena = &ctx.arena;
+        ctx.bgr.create(ctx.raw.height, ctx.raw.width, CV_8UC3);
+        bool converted = false;
+        {
+            HIKO_TIME_SCOPE(Convert);
+            HIKO_ALLOC_STAGE(Convert);
+            converted = camera.ConvertToBGR(ctx.raw, ctx.bgr.data, static_cast<unsigned int>(ctx.bgr.total() * 3));
+        }
+        if (!converted)
+        {
+            ctx.detection.frame.release();
+            return;
+        }
+        // 粗到精：在缩小后的图像上搜索灯条，角点回到全分辨率的 bgr 上精修。
+        // 缩放后的图像每帧新建，预览线程可能仍持有上一帧的引用
+        if (searchScale < 1.0f)
+        {
+            HIKO_TIME_SCOPE(Resize);
+            HIKO_ALLOC_STAGE(Resize);
+            cv::Mat scaled;
+            cv::resize(ctx.bgr, scaled, cv::Size(), searchScale, searchScale, cv::INTER_AREA);
+            ctx.detection.frame = scaled;
+            ctx.detection.fullFrame = ctx.bgr;
+            ctx.detection.scale = static_cast<float>(scaled.cols) / ctx.bgr.cols;
+        }
+        else
+        {
+            ctx.detection.frame = ctx.bgr;
+            ctx.detection.fullFrame.release();
+            ctx.detection.scale = 1.0f;
+        }
+        // 相机 binning/decimation 后的图像，PnP 按此比例换算标定内参
+        ctx.detection.sensorScaleX = ctx.raw.scaleX;
+        ctx.detection.sensorScaleY = ctx.raw.scaleY;
+        ctx.detection.keepFrontView = !headless;
+        ctx.detection.timestamp = ctx.timestamp;
+    });
+    frames.addStage("segment", workers, [](PipelineFrame &ctx) {
+        HIKO_TIME_FRAME_ID(ctx.sequence);
+        if (!ctx.detection.frame.empty())
+            detectLightBars(ctx.detection);
+    });
+    // 透视变换只依赖角点，与配对一起多线程执行
+    frames.addStage("pair", workers, [](PipelineFrame &ctx) {
+        HIKO_TIME_FRAME_ID(ctx.sequence);
+        if (ctx.detection.frame.empty())
+            return;
+        pairArmors(ctx.detection);
+        rectifyArmors(ctx.detection);
+    });
+    // 关联依赖上一帧提交后的轨迹，在单线程保序阶段按帧顺序执行：取得 trackId 与热启动位姿后解算 PnP，随即提交，
+    // 再按 trackId 查询分类缓存。提交早于分类，流水线模式下轨迹不记录分类结果
+    frames.addOrderedStage("track", [&](PipelineFrame &ctx) {
+        if (ctx.detection.frame.empty())
+            return;
+        HIKO_TIME_FRAME_ID(ctx.sequence);
+        ctx.detection.tracker = &tracker;
+        ctx.detection.labels = &labels;
+        solveArmorPoses(ctx.detection);
+        tracker.commit(ctx.detection.detections);
+        std::lock_guard<std::mutex> lock(labelsMutex);
+        lookupArmorLabels(ctx.detection);
+    });
+    // ArmorMatcher 为每个并发调用者分配独立的推理上下文，未命中缓存的装甲板在此多线程推理
+    frames.addStage("classify", workers, [](PipelineFrame &ctx) {
+        HIKO_TIME_FRAME_ID(ctx.sequence);
+        if (!ctx.detection.frame.empty())
+            inferArmors(ctx.detection);
+    });
+    // 推理结果按帧顺序写回分类缓存；查询与写回之间其它帧的查询把尚未写回的装甲板视为未命中
+    std::atomic<uint64_t> cacheHits(0), cacheLookups(0);
+    frames.addOrderedStage("label_store", [&](PipelineFrame &ctx) {
+        if (ctx.detection.frame.empty())
+            return;
+        HIKO_TIME_FRAME_ID(ctx.sequence);
+        std::lock_guard<std::mutex> lock(labelsMutex);
+        storeArmorLabels(ctx.detection);
+        LabelCache::Stats stats = labels.takeStats();
+        cacheHits.fetch_add(stats.hits, std::memory_order_relaxed);
+        cacheLookups.fetch_add(stats.lookups, std::memory_order_relaxed);
+    });
+
+    frames.setSink([&](PipelineFrame &ctx) {
+        if (ctx.detection.frame.empty())
+            return;
+        HIKO_TIME_FRAME(ctx.sequence, ctx.grabbed, ctx.detection.timing.candidateCount,
+                        ctx.detection.timing.inferenceCount);
+        outputFrames.fetch_add(1, std::memory_order_relaxed);
+
+        if (saveRequested.exchange(false))
+            saveCapture(ctx.bgr);
+
+        if (!headless)
+        {
+            DetectionDebug debug;
+            debug.binary = ctx.detection.binary;
+            debug.candidates = std::move(ctx.detection.candidates);
+            debug.scale = ctx.detection.scale;
+            debug.cameraMatrix = ctx.detection.cameraMatrix;
+            preview.publish(ctx.detection.frame, std::move(ctx.detection.detections), std::move(debug));
+            // 不缩放时预览线程持有的就是 bgr 本身，下一帧需重新分配
+            if (ctx.detection.fullFrame.empty())
+                ctx.bgr.release();
+        }
+        // 结果已发布：曝光到发布的时延
+        HIKO_TIME_SINCE(Latency, ctx.exposed);
+    });
+
+    frames.start();
+
+    auto lastPrintTime = std::chrono::steady_clock::now();
+    auto lastReportTime = lastPrintTime;
+    uint64_t lastOutputFrames = 0;
+    framealloc::PooledMatAllocator::Stats lastAllocatorStats;
+    if (matAllocator)
+        lastAllocatorStats = matAllocator->stats();
+#ifdef HIKO_FRAME_TIMING
+    frametiming::Reporter timingReporter;
+#endif
+#ifdef HIKO_ALLOC_COUNT
+    AllocReport allocReport(allocSites);
+#else
+    (void)allocSites;
+#endif
+    while (g_running)
+    {
+        int key = -1;
+        int exposureSteps = 0;
+        while (preview.pollKey(key))
+        {
+            if (handlePreviewKey(key, exposureSteps))
+                saveRequested = true;
+        }
+        if (exposureSteps != 0)
+            pendingExposureSteps.fetch_add(exposureSteps);
+
+        auto now = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPrintTime).count();
+        if (elapsed >= 1000)
+        {
+            uint64_t total = outputFrames.load(std::memory_order_relaxed);
+            float fps = (total - lastOutputFrames) * 1000.0f / elapsed;
+            HIKO_LOG(Info, "总帧数: %llu | 当前帧率: %.2f fps", static_cast<unsigned long long>(total), fps);
+            lastOutputFrames = total;
+            lastPrintTime = now;
+            latchRequested = true;
+        }
+
+        // 每 5 秒输出各阶段延迟与占用率
+        if (now - lastReportTime >= std::chrono::seconds(5))
+        {
+            HIKO_LOG(Info, "流水线阶段统计:\n%s",
+                     pipeline::FramePipeline<PipelineFrame>::formatStats(frames.takeStats()).c_str());
+            HIKO_LOG(Info, "%s", formatLabelCacheStats(cacheHits.exchange(0), cacheLookups.exchange(0)).c_str());
+            if (matAllocator)
+            {
+                framealloc::PooledMatAllocator::Stats allocatorStats = matAllocator->stats();
+                HIKO_LOG(Info, "%s", formatAllocatorStats(allocatorStats, lastAllocatorStats).c_str());
+                lastAllocatorStats = allocatorStats;
+            }
+#ifdef HIKO_FRAME_TIMING
+            HIKO_LOG(Info, "各阶段耗时分布:\n%s", frametiming::Reporter::format(timingReporter.take()).c_str());
+            HIKO_LOG(Info, "%s", formatClockStatus().c_str());
+#endif
+            lastReportTime = now;
+        }
+#ifdef HIKO_ALLOC_COUNT
+        allocReport.poll(now, outputFrames.load(std::memory_order_relaxed));
+#endif
+
+        pollTraceDump();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    frames.stop();
+}
+#endif
+
 int main(int argc, char *argv[])
 {
     // 注册信号处理
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+#ifdef SIGUSR1
+    signal(SIGUSR1, signalHandler);
+#endif
+
+    // 解析命令行：[设备索引] [--headless] [--preview-fps N] [--pipeline] [--workers N]
+    // --headless 或环境变量 HIKO_HEADLESS=1：只做检测，不创建窗口、不绘制、不打印位姿
+    // --preview-fps 或环境变量 HIKO_PREVIEW_FPS：预览窗口刷新率，与处理帧率无关
+    // --pipeline 或环境变量 HIKO_PIPELINE=1：多线程流水线模式；--workers 为分割与配对阶段的线程数
+    // --search-scale 或环境变量 HIKO_SEARCH_SCALE：灯条搜索的缩小比例（默认 0.5），角点在原图上精修
+    // --binning / --decimation 或环境变量 HIKO_BINNING / HIKO_DECIMATION：传感器端降采样（0 表示不修改相机设置）
+    // --fold-input 或环境变量 HIKO_FOLD_INPUT=1：加载模型时把三个相同的输入通道折叠进第一层卷积
+    // --backend 或环境变量 HIKO_BACKEND：推理后端 opencv / opencv-int8 / onnxruntime；
+    // --backend-threads：ONNX Runtime 单次推理的线程数；--calib-dir：INT8 量化校准图像目录
+    // --first-stage 或环境变量 HIKO_FIRST_STAGE：级联第一级模板文件，把握大时不经过网络
+    // --model-cache 或环境变量 HIKO_MODEL_CACHE：模型缓存目录；--warmup-batches：加载时预热的批大小（如 1,4，0 不预热）
+    // --watch-model 或环境变量 HIKO_WATCH_MODEL=1：模型或标签文件更新后在后台加载、预热并切换，不中断检测
+    // --trace-dir 或环境变量 HIKO_TRACE_DIR：开启逐帧追踪，按 T 键、SIGUSR1 或退出时在该目录写出 Chrome trace JSON；
+    // --trace-slow-ms 或环境变量 HIKO_TRACE_SLOW_MS：端到端耗时超过该值的帧也触发转储
+    // --no-pooled-alloc 或环境变量 HIKO_POOLED_ALLOC=0：不使用 Mat 内存池（默认启用，稳定运行后每帧不再向系统申请内存）
+    // --alloc-sites 或环境变量 HIKO_ALLOC_SITES=1：预热后采集并周期性输出仍在分配内存的调用点（需要 HIKO_ALLOC_COUNT）
+    // --log-level 或环境变量 HIKO_LOG_LEVEL：日志级别 debug / info / warn / error / off（默认 info）
+    const char *deviceArg = nullptr;
+    bool headless = false;
+    double previewFps = 30.0;
+    bool pipelined = false;
+    int pipelineWorkers = 2;
+    float searchScale = 0.5f;
+    int binning = 0;
+    int decimation = 0;
+    bool foldInput = false;
+    std::string backendName = "opencv";
+    int backendThreads = 1;
+    std::string calibrationDir;
+    std::string firstStagePath;
+    std::string modelCacheDir;
+    std::string warmupBatches = "1";
+    bool watchModel = false;
+    bool pooledAlloc = true;
+    std::string traceDir;
+    double traceSlowMs = 0.0;
+    bool allocSites = false;
+    std::string logLevel = "info";
+    if (const char *envLogLevel = std::getenv("HIKO_LOG_LEVEL"))
+    {
+        logLevel = envLogLevel;
+    }
+    if (const char *envAllocSites = std::getenv("HIKO_ALLOC_SITES"))
+    {
+        allocSites = std::string(envAllocSites) != "0";
+    }
+    if (const char *envTraceDir = std::getenv("HIKO_TRACE_DIR"))
+    {
+        traceDir = envTraceDir;
+    }
+    if (const char *envTraceSlow = std::getenv("HIKO_TRACE_SLOW_MS"))
+    {
+        traceSlowMs = std::atof(envTraceSlow);
+    }
+    if (const char *envPooledAlloc = std::getenv("HIKO_POOLED_ALLOC"))
+    {
+        pooledAlloc = std::string(envPooledAlloc) != "0";
+    }
+    if (const char *envWatchModel = std::getenv("HIKO_WATCH_MODEL"))
+    {
+        watchModel = std::string(envWatchModel) != "0";
+    }
+    if (const char *envModelCache = std::getenv("HIKO_MODEL_CACHE"))
+    {
+        modelCacheDir = envModelCache;
+    }
+    if (const char *envFirstStage = std::getenv("HIKO_FIRST_STAGE"))
+    {
+        firstStagePath = envFirstStage;
+    }
+    if (const char *envFoldInput = std::getenv("HIKO_FOLD_INPUT"))
+    {
+        foldInput = std::string(envFoldInput) != "0";
+    }
+    if (const char *envBackend = std::getenv("HIKO_BACKEND"))
+    {
+        backendName = envBackend;
+    }
+    if (const char *envBinning = std::getenv("HIKO_BINNING"))
+    {
+        binning = std::atoi(envBinning);
+    }
+    if (const char *envDecimation = std::getenv("HIKO_DECIMATION"))
+    {
+        decimation = std::atoi(envDecimation);
+    }
+    if (const char *envSearchScale = std::getenv("HIKO_SEARCH_SCALE"))
+    {
+        searchScale = static_cast<float>(std::atof(envSearchScale));
+    }
+    if (const char *envPipeline = std::getenv("HIKO_PIPELINE"))
+    {
+        pipelined = std::string(envPipeline) != "0";
+    }
+    if (const char *envHeadless = std::getenv("HIKO_HEADLESS"))
+    {
+        headless = std::string(envHeadless) != "0";
+    }
+    if (const char *envPreviewFps = std::getenv("HIKO_PREVIEW_FPS"))
+    {
+        previewFps = std::atof(envPreviewFps);
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+            headless = true;
+        else if (arg == "--preview-fps" && i + 1 < argc)
+            previewFps = std::atof(argv[++i]);
+        else if (arg == "--pipeline")
+            pipelined = true;
+        else if (arg == "--workers" && i + 1 < argc)
+            pipelineWorkers = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--search-scale" && i + 1 < argc)
+            searchScale = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--binning" && i + 1 < argc)
+            binning = std::atoi(argv[++i]);
+        else if (arg == "--decimation" && i + 1 < argc)
+            decimation = std::atoi(argv[++i]);
+        else if (arg == "--fold-input")
+            foldInput = true;
+        else if (arg == "--backend" && i + 1 < argc)
+            backendName = argv[++i];
+        else if (arg == "--backend-threads" && i + 1 < argc)
+            backendThreads = std::atoi(argv[++i]);
+        else if (arg == "--calib-dir" && i + 1 < argc)
+            calibrationDir = argv[++i];
+        else if (arg == "--first-stage" && i + 1 < argc)
+            firstStagePath = argv[++i];
+        else if (arg == "--model-cache" && i + 1 < argc)
+            modelCacheDir = argv[++i];
+        else if (arg == "--warmup-batches" && i + 1 < argc)
+            warmupBatches = argv[++i];
+        else if (arg == "--watch-model")
+            watchModel = true;
+        else if (arg == "--no-pooled-alloc")
+            pooledAlloc = false;
+        else if (arg == "--trace-dir" && i + 1 < argc)
+            traceDir = argv[++i];
+        else if (arg == "--trace-slow-ms" && i + 1 < argc)
+            traceSlowMs = std::atof(argv[++i]);
+        else if (arg == "--alloc-sites")
+            allocSites = true;
+        else if (arg == "--log-level" && i + 1 < argc)
+            logLevel = argv[++i];
+        else if (!deviceArg)
+            deviceArg = argv[i];
+    }
+    asynclog::Level level = asynclog::Level::Info;
+    if (asynclog::parseLevel(logLevel, level))
+        asynclog::setLevel(level);
+    else
+        std::cerr << "未知的日志级别: " << logLevel << "，使用 info" << std::endl;
+#ifdef USE_OPENCV
+    if (headless)
+        setRenderEnabled(false);
+    headless = !renderEnabled();
+#endif
+    if (!(searchScale > 0.0f && searchScale <= 1.0f))
+        searchScale = 0.5f;
+    if (!traceDir.empty())
+    {
+#ifdef HIKO_FRAME_TIMING
+        // 约 65536 个区间，按每帧二三十个区间计可覆盖最近两千多帧
+        trace::enable(1 << 16, traceDir);
+        trace::setSlowFrameThreshold(traceSlowMs);
+        std::cout << "逐帧追踪已开启，输出目录: " << traceDir << std::endl;
+#else
+        std::cerr << "未编译帧耗时埋点（HIKO_FRAME_TIMING），--trace-dir 无效" << std::endl;
+#endif
+    }
+    (void)traceSlowMs;
+#ifndef HIKO_ALLOC_COUNT
+    if (allocSites)
+        std::cerr << "未编译分配计数（HIKO_ALLOC_COUNT），--alloc-sites 无效" << std::endl;
+#endif
+#ifdef USE_OPENCV
+    // 在加载模型、启动任何线程之前替换默认分配器
+    const framealloc::PooledMatAllocator *matAllocator =
+        pooledAlloc ? &framealloc::installPooledMatAllocator() : nullptr;
+    MatcherConfig matcherConfig;
+    matcherConfig.backend.foldInputChannels = foldInput;
+    matcherConfig.backend.intraOpThreads = backendThreads;
+    matcherConfig.calibrationDir = calibrationDir;
+    matcherConfig.firstStagePath = firstStagePath;
+    matcherConfig.cacheDir = modelCacheDir;
+    matcherConfig.warmupBatchSizes.clear();
+    {
+        std::stringstream ss(warmupBatches);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            int batchSize = std::atoi(item.c_str());
+            if (batchSize > 0)
+                matcherConfig.warmupBatchSizes.push_back(batchSize);
+        }
+    }
+    matcherConfig.warmupContexts = pipelined ? pipelineWorkers : 1;
+    if (!armor::parseBackendType(backendName, matcherConfig.backend.type))
+        std::cerr << "未知的推理后端: " << backendName << "，使用 opencv" << std::endl;
+#else
+    (void)foldInput;
+    (void)backendThreads;
+    (void)modelCacheDir;
+    (void)warmupBatches;
+    (void)watchModel;
+    (void)pooledAlloc;
+#endif
 
     // 枚举设备
     // std::cout << "正在枚举摄像头设备..." << std::endl;
@@ -92,10 +804,15 @@ int main(int argc, char *argv[])
                 std::string labelsPathStr = "/home/skyworld/文档/hiko/labels.txt";
 
                 auto matcher = std::make_shared<armor::ArmorMatcher>();
+                configureMatcher(*matcher, matcherConfig);
                 if (matcher->loadWithLabels(modelPath.string(), labelsPathStr))
                 {
                     armor::setGlobalArmorMatcher(matcher);
-                    std::cout << "装甲板匹配模型已加载: " << modelPath << std::endl;
+                    std::cout << "装甲板匹配模型已加载: " << modelPath << " ("
+                              << armor::backendName(matcher->backendOptions().type) << ")" << std::endl;
+                    if (matcherConfig.backend.foldInputChannels)
+                        std::cout << "网络输入通道数: " << matcher->inputChannels() << std::endl;
+                    std::cout << formatLoadStats(matcher->loadStats()) << std::endl;
                     if (!labelsPathStr.empty())
                         std::cout << "使用标签文件: " << labelsPathStr << std::endl;
                 }
@@ -118,9 +835,9 @@ int main(int argc, char *argv[])
 
     // 打开第一个设备（可以通过命令行参数指定设备索引）
     unsigned int deviceIndex = 0;
-    if (argc > 1)
+    if (deviceArg)
     {
-        deviceIndex = std::atoi(argv[1]);
+        deviceIndex = std::atoi(deviceArg);
         if (deviceIndex >= devices.size())
         {
             std::cerr << "无效的设备索引: " << deviceIndex << std::endl;
@@ -130,6 +847,12 @@ int main(int argc, char *argv[])
     camera.Open(deviceIndex);
     // 打印相机能力以便调优传输参数
     camera.PrintCameraCapabilities();
+#ifdef USE_OPENCV
+    // 设备时间戳频率：GigE 相机由 GevTimestampTickFrequency 给出，USB3 相机时间戳为纳秒
+    double timestampHz = camera.GetTimestampFrequency();
+    g_deviceClock.setTicksPerSecond(timestampHz > 0 ? timestampHz : 1e9);
+    latchDeviceClock(camera);
+#endif
     // std::cout << "\n正在打开摄像头 [" << deviceIndex << "]..." << std::endl;
     // if (!camera.Open(deviceIndex)) {
     //     std::cerr << "打开摄像头失败: " << camera.GetLastError() << std::endl;
@@ -166,6 +889,7 @@ int main(int argc, char *argv[])
         std::cout << "设置增益失败，使用默认值" << std::endl;
     }
 #ifdef USE_OPENCV
+    std::unique_ptr<armor::ModelReloader> modelReloader;
     {
         namespace fs = std::filesystem;
         std::vector<fs::path> searchRoots;
@@ -202,16 +926,20 @@ int main(int argc, char *argv[])
         fs::path modelPath = "/home/skyworld/文档/hiko/model/resnet_best_embedded.fixed.onnx"; // use simplified ONNX
                                                                                                // by default
 
+        // 使用写死的绝对路径 labels.txt（便于调试）
+        std::string labelsPathStr = "/home/skyworld/文档/hiko/labels.txt";
         if (fs::exists(modelPath))
         {
-            // 使用写死的绝对路径 labels.txt（便于调试）
-            std::string labelsPathStr = "/home/skyworld/文档/hiko/labels.txt";
-
             auto matcher = std::make_shared<armor::ArmorMatcher>();
+            configureMatcher(*matcher, matcherConfig);
             if (matcher->loadWithLabels(modelPath.string(), labelsPathStr))
             {
                 armor::setGlobalArmorMatcher(matcher);
-                std::cout << "装甲板匹配模型已加载: " << modelPath << std::endl;
+                std::cout << "装甲板匹配模型已加载: " << modelPath << " ("
+                          << armor::backendName(matcher->backendOptions().type) << ")" << std::endl;
+                if (matcherConfig.backend.foldInputChannels)
+                    std::cout << "网络输入通道数: " << matcher->inputChannels() << std::endl;
+                std::cout << formatLoadStats(matcher->loadStats()) << std::endl;
                 if (!labelsPathStr.empty())
                     std::cout << "使用标签文件: " << labelsPathStr << std::endl;
             }
@@ -224,9 +952,36 @@ int main(int argc, char *argv[])
         {
             std::cerr << "未找到指定的模型，请检查 main.cpp 中的硬编码路径: " << modelPath << std::endl;
         }
+
+        if (watchModel)
+        {
+            modelReloader = std::make_unique<armor::ModelReloader>(
+                modelPath.string(), labelsPathStr,
+                [matcherConfig] {
+                    auto matcher = std::make_shared<armor::ArmorMatcher>();
+                    configureMatcher(*matcher, matcherConfig);
+                    return matcher;
+                },
+                [](bool ok, const armor::ArmorMatcher &matcher) {
+                    if (ok)
+                        HIKO_LOG(Info, "装甲板匹配模型已热更新，%s", formatLoadStats(matcher.loadStats()).c_str());
+                    else
+                        HIKO_LOG(Error, "装甲板匹配模型热更新失败，继续使用当前模型: %s", matcher.lastError().c_str());
+                });
+            modelReloader->start();
+            std::cout << "监视模型文件: " << modelPath << std::endl;
+        }
     }
 #endif
     camera.SetPixelFormat(17301515);
+    // 传感器端降采样：读出与传输的数据量按比例减少，代替软件缩放
+    if (binning > 0 && !camera.SetBinning(binning, binning))
+        std::cerr << "设置 Binning 失败: " << camera.GetLastError() << std::endl;
+    if (decimation > 0 && !camera.SetDecimation(decimation, decimation))
+        std::cerr << "设置 Decimation 失败: " << camera.GetLastError() << std::endl;
+    if (binning > 0 || decimation > 0)
+        std::cout << "输出分辨率比例: " << camera.GetResolutionScaleX() << " x " << camera.GetResolutionScaleY()
+                  << std::endl;
     // 开始采集
     std::cout << "\n开始采集图像..." << std::endl;
     if (!camera.StartGrabbing())
@@ -244,13 +999,36 @@ int main(int argc, char *argv[])
     bool firstFrame = true; // 标记第一帧
 
 #ifdef USE_OPENCV
-    // 创建窗口
-    const char *windowName = "Hikvision Camera";
-    cv::namedWindow(windowName, cv::WINDOW_NORMAL);
+    // 预览线程负责窗口创建与显示（无头模式下不启动）
+    PreviewThread preview;
+    if (!headless)
+        preview.start("Hikvision Camera", previewFps);
+    ArmorTracker tracker;
+    LabelCache labels;
+    framealloc::PooledMatAllocator::Stats lastAllocatorStats;
+    if (matAllocator)
+        lastAllocatorStats = matAllocator->stats();
 #endif
+#ifdef HIKO_FRAME_TIMING
+    // 各阶段耗时分布每 5 秒输出一次，1 秒内的样本不足以估计 p99
+    frametiming::Reporter timingReporter;
+    auto lastTimingReport = startTime;
+#endif
+#ifdef HIKO_ALLOC_COUNT
+    AllocReport allocReport(allocSites);
+#endif
+
+    // 采集期间的控制台输出都经异步日志写出，处理线程不等待终端
+    asynclog::start();
+    HIKO_LOG(Info, "\n采集中... (按 Ctrl+C 退出)\n-----------------------------------");
 
-    std::cout << "\n采集中... (按 Ctrl+C 退出)" << std::endl;
-    std::cout << "-----------------------------------" << std::endl;
+#ifdef USE_OPENCV
+    if (pipelined)
+    {
+        runPipelined(camera, deviceIndex, headless, preview, pipelineWorkers, searchScale, matAllocator, allocSites);
+        g_running = false;
+    }
+#endif
 
     // 主采集循环
     while (g_running)
@@ -258,18 +1036,26 @@ int main(int argc, char *argv[])
         hik::ImageData imageData;
 
         // 获取图像（BGR格式，便于OpenCV处理）
-        if (camera.GrabImageBGR(imageData, 1000))
+        HIKO_TIME_FRAME_ID(totalFrames);
+        HIKO_TIME_POINT(grabStart);
+        bool grabbed = false;
+        {
+            HIKO_ALLOC_STAGE(Grab);
+            grabbed = camera.GrabImageBGR(imageData, 1000);
+        }
+        if (grabbed)
         {
+            HIKO_TIME_SINCE(Grab, grabStart);
             frameCount++;
             totalFrames++;
 
             // 打印第一帧的详细信息
             if (firstFrame)
             {
-                std::cout << "\n=== 第一帧图像信息 ===" << std::endl;
-                std::cout << "分辨率: " << imageData.width << "x" << imageData.height << std::endl;
-                std::cout << "数据大小: " << imageData.dataSize << " 字节" << std::endl;
-                std::cout << "像素格式: 0x" << std::hex << imageData.pixelFormat << std::dec << std::endl;
+                HIKO_LOG(Info, "\n=== 第一帧图像信息 ===\n分辨率: %dx%d\n数据大小: %llu 字节\n像素格式: 0x%llx",
+                         static_cast<int>(imageData.width), static_cast<int>(imageData.height),
+                         static_cast<unsigned long long>(imageData.dataSize),
+                         static_cast<unsigned long long>(imageData.pixelFormat));
 
                 // 检查图像数据
                 if (imageData.data != nullptr && imageData.dataSize > 0)
@@ -282,18 +1068,18 @@ int main(int argc, char *argv[])
                         sum += imageData.data[i];
                     }
                     double avgBrightness = (double)sum / sampleCount;
-                    std::cout << "前100像素平均值: " << avgBrightness << std::endl;
+                    HIKO_LOG(Info, "前100像素平均值: %g", avgBrightness);
 
                     if (avgBrightness < 10)
                     {
-                        std::cout << "⚠️  警告: 图像非常暗，建议增加曝光时间或增益" << std::endl;
+                        HIKO_LOG(Warn, "⚠️  警告: 图像非常暗，建议增加曝光时间或增益");
                     }
                 }
                 else
                 {
-                    std::cout << "❌ 错误: 图像数据为空!" << std::endl;
+                    HIKO_LOG(Error, "❌ 错误: 图像数据为空!");
                 }
-                std::cout << "=====================\n" << std::endl;
+                HIKO_LOG(Info, "=====================\n");
                 firstFrame = false;
             }
 
@@ -305,92 +1091,89 @@ int main(int argc, char *argv[])
             if (elapsed >= 1000)
             {
                 float fps = frameCount * 1000.0f / elapsed;
-                std::cout << "总帧数: " << totalFrames << " | 当前帧率: " << std::fixed << std::setprecision(2) << fps
-                          << " fps"
-                          << " | 分辨率: " << imageData.width << "x" << imageData.height << std::endl;
+                HIKO_LOG(Info, "总帧数: %d | 当前帧率: %.2f fps | 分辨率: %dx%d", totalFrames, fps,
+                         static_cast<int>(imageData.width), static_cast<int>(imageData.height));
+#ifdef USE_OPENCV
+                LabelCache::Stats cacheStats = labels.takeStats();
+                HIKO_LOG(Info, "%s", formatLabelCacheStats(cacheStats.hits, cacheStats.lookups).c_str());
+                if (matAllocator)
+                {
+                    framealloc::PooledMatAllocator::Stats allocatorStats = matAllocator->stats();
+                    HIKO_LOG(Info, "%s", formatAllocatorStats(allocatorStats, lastAllocatorStats).c_str());
+                    lastAllocatorStats = allocatorStats;
+                }
+                latchDeviceClock(camera);
+#endif
 
                 lastPrintTime = currentTime;
                 frameCount = 0;
             }
+#ifdef HIKO_FRAME_TIMING
+            if (currentTime - lastTimingReport >= std::chrono::seconds(5))
+            {
+                HIKO_LOG(Info, "各阶段耗时分布:\n%s", frametiming::Reporter::format(timingReporter.take()).c_str());
+#ifdef USE_OPENCV
+                HIKO_LOG(Info, "%s", formatClockStatus().c_str());
+#endif
+                lastTimingReport = currentTime;
+            }
+#endif
+#ifdef HIKO_ALLOC_COUNT
+            allocReport.poll(std::chrono::steady_clock::now(), static_cast<uint64_t>(totalFrames));
+#endif
 
 #ifdef USE_OPENCV
+            // 端到端耗时从这里开始计算，不含上面的控制台输出
+            HIKO_TIME_POINT(frameArrived);
+            const std::chrono::steady_clock::time_point exposed = frameExposure(imageData);
             // 使用 OpenCV 显示图像并调用处理函数
             cv::Mat image(imageData.height, imageData.width, CV_8UC3, imageData.data);
 
-            // 克隆图像数据以避免数据失效
-            cv::Mat displayImage = image.clone();
+            // 粗到精：在缩小 searchScale 倍的图像上搜索灯条，角点在原图上亚像素精修
+            DetectionContext context;
+            context.tracker = &tracker;
+            context.timestamp = steadySeconds(exposed);
+            context.labels = &labels;
+            context.searchScale = searchScale;
+            context.sensorScaleX = imageData.scaleX;
+            context.sensorScaleY = imageData.scaleY;
 
-            // 缩放到 0.5 倍显示以节省窗口大小和渲染开销
-            cv::Mat scaled;
-            cv::resize(displayImage, scaled, cv::Size(), 0.5, 0.5, cv::INTER_LINEAR);
-
-            // 调用处理模块（处理使用缩放后的图像以降低 CPU 开销）
-            cv::Mat binaryOut, detected;
-            processFrame(scaled, binaryOut, detected);
-
-            // 确保二值图为单通道并转换为 BGR 以便并排显示
-            cv::Mat binaryBGR;
-            if (!binaryOut.empty())
+            if (headless)
             {
-                if (binaryOut.type() != CV_8UC1)
-                    cv::cvtColor(binaryOut, binaryBGR, cv::COLOR_BGR2GRAY);
-                else
-                    cv::cvtColor(binaryOut, binaryBGR, cv::COLOR_GRAY2BGR);
-            }
-            else
-            {
-                // 如果二值图为空，使用黑图占位
-                binaryBGR = cv::Mat::zeros(scaled.size(), CV_8UC3);
+                // 无头模式：只做检测，结果仅以结构化数据形式提供给下游
+                DetectionTiming frameTiming;
+                std::vector<ArmorDetection> detections = detectArmors(image, context, &frameTiming);
+                (void)detections;
+                HIKO_TIME_SINCE(Latency, exposed);
+                HIKO_TIME_FRAME(totalFrames - 1, frameArrived, frameTiming.candidateCount,
+                                frameTiming.inferenceCount);
+                pollTraceDump();
+                continue;
             }
 
-            // 如果检测结果为空，使用缩放原图作为占位
-            if (detected.empty())
-                detected = scaled.clone();
+            // 检测后将结果交给预览线程，处理线程不做任何绘制或窗口操作
+            DetectionDebug debug;
+            debug.keepFrontView = true;
+            DetectionTiming frameTiming;
+            std::vector<ArmorDetection> detections = detectArmors(image, context, &frameTiming, &debug);
+            // 不缩放时搜索图像就是相机缓冲区，交给预览线程前需要拷贝
+            cv::Mat previewFrame = debug.searchFrame.data == image.data ? image.clone() : debug.searchFrame;
+            preview.publish(previewFrame, std::move(detections), std::move(debug));
+            HIKO_TIME_SINCE(Latency, exposed);
+            HIKO_TIME_FRAME(totalFrames - 1, frameArrived, frameTiming.candidateCount, frameTiming.inferenceCount);
+            pollTraceDump();
 
-            // 创建并排显示的图像：binary | detected
-            cv::Mat combined;
-            try
+            // 处理预览线程回传的键盘事件
+            // 顺序模式下本线程就是采集线程，曝光调整直接执行
+            int key = -1;
+            int exposureSteps = 0;
+            while (preview.pollKey(key))
             {
-                cv::hconcat(binaryBGR, detected, combined);
-            }
-            catch (const cv::Exception &e)
-            {
-                // 如果合并失败，则只显示缩放图
-                combined = scaled;
-            }
-
-            cv::imshow(windowName, combined);
-
-            // 处理键盘事件
-            int key = cv::waitKey(1);
-            if (key == 27 || key == 'q' || key == 'Q')
-            { // ESC 或 Q 键退出
-                std::cout << "\n用户请求退出..." << std::endl;
-                g_running = false;
-            }
-            else if (key == 's' || key == 'S')
-            { // S 键保存图像
-                std::string filename =
-                    "capture_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + ".jpg";
-                cv::imwrite(filename, displayImage);
-                std::cout << "图像已保存: " << filename << std::endl;
-            }
-            else if (key == '+' || key == '=')
-            { // + 键增加曝光
-                float currentExposure = camera.GetExposureTime();
-                float newExposure = currentExposure * 1.5f;
-                camera.SetExposureTime(newExposure);
-                std::cout << "曝光时间: " << currentExposure << " -> " << camera.GetExposureTime() << " us"
-                          << std::endl;
-            }
-            else if (key == '-' || key == '_')
-            { // - 键减少曝光
-                float currentExposure = camera.GetExposureTime();
-                float newExposure = currentExposure / 1.5f;
-                camera.SetExposureTime(newExposure);
-                std::cout << "曝光时间: " << currentExposure << " -> " << camera.GetExposureTime() << " us"
-                          << std::endl;
+                if (handlePreviewKey(key, exposureSteps))
+                    saveCapture(image);
             }
+            if (exposureSteps != 0)
+                applyExposureSteps(camera, exposureSteps);
 #else
             // 如果没有 OpenCV，可以选择保存图像或进行其他处理
             // 这里添加一个小延时避免 CPU 占用过高
@@ -400,24 +1183,30 @@ int main(int argc, char *argv[])
         else
         {
             // 获取图像失败，尝试重连一次
-            std::cerr << "GrabImage 失败，尝试重连..." << std::endl;
+            HIKO_LOG(Error, "GrabImage 失败，尝试重连...");
             const int maxRetries = 5;
             const int retryDelayMs = 500; // ms
             if (camera.Reconnect(deviceIndex, maxRetries, retryDelayMs))
             {
-                std::cout << "重连成功，继续采集" << std::endl;
+                HIKO_LOG(Info, "重连成功，继续采集");
                 continue;
             }
             else
             {
-                std::cerr << "重连失败，短暂休眠后重试主循环" << std::endl;
+                HIKO_LOG(Error, "重连失败，短暂休眠后重试主循环");
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
         }
     }
 
-    std::cout << "\n-----------------------------------" << std::endl;
-    std::cout << "停止采集..." << std::endl;
+    if (int stopSignal = g_stopSignal.load())
+        HIKO_LOG(Info, "\nReceived signal %d, stopping...", stopSignal);
+    HIKO_LOG(Info, "\n-----------------------------------\n停止采集...");
+
+    // 退出时写出最后一段追踪
+    std::string tracePath;
+    if (trace::dumpNow(&tracePath))
+        HIKO_LOG(Info, "追踪已写出: %s", tracePath.c_str());
 
     // 停止采集
     camera.StopGrabbing();
@@ -426,9 +1215,10 @@ int main(int argc, char *argv[])
     camera.Close();
 
 #ifdef USE_OPENCV
-    cv::destroyAllWindows();
+    preview.stop();
 #endif
 
-    std::cout << "程序正常退出。" << std::endl;
+    HIKO_LOG(Info, "程序正常退出。");
+    asynclog::stop();
     return 0;
 }
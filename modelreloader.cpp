@@ -0,0 +1,100 @@
+#include "modelreloader.h"
+#include <algorithm>
+
+namespace armor
+{
+
+ModelReloader::ModelReloader(std::string modelPath, std::string labelsPath, Factory factory, Callback callback,
+                             std::chrono::milliseconds interval)
+    : modelPath_(std::move(modelPath)), labelsPath_(std::move(labelsPath)), factory_(std::move(factory)),
+      callback_(std::move(callback)), interval_(interval)
+{
+}
+
+ModelReloader::~ModelReloader()
+{
+    stop();
+}
+
+void ModelReloader::start()
+{
+    if (thread_.joinable())
+        return;
+    stopping_ = false;
+    thread_ = std::thread(&ModelReloader::run, this);
+}
+
+void ModelReloader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+ModelReloader::FileStamp ModelReloader::stamp(const std::string &path)
+{
+    FileStamp s;
+    std::error_code ec;
+    if (path.empty() || !std::filesystem::is_regular_file(path, ec))
+        return s;
+    s.mtime = std::filesystem::last_write_time(path, ec);
+    s.size = std::filesystem::file_size(path, ec);
+    s.exists = !ec;
+    return s;
+}
+
+void ModelReloader::run()
+{
+    FileStamp model = stamp(modelPath_), labels = stamp(labelsPath_);
+    bool pending = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, interval_, [this] { return stopping_; }))
+    {
+        lock.unlock();
+
+        // 只有本线程还持有的旧模型可以安全析构
+        retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                      [](const std::shared_ptr<ArmorMatcher> &m) { return m.use_count() == 1; }),
+                       retired_.end());
+
+        FileStamp currentModel = stamp(modelPath_), currentLabels = stamp(labelsPath_);
+        if (currentModel != model || currentLabels != labels)
+        {
+            // 文件仍在变化（拷贝或写入中），等下一次轮询
+            model = currentModel;
+            labels = currentLabels;
+            pending = true;
+        }
+        else if (pending && model.exists)
+        {
+            pending = false;
+            reload();
+        }
+
+        lock.lock();
+    }
+}
+
+void ModelReloader::reload()
+{
+    std::shared_ptr<ArmorMatcher> matcher = factory_();
+    if (!matcher || !matcher->loadWithLabels(modelPath_, labelsPath_))
+    {
+        if (callback_ && matcher)
+            callback_(false, *matcher);
+        return;
+    }
+
+    std::shared_ptr<ArmorMatcher> previous = setGlobalArmorMatcher(matcher);
+    if (previous)
+        retired_.push_back(std::move(previous));
+    if (callback_)
+        callback_(true, *matcher);
+}
+
+} // namespace armor
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ArmorMatcher.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace armor
+{
+
+/**
+ * @brief 分类模型热更新：后台线程轮询模型与标签文件，变化后加载、预热新模型并通过 setGlobalArmorMatcher 发布
+ *
+ * 新模型在后台线程上完整加载（含预热）后才发布，检测线程下一次 getGlobalArmorMatcher 时切换；
+ * 正在处理的帧持有旧模型的 shared_ptr，在旧模型上完成。被替换的模型在所有帧释放后由后台线程析构，
+ * 析构的耗时不落在检测线程上。加载失败时保留当前模型。
+ */
+class ModelReloader
+{
+  public:
+    /// 创建已按命令行配置好（后端、预热、缓存等）但尚未加载的分类器
+    using Factory = std::function<std::shared_ptr<ArmorMatcher>()>;
+    /// 每次尝试加载后回调（在后台线程上），ok 为 false 时 matcher 为加载失败的实例
+    using Callback = std::function<void(bool ok, const ArmorMatcher &matcher)>;
+
+    /**
+     * @param modelPath 监视的模型文件
+     * @param labelsPath 监视的标签文件，可为空
+     * @param interval 轮询间隔；文件在相邻两次轮询间不再变化才加载，避免读到正在写入的文件
+     */
+    ModelReloader(std::string modelPath, std::string labelsPath, Factory factory, Callback callback,
+                  std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+    ~ModelReloader();
+
+    ModelReloader(const ModelReloader &) = delete;
+    ModelReloader &operator=(const ModelReloader &) = delete;
+
+    /**
+     * @brief 启动后台线程；以启动时的文件状态为基准，之后的修改才触发加载
+     */
+    void start();
+    void stop();
+
+  private:
+    // 文件的修改时间与大小，文件不存在时为空
+    struct FileStamp
+    {
+        bool exists = false;
+        std::filesystem::file_time_type mtime{};
+        uintmax_t size = 0;
+
+        bool operator==(const FileStamp &other) const
+        {
+            return exists == other.exists && mtime == other.mtime && size == other.size;
+        }
+        bool operator!=(const FileStamp &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    static FileStamp stamp(const std::string &path);
+    void run();
+    void reload();
+
+    std::string modelPath_;
+    std::string labelsPath_;
+    Factory factory_;
+    Callback callback_;
+    std::chrono::milliseconds interval_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    std::vector<std::shared_ptr<ArmorMatcher>> retired_; // 已被替换、等待各帧释放的模型
+};
+
+} // namespace armor
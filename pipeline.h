@@ -0,0 +1,507 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pipeline
+{
+
+// 有界无锁 MPMC 队列（Vyukov 算法），容量向上取整为 2 的幂。
+// 仅用于传递指针等可平凡拷贝的小对象。
+template <typename T> class BoundedQueue
+{
+  public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        cells_.reset(new Cell[cap]);
+        mask_ = cap - 1;
+        for (size_t i = 0; i < cap; i++)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // 队列已满时返回 false
+    bool tryPush(const T &value)
+    {
+        Cell *cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列为空时返回 false
+    bool tryPop(T &value)
+    {
+        Cell *cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->data;
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似元素个数（并发下仅供统计使用）
+    size_t sizeApprox() const
+    {
+        size_t enq = enqueuePos_.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return mask_ + 1;
+    }
+
+  private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+// 退避等待：先自旋，再让出时间片，最后短暂休眠
+class Backoff
+{
+  public:
+    void pause()
+    {
+        if (count_ < 64)
+        {
+            ++count_;
+        }
+        else if (count_ < 128)
+        {
+            ++count_;
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void reset()
+    {
+        count_ = 0;
+    }
+
+  private:
+    int count_ = 0;
+};
+
+// 单个阶段在一个统计窗口内的数据
+struct StageStats
+{
+    std::string name;
+    int workers = 0;
+    uint64_t frames = 0;     // 处理帧数
+    double avgMs = 0.0;      // 平均处理耗时
+    double maxMs = 0.0;      // 最大处理耗时
+    double occupancy = 0.0;  // 忙碌时间 / (窗口时长 * 工作线程数)
+    size_t queueDepth = 0;   // 输入队列当前深度（acquire 为对象池中的空闲上下文数）
+    size_t queueCapacity = 0;
+};
+
+// 多阶段帧流水线：
+//   source（单线程）-> stage 1 -> ... -> stage N -> sink（单线程，按帧序号输出）
+// 普通阶段可有多个工作线程，帧可能乱序完成；保序阶段（addOrderedStage）单线程、按帧序号依次处理，
+// 用于依赖上一帧结果的跨帧状态（跟踪、分类缓存）。
+// 阶段之间通过有界无锁队列连接，队列满时上游阻塞（背压）；
+// 帧上下文对象来自预分配的对象池，池耗尽时 source 等待，因此在途帧数不超过池大小。
+// Context 需要提供 uint64_t sequence 成员，由流水线负责赋值。
+template <typename Context> class FramePipeline
+{
+  public:
+    // 返回 false 表示本次没有取到帧（例如超时），上下文将直接归还对象池
+    using SourceFn = std::function<bool(Context &)>;
+    using StageFn = std::function<void(Context &)>;
+    using SinkFn = std::function<void(Context &)>;
+
+    explicit FramePipeline(size_t poolSize = 8, size_t queueCapacity = 4)
+        : poolSize_(std::max<size_t>(poolSize, 2)), queueCapacity_(std::max<size_t>(queueCapacity, 2)),
+          freeList_(poolSize_)
+    {
+        for (size_t i = 0; i < poolSize_; i++)
+        {
+            pool_.emplace_back(new Context());
+            freeList_.tryPush(pool_.back().get());
+        }
+    }
+
+    ~FramePipeline()
+    {
+        stop();
+    }
+
+    FramePipeline(const FramePipeline &) = delete;
+    FramePipeline &operator=(const FramePipeline &) = delete;
+
+    // 对池中每个上下文执行一次初始化（必须在 start 之前调用）
+    void forEachContext(const std::function<void(Context &)> &fn)
+    {
+        for (auto &ctx : pool_)
+            fn(*ctx);
+    }
+
+    void setSource(SourceFn fn)
+    {
+        source_ = std::move(fn);
+    }
+
+    void addStage(const std::string &name, int workers, StageFn fn)
+    {
+        std::unique_ptr<Stage> stage(new Stage(name, std::max(workers, 1), queueCapacity_));
+        stage->fn = std::move(fn);
+        stages_.push_back(std::move(stage));
+    }
+
+    // 单线程阶段，每帧按 sequence 顺序处理一次（上游乱序完成的帧在此重排），fn 可以持有跨帧状态
+    void addOrderedStage(const std::string &name, StageFn fn)
+    {
+        std::unique_ptr<Stage> stage(new Stage(name, 1, queueCapacity_));
+        stage->fn = std::move(fn);
+        stage->ordered = true;
+        stages_.push_back(std::move(stage));
+    }
+
+    void setSink(SinkFn fn)
+    {
+        sink_ = std::move(fn);
+    }
+
+    bool start()
+    {
+        if (running_.load(std::memory_order_acquire) || !source_ || !sink_)
+            return false;
+
+        sourceStats_.reset(new Stage("acquire", 1, queueCapacity_));
+        sinkStats_.reset(new Stage("output", 1, queueCapacity_));
+        reorder_.assign(poolSize_, nullptr);
+        for (auto &stage : stages_)
+        {
+            stage->reorder.assign(stage->ordered ? poolSize_ : 0, nullptr);
+            stage->nextSequence = 0;
+        }
+        nextSequence_ = 0;
+        nextOutput_ = 0;
+        windowStart_ = std::chrono::steady_clock::now();
+        running_.store(true, std::memory_order_release);
+
+        threads_.emplace_back(&FramePipeline::sourceLoop, this);
+        for (size_t i = 0; i < stages_.size(); i++)
+        {
+            for (int w = 0; w < stages_[i]->workers; w++)
+                threads_.emplace_back(&FramePipeline::stageLoop, this, i);
+        }
+        threads_.emplace_back(&FramePipeline::sinkLoop, this);
+        return true;
+    }
+
+    void stop()
+    {
+        if (!running_.exchange(false, std::memory_order_acq_rel))
+            return;
+        for (auto &t : threads_)
+        {
+            if (t.joinable())
+                t.join();
+        }
+        threads_.clear();
+    }
+
+    bool isRunning() const noexcept
+    {
+        return running_.load(std::memory_order_acquire);
+    }
+
+    // 读取并清零各阶段统计（应由单一线程周期性调用）
+    std::vector<StageStats> takeStats()
+    {
+        auto now = std::chrono::steady_clock::now();
+        double windowMs = std::chrono::duration<double, std::milli>(now - windowStart_).count();
+        windowStart_ = now;
+
+        std::vector<StageStats> out;
+        if (!sourceStats_)
+            return out;
+        out.push_back(sourceStats_->take(windowMs, freeList_.sizeApprox(), poolSize_));
+        for (size_t i = 0; i < stages_.size(); i++)
+            out.push_back(stages_[i]->take(windowMs, stages_[i]->input.sizeApprox(), stages_[i]->input.capacity()));
+        out.push_back(sinkStats_->take(windowMs, output_.sizeApprox(), output_.capacity()));
+        return out;
+    }
+
+    // 将统计格式化为多行文本
+    static std::string formatStats(const std::vector<StageStats> &stats)
+    {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2);
+        for (const auto &s : stats)
+        {
+            oss << "  " << std::left << std::setw(10) << s.name << std::right << " x" << s.workers
+                << " | frames " << std::setw(5) << s.frames << " | avg " << std::setw(7) << s.avgMs << " ms | max "
+                << std::setw(7) << s.maxMs << " ms | occupancy " << std::setw(6) << s.occupancy * 100.0
+                << "% | queue " << s.queueDepth << "/" << s.queueCapacity << "\n";
+        }
+        return oss.str();
+    }
+
+  private:
+    struct Stage
+    {
+        Stage(const std::string &stageName, int workerCount, size_t queueCapacity)
+            : name(stageName), workers(workerCount), input(queueCapacity)
+        {
+        }
+
+        void record(std::chrono::steady_clock::duration elapsed)
+        {
+            uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            frames.fetch_add(1, std::memory_order_relaxed);
+            busyNs.fetch_add(ns, std::memory_order_relaxed);
+            uint64_t prev = maxNs.load(std::memory_order_relaxed);
+            while (ns > prev && !maxNs.compare_exchange_weak(prev, ns, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        StageStats take(double windowMs, size_t depth, size_t capacity)
+        {
+            StageStats s;
+            s.name = name;
+            s.workers = workers;
+            s.frames = frames.exchange(0, std::memory_order_relaxed);
+            double busyMs = busyNs.exchange(0, std::memory_order_relaxed) / 1e6;
+            s.maxMs = maxNs.exchange(0, std::memory_order_relaxed) / 1e6;
+            s.avgMs = s.frames ? busyMs / s.frames : 0.0;
+            s.occupancy = windowMs > 0.0 ? busyMs / (windowMs * workers) : 0.0;
+            s.queueDepth = depth;
+            s.queueCapacity = capacity;
+            return s;
+        }
+
+        std::string name;
+        int workers;
+        StageFn fn;
+        BoundedQueue<Context *> input;
+        bool ordered = false;
+        std::vector<Context *> reorder; // 保序阶段的重排槽位，仅该阶段的线程访问
+        uint64_t nextSequence = 0;
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> busyNs{0};
+        std::atomic<uint64_t> maxNs{0};
+    };
+
+    // 阻塞入队；流水线停止时返回 false
+    bool pushBlocking(BoundedQueue<Context *> &queue, Context *ctx)
+    {
+        Backoff backoff;
+        while (!queue.tryPush(ctx))
+        {
+            if (!running_.load(std::memory_order_acquire))
+                return false;
+            backoff.pause();
+        }
+        return true;
+    }
+
+    // 阻塞出队；流水线停止时返回 false
+    bool popBlocking(BoundedQueue<Context *> &queue, Context *&ctx)
+    {
+        Backoff backoff;
+        while (!queue.tryPop(ctx))
+        {
+            if (!running_.load(std::memory_order_acquire))
+                return false;
+            backoff.pause();
+        }
+        return true;
+    }
+
+    BoundedQueue<Context *> &queueAfter(size_t stageIndex)
+    {
+        return stageIndex + 1 < stages_.size() ? stages_[stageIndex + 1]->input : output_;
+    }
+
+    void release(Context *ctx)
+    {
+        // 空闲队列容量不小于池大小，归还总能成功
+        freeList_.tryPush(ctx);
+    }
+
+    void sourceLoop()
+    {
+        BoundedQueue<Context *> &first = stages_.empty() ? output_ : stages_.front()->input;
+        while (running_.load(std::memory_order_acquire))
+        {
+            Context *ctx = nullptr;
+            if (!popBlocking(freeList_, ctx))
+                break;
+
+            auto begin = std::chrono::steady_clock::now();
+            bool ok = source_(*ctx);
+            if (!ok)
+            {
+                release(ctx);
+                continue;
+            }
+            sourceStats_->record(std::chrono::steady_clock::now() - begin);
+
+            ctx->sequence = nextSequence_++;
+            if (!pushBlocking(first, ctx))
+                break;
+        }
+    }
+
+    void stageLoop(size_t index)
+    {
+        Stage &stage = *stages_[index];
+        BoundedQueue<Context *> &next = queueAfter(index);
+        while (running_.load(std::memory_order_acquire))
+        {
+            Context *ctx = nullptr;
+            if (!popBlocking(stage.input, ctx))
+                break;
+
+            if (!stage.ordered)
+            {
+                auto begin = std::chrono::steady_clock::now();
+                stage.fn(*ctx);
+                stage.record(std::chrono::steady_clock::now() - begin);
+                if (!pushBlocking(next, ctx))
+                    break;
+                continue;
+            }
+
+            // 与 sink 相同的重排：在途帧数不超过池大小，序号取模即为槽位
+            stage.reorder[ctx->sequence % poolSize_] = ctx;
+            for (;;)
+            {
+                Context *&slot = stage.reorder[stage.nextSequence % poolSize_];
+                if (!slot || slot->sequence != stage.nextSequence)
+                    break;
+                Context *ready = slot;
+                slot = nullptr;
+
+                auto begin = std::chrono::steady_clock::now();
+                stage.fn(*ready);
+                stage.record(std::chrono::steady_clock::now() - begin);
+
+                ++stage.nextSequence;
+                if (!pushBlocking(next, ready))
+                    return;
+            }
+        }
+    }
+
+    void sinkLoop()
+    {
+        while (running_.load(std::memory_order_acquire))
+        {
+            Context *ctx = nullptr;
+            if (!popBlocking(output_, ctx))
+                break;
+
+            // 多工作线程阶段可能乱序完成；在途帧数不超过池大小，序号取模即可作为重排槽位
+            reorder_[ctx->sequence % poolSize_] = ctx;
+            for (;;)
+            {
+                Context *&slot = reorder_[nextOutput_ % poolSize_];
+                if (!slot || slot->sequence != nextOutput_)
+                    break;
+                Context *ready = slot;
+                slot = nullptr;
+
+                auto begin = std::chrono::steady_clock::now();
+                sink_(*ready);
+                sinkStats_->record(std::chrono::steady_clock::now() - begin);
+
+                ++nextOutput_;
+                release(ready);
+            }
+        }
+    }
+
+    size_t poolSize_;
+    size_t queueCapacity_;
+    std::vector<std::unique_ptr<Context>> pool_;
+    BoundedQueue<Context *> freeList_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    BoundedQueue<Context *> output_{queueCapacity_};
+    std::unique_ptr<Stage> sourceStats_;
+    std::unique_ptr<Stage> sinkStats_;
+    std::vector<Context *> reorder_;
+
+    SourceFn source_;
+    SinkFn sink_;
+
+    std::atomic<bool> running_{false};
+    std::vector<std::thread> threads_;
+    uint64_t nextSequence_ = 0; // 仅 source 线程访问
+    uint64_t nextOutput_ = 0;   // 仅 sink 线程访问
+    std::chrono::steady_clock::time_point windowStart_;
+};
+
+} // namespace pipeline
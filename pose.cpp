@@ -0,0 +1,109 @@
+#include "pose.h"
+#include <cmath>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+// 热启动精修结果的重投影误差上限 (px)，超过则认为初值已失效
+const double WARM_START_MAX_ERROR = 2.0;
+
+vector<Point3f> makeArmorObjectPoints()
+{
+    float halfArmorWidth = ARMOR_WIDTH / 2.0;
+    float halfBarHeight = LIGHT_BAR_HEIGHT / 2.0;
+    float armorHalfHeight = halfBarHeight * 1.5f; // 装甲板延伸后的高度（延伸了 0.5 倍）
+    return {
+        Point3f(-halfArmorWidth, armorHalfHeight, 0),  // 左上
+        Point3f(halfArmorWidth, armorHalfHeight, 0),   // 右上
+        Point3f(halfArmorWidth, -armorHalfHeight, 0),  // 右下
+        Point3f(-halfArmorWidth, -armorHalfHeight, 0), // 左下
+    };
+}
+
+void finishPose(const array<Point2f, 4> &corners, const Mat &cameraMatrix, const Mat &distCoeffs, ArmorPose &pose)
+{
+    pose.distance = norm(pose.tvec);
+    pose.reprojectionError = armorReprojectionError(corners, cameraMatrix, distCoeffs, pose.rvec, pose.tvec);
+}
+} // namespace
+
+const vector<Point3f> &armorObjectPoints()
+{
+    static const vector<Point3f> points = makeArmorObjectPoints();
+    return points;
+}
+
+bool solveArmorPose(const array<Point2f, 4> &corners, const Mat &cameraMatrix, const Mat &distCoeffs,
+                    ArmorPose &pose, const ArmorPose *prior, PoseMethod method)
+{
+    const vector<Point3f> &objectPoints = armorObjectPoints();
+    // 以 Mat 头包装角点，避免每次调用构造 vector
+    Mat imagePoints(4, 1, CV_32FC2, const_cast<Point2f *>(corners.data()));
+
+    pose.valid = false;
+
+    // 热启动：以上一帧位姿为初值，LM 迭代通常 1~3 步即收敛
+    if (prior && prior->valid)
+    {
+        Vec3d rvec = prior->rvec;
+        Vec3d tvec = prior->tvec;
+        if (solvePnP(objectPoints, imagePoints, cameraMatrix, distCoeffs, rvec, tvec, true, SOLVEPNP_ITERATIVE) &&
+            tvec[2] > 0)
+        {
+            pose.rvec = rvec;
+            pose.tvec = tvec;
+            finishPose(corners, cameraMatrix, distCoeffs, pose);
+            if (pose.reprojectionError < WARM_START_MAX_ERROR)
+            {
+                pose.valid = true;
+                return true;
+            }
+        }
+    }
+
+    int flags = method == PoseMethod::Ippe ? SOLVEPNP_IPPE : SOLVEPNP_ITERATIVE;
+    Vec3d rvec, tvec;
+    if (!solvePnP(objectPoints, imagePoints, cameraMatrix, distCoeffs, rvec, tvec, false, flags))
+        return false;
+
+    pose.rvec = rvec;
+    pose.tvec = tvec;
+    finishPose(corners, cameraMatrix, distCoeffs, pose);
+    pose.valid = true;
+    return true;
+}
+
+double armorReprojectionError(const array<Point2f, 4> &corners, const Mat &cameraMatrix, const Mat &distCoeffs,
+                              const Vec3d &rvec, const Vec3d &tvec)
+{
+    array<Point2f, 4> projected;
+    Mat projectedMat(4, 1, CV_32FC2, projected.data());
+    projectPoints(armorObjectPoints(), rvec, tvec, cameraMatrix, distCoeffs, projectedMat);
+
+    double sum = 0.0;
+    for (size_t k = 0; k < corners.size(); k++)
+    {
+        Point2f d = projected[k] - corners[k];
+        sum += sqrt(d.x * d.x + d.y * d.y);
+    }
+    return sum / corners.size();
+}
+
+Mat scaleCameraMatrix(const Mat &cameraMatrix, double scaleX, double scaleY)
+{
+    if (scaleX == 1.0 && scaleY == 1.0)
+        return cameraMatrix;
+
+    // 不归一化 K(2,2)：OpenCV 的投影与 PnP 只使用 fx、fy、cx、cy，换算必须保持矩阵原有的数值，
+    // 否则 K(2,2) != 1 的标定（如 process.cpp 中的 cameraMatrix）在比例不为 1 时距离会整体缩放
+    Mat K;
+    cameraMatrix.convertTo(K, CV_64F);
+    K.at<double>(0, 0) *= scaleX;
+    K.at<double>(0, 1) *= scaleX;
+    K.at<double>(0, 2) = (K.at<double>(0, 2) + 0.5) * scaleX - 0.5;
+    K.at<double>(1, 1) *= scaleY;
+    K.at<double>(1, 2) = (K.at<double>(1, 2) + 0.5) * scaleY - 0.5;
+    return K;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// ============ 灯条物理尺寸（单位：mm，需要根据实际测量填入）============
+constexpr double LIGHT_BAR_WIDTH = 10.0;  // 灯条宽度 (mm)
+constexpr double LIGHT_BAR_HEIGHT = 50.0; // 灯条高度/长度 (mm)
+constexpr double ARMOR_WIDTH = 135.0;     // 两个灯条中心之间的距离 (mm)
+
+// PnP 解算方式
+enum class PoseMethod
+{
+    Iterative, // 每次从零开始的 SOLVEPNP_ITERATIVE（旧实现）
+    Ippe,      // 平面目标的解析解 SOLVEPNP_IPPE（装甲板为 135x75 的矩形，不满足 IPPE_SQUARE 的正方形要求）
+};
+
+// 装甲板位姿
+struct ArmorPose
+{
+    bool valid = false;
+    cv::Vec3d rvec;                  // 旋转向量
+    cv::Vec3d tvec;                  // 平移向量 (mm)
+    double distance = 0.0;           // 距离 (mm)
+    double reprojectionError = 0.0;  // 四角点平均重投影误差 (px)
+};
+
+// 装甲板四角点的 3D 坐标（物理坐标系，单位 mm），按左上、右上、右下、左下顺序；
+// 由 ARMOR_WIDTH / LIGHT_BAR_HEIGHT 一次性计算
+const std::vector<cv::Point3f> &armorObjectPoints();
+
+// 解算装甲板位姿
+// corners: 图像中的四角点（左上、右上、右下、左下）
+// prior: 可选，同一目标上一帧的位姿；提供时以其为初值做迭代精修（useExtrinsicGuess），
+//        精修结果不可信时退回 method 指定的方式
+bool solveArmorPose(const std::array<cv::Point2f, 4> &corners, const cv::Mat &cameraMatrix,
+                    const cv::Mat &distCoeffs, ArmorPose &pose, const ArmorPose *prior = nullptr,
+                    PoseMethod method = PoseMethod::Ippe);
+
+// 计算四角点的平均重投影误差 (px)
+double armorReprojectionError(const std::array<cv::Point2f, 4> &corners, const cv::Mat &cameraMatrix,
+                              const cv::Mat &distCoeffs, const cv::Vec3d &rvec, const cv::Vec3d &tvec);
+
+// 按图像相对标定分辨率的比例换算内参（像素中心对齐：c' = (c + 0.5) * s - 0.5），
+// 用于相机 binning/decimation 后的图像；不改变 K(2,2)，比例为 1 时返回原矩阵
+cv::Mat scaleCameraMatrix(const cv::Mat &cameraMatrix, double scaleX, double scaleY);
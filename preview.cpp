@@ -0,0 +1,132 @@
+#include "preview.h"
+#include "alloccount.h"
+#include "frametiming.h"
+#include "render.h"
+#include <algorithm>
+#include <chrono>
+
+PreviewThread::~PreviewThread()
+{
+    stop();
+}
+
+bool PreviewThread::start(const std::string &windowName, double previewFps)
+{
+    if (running_.load(std::memory_order_acquire))
+        return true;
+
+    windowName_ = windowName;
+    previewFps_ = previewFps > 0.0 ? previewFps : 30.0;
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread(&PreviewThread::run, this);
+    return true;
+}
+
+void PreviewThread::stop()
+{
+    if (!running_.exchange(false, std::memory_order_acq_rel))
+        return;
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void PreviewThread::publish(const cv::Mat &frame, std::vector<ArmorDetection> detections, DetectionDebug debug)
+{
+    {
+        std::lock_guard<std::mutex> lock(mailboxMutex_);
+        // 旧的未显示帧直接被覆盖（其 Mat 引用在锁外随局部变量释放）
+        std::swap(mailbox_.detections, detections);
+        std::swap(mailbox_.debug, debug);
+        mailbox_.frame = frame;
+        mailbox_.fresh = true;
+    }
+}
+
+bool PreviewThread::pollKey(int &key)
+{
+    std::lock_guard<std::mutex> lock(keyMutex_);
+    if (keys_.empty())
+        return false;
+    key = keys_.front();
+    keys_.pop_front();
+    return true;
+}
+
+void PreviewThread::run()
+{
+    // HighGUI 要求窗口的创建、显示与事件循环在同一线程
+    cv::namedWindow(windowName_, cv::WINDOW_NORMAL);
+
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / previewFps_));
+
+    Mailbox item;
+    while (running_.load(std::memory_order_acquire))
+    {
+        auto nextFrame = std::chrono::steady_clock::now() + period;
+
+        bool haveFrame = false;
+        {
+            std::lock_guard<std::mutex> lock(mailboxMutex_);
+            if (mailbox_.fresh)
+            {
+                std::swap(item.frame, mailbox_.frame);
+                std::swap(item.detections, mailbox_.detections);
+                std::swap(item.debug, mailbox_.debug);
+                mailbox_.fresh = false;
+                haveFrame = true;
+            }
+        }
+        if (haveFrame)
+        {
+            HIKO_TIME_SCOPE(Display);
+            HIKO_ALLOC_STAGE(Display);
+            renderFrame(item);
+        }
+
+        // waitKey 同时负责窗口事件循环与限速：等待到下一个预览周期
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(nextFrame -
+                                                                               std::chrono::steady_clock::now());
+        int key = cv::waitKey(std::max<int>(1, static_cast<int>(remaining.count())));
+        if (key >= 0)
+        {
+            std::lock_guard<std::mutex> lock(keyMutex_);
+            keys_.push_back(key);
+        }
+    }
+
+    cv::destroyAllWindows();
+}
+
+void PreviewThread::renderFrame(Mailbox &item)
+{
+    if (item.frame.empty())
+        return;
+
+    // 确保二值图为单通道并转换为 BGR 以便并排显示
+    cv::Mat binaryBGR;
+    if (!item.debug.binary.empty())
+        cv::cvtColor(item.debug.binary, binaryBGR, cv::COLOR_GRAY2BGR);
+    else
+        binaryBGR = cv::Mat::zeros(item.frame.size(), CV_8UC3);
+
+    cv::Mat detected = item.frame.clone();
+    renderDetections(detected, item.detections, &item.debug);
+    showArmorFrontViews(item.detections);
+    printDetections(item.detections);
+
+    // 创建并排显示的图像：binary | detected
+    cv::Mat combined;
+    try
+    {
+        cv::hconcat(binaryBGR, detected, combined);
+    }
+    catch (const cv::Exception &e)
+    {
+        // 如果合并失败，则只显示检测结果
+        combined = detected;
+    }
+
+    cv::imshow(windowName_, combined);
+}
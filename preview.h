@@ -0,0 +1,63 @@
+#pragma once
+
+#include "process.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 异步预览线程：窗口创建、绘制、imshow 与 waitKey 全部在独立线程中完成。
+// 处理线程只通过 publish() 投递最新一帧（latest-wins，不排队），
+// 键盘事件通过命令队列回传给处理线程。
+class PreviewThread
+{
+  public:
+    PreviewThread() = default;
+    ~PreviewThread();
+
+    // 启动预览线程
+    // windowName: 主窗口名称
+    // previewFps: 预览刷新率上限，与处理帧率无关
+    bool start(const std::string &windowName, double previewFps = 30.0);
+
+    // 停止预览线程并销毁窗口
+    void stop();
+
+    bool isRunning() const noexcept
+    {
+        return running_.load(std::memory_order_acquire);
+    }
+
+    // 投递最新一帧及其检测结果；若预览线程尚未取走上一帧则直接覆盖
+    // frame/debug 中的 Mat 仅增加引用计数，调用方之后不得再原地修改这些图像
+    void publish(const cv::Mat &frame, std::vector<ArmorDetection> detections, DetectionDebug debug);
+
+    // 取出一个键盘事件；没有待处理事件时返回 false
+    bool pollKey(int &key);
+
+  private:
+    struct Mailbox
+    {
+        cv::Mat frame;
+        std::vector<ArmorDetection> detections;
+        DetectionDebug debug;
+        bool fresh = false;
+    };
+
+    void run();
+    void renderFrame(Mailbox &item);
+
+    std::string windowName_;
+    double previewFps_ = 30.0;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    std::mutex mailboxMutex_;
+    Mailbox mailbox_;
+
+    std::mutex keyMutex_;
+    std::deque<int> keys_;
+};
@@ -1,8 +1,19 @@
 #include "process.h"
 #include "ArmorMatcher.h"
+#include "alloccount.h"
+#include "asynclog.h"
+#include "framealloc.h"
+#include "frametiming.h"
+#include "labelcache.h"
+#include "pose.h"
+#include "render.h"
+#include "tracker.h"
 #include "opencv2/opencv.hpp" // IWYU pragma: keep
+#include <array>
+#include <chrono>
 #include <cmath>
 #include <iostream>
+#include <memory_resource>
 #include <string>
 #include <vector>
 /*opencv.hpp包含了Opencv各模块的头文件，如高层GUI图形用户界面模块头文件highgui.hpp，图像处理模块头文件imgprogc.hpp等。所以，用"#include<opencv/opencv.hpp>"即可，达到精简代码的作用。*/
@@ -17,91 +28,16 @@ Mat cameraMatrix = (Mat_<double>(3, 3) << 2.8496, 0, 1.5937, // fx, 0, cx
 // 畸变系数 [k1, k2, p1, p2, k3]
 Mat distCoeffs = (Mat_<double>(5, 1) << 0, 0, 0, 0, 0);
 
-// ============ 灯条物理尺寸（单位：mm，需要根据实际测量填入）============
-const double LIGHT_BAR_WIDTH = 10.0;  // 灯条宽度 (mm)
-const double LIGHT_BAR_HEIGHT = 50.0; // 灯条高度/长度 (mm)
-const double ARMOR_WIDTH = 135.0;     // 两个灯条中心之间的距离 (mm)
-
-// PnP 解算结果结构体
-struct PnPResult
+namespace
 {
-    bool success;
-    Mat rvec;        // 旋转向量
-    Mat tvec;        // 平移向量
-    double distance; // 距离
-};
-
-// PnP 解算函数
-PnPResult solvePnPForArmor(const RotatedRect &leftBar, const RotatedRect &rightBar)
+double elapsedMs(chrono::steady_clock::time_point since)
 {
-    PnPResult result;
-    result.success = false;
-
-    // 定义装甲板的 3D 坐标（物理坐标系，单位 mm）
-    vector<Point3f> objectPoints;
-
-    float halfArmorWidth = ARMOR_WIDTH / 2.0;
-    float halfBarHeight = LIGHT_BAR_HEIGHT / 2.0;
-    float halfBarWidth = LIGHT_BAR_WIDTH / 2.0;
-
-    // 左灯条四个角点（逆时针顺序）
-    objectPoints.push_back(Point3f(-halfArmorWidth - halfBarWidth, halfBarHeight, 0));
-    objectPoints.push_back(Point3f(-halfArmorWidth + halfBarWidth, halfBarHeight, 0));
-    objectPoints.push_back(Point3f(-halfArmorWidth + halfBarWidth, -halfBarHeight, 0));
-    objectPoints.push_back(Point3f(-halfArmorWidth - halfBarWidth, -halfBarHeight, 0));
-
-    // 右灯条四个角点
-    objectPoints.push_back(Point3f(halfArmorWidth - halfBarWidth, halfBarHeight, 0));
-    objectPoints.push_back(Point3f(halfArmorWidth + halfBarWidth, halfBarHeight, 0));
-    objectPoints.push_back(Point3f(halfArmorWidth + halfBarWidth, -halfBarHeight, 0));
-    objectPoints.push_back(Point3f(halfArmorWidth - halfBarWidth, -halfBarHeight, 0));
-
-    // 获取图像点
-    vector<Point2f> imagePoints;
-    Point2f leftVertices[4], rightVertices[4];
-    leftBar.points(leftVertices);
-    rightBar.points(rightVertices);
-
-    // 添加左右灯条的角点
-    for (int k = 0; k < 4; k++)
-    {
-        imagePoints.push_back(leftVertices[k]);
-    }
-    for (int k = 0; k < 4; k++)
-    {
-        imagePoints.push_back(rightVertices[k]);
-    }
-
-    // 执行 PnP 解算
-    result.success = solvePnP(objectPoints, imagePoints, cameraMatrix, distCoeffs, result.rvec, result.tvec, false,
-                              SOLVEPNP_ITERATIVE);
-
-    if (result.success)
-    {
-        // 计算距离
-        result.distance = sqrt(result.tvec.at<double>(0) * result.tvec.at<double>(0) +
-                               result.tvec.at<double>(1) * result.tvec.at<double>(1) +
-                               result.tvec.at<double>(2) * result.tvec.at<double>(2));
-    }
-
-    return result;
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - since).count();
 }
 
-// 灯条结构（用直线表示）
-struct LightBar
+// 由一对灯条计算装甲板四个角点（沿灯条方向延伸后，按左上、右上、右下、左下顺序）
+bool computeArmorCorners(const LightBar &leftBar, const LightBar &rightBar, array<Point2f, 4> &corners)
 {
-    Vec4f line;        // 拟合直线 [vx, vy, x0, y0]
-    Point2f center;    // 中心点
-    Point2f endpoint1; // 端点1
-    Point2f endpoint2; // 端点2
-    float length;      // 长度
-    float angle;       // 角度（度）
-};
-
-// 透视变换：将装甲板区域变换为正面视图（沿灯条方向延伸）
-Mat warpArmorToFrontView(const Mat &frame, const LightBar &leftBar, const LightBar &rightBar)
-{
-    // 直接使用拟合直线的端点
     Point2f leftEnd1 = leftBar.endpoint1;
     Point2f leftEnd2 = leftBar.endpoint2;
     Point2f rightEnd1 = rightBar.endpoint1;
@@ -111,28 +47,18 @@ Mat warpArmorToFrontView(const Mat &frame, const LightBar &leftBar, const LightB
     float leftExtension = leftBar.length / 1.5f;
     float rightExtension = rightBar.length / 1.5f;
 
-    // 计算灯条的方向向量（从端点1到端点2）
+    // 计算灯条的方向向量
     Point2f leftDir = leftEnd2 - leftEnd1;
     float leftDirLength = sqrt(leftDir.x * leftDir.x + leftDir.y * leftDir.y);
-    if (leftDirLength > 0)
-    {
-        leftDir = leftDir / leftDirLength; // 归一化
-    }
-    else
-    {
-        return Mat();
-    }
+    if (leftDirLength <= 0)
+        return false;
+    leftDir = leftDir / leftDirLength;
 
     Point2f rightDir = rightEnd2 - rightEnd1;
     float rightDirLength = sqrt(rightDir.x * rightDir.x + rightDir.y * rightDir.y);
-    if (rightDirLength > 0)
-    {
-        rightDir = rightDir / rightDirLength; // 归一化
-    }
-    else
-    {
-        return Mat();
-    }
+    if (rightDirLength <= 0)
+        return false;
+    rightDir = rightDir / rightDirLength;
 
     // 沿着灯条方向向两端延伸
     Point2f extendedLeft1 = leftEnd1 - leftDir * leftExtension;
@@ -141,154 +67,143 @@ Mat warpArmorToFrontView(const Mat &frame, const LightBar &leftBar, const LightB
     Point2f extendedRight2 = rightEnd2 + rightDir * rightExtension;
 
     // 确定上下顺序（Y坐标小的在上）
-    Point2f leftTop, leftBottom, rightTop, rightBottom;
-    if (extendedLeft1.y < extendedLeft2.y)
-    {
-        leftTop = extendedLeft1;
-        leftBottom = extendedLeft2;
-    }
-    else
-    {
-        leftTop = extendedLeft2;
-        leftBottom = extendedLeft1;
-    }
-
-    if (extendedRight1.y < extendedRight2.y)
-    {
-        rightTop = extendedRight1;
-        rightBottom = extendedRight2;
-    }
-    else
-    {
-        rightTop = extendedRight2;
-        rightBottom = extendedRight1;
-    }
-
-    // 装甲板四个角点（源点）- 按左上、右上、右下、左下顺序
-    vector<Point2f> srcPoints;
-    srcPoints.push_back(leftTop);
-    srcPoints.push_back(rightTop);
-    srcPoints.push_back(rightBottom);
-    srcPoints.push_back(leftBottom);
+    bool leftFirstOnTop = extendedLeft1.y < extendedLeft2.y;
+    bool rightFirstOnTop = extendedRight1.y < extendedRight2.y;
+    corners[0] = leftFirstOnTop ? extendedLeft1 : extendedLeft2;   // 左上
+    corners[1] = rightFirstOnTop ? extendedRight1 : extendedRight2; // 右上
+    corners[2] = rightFirstOnTop ? extendedRight2 : extendedRight1; // 右下
+    corners[3] = leftFirstOnTop ? extendedLeft2 : extendedLeft1;    // 左下
+    return true;
+}
 
-    // ========== 健壮性检查 ==========
-    // 1. 检查四个点是否在图像范围内
-    for (const auto &pt : srcPoints)
-    {
-        if (pt.x < 0 || pt.x >= frame.cols || pt.y < 0 || pt.y >= frame.rows)
-        {
-            // 如果有点超出图像范围，返回空图像
-            return Mat();
-        }
-    }
+// 灯条筛选阈值按 0.5 倍分辨率整定，粗到精模式下按实际搜索比例换算
+constexpr float kTunedSearchScale = 0.5f;
 
-    // 2. 检查四个点是否构成合法的四边形（不能共线）
-    // 计算面积，如果面积太小说明接近共线
-    float area = contourArea(srcPoints);
-    if (area < 100.0f)
-    {
-        return Mat();
-    }
+// 缩放图像坐标 -> 全分辨率坐标（像素中心对齐，与 resize 的映射一致）
+Point2f toFullResolution(Point2f p, float scale)
+{
+    return Point2f((p.x + 0.5f) / scale - 0.5f, (p.y + 0.5f) / scale - 0.5f);
+}
 
-    // 3. 检查四边形是否为凸多边形
-    if (!isContourConvex(srcPoints))
-    {
-        return Mat();
-    }
+LightBar scaleLightBar(const LightBar &bar, float scale)
+{
+    LightBar full = bar;
+    full.endpoint1 = toFullResolution(bar.endpoint1, scale);
+    full.endpoint2 = toFullResolution(bar.endpoint2, scale);
+    full.center = (full.endpoint1 + full.endpoint2) * 0.5f;
+    full.length = bar.length / scale;
+    full.line = Vec4f(bar.line[0], bar.line[1], full.center.x, full.center.y);
+    return full;
+}
 
-    // 目标矩形尺寸（正面视图）
-    int dstWidth = 224;
-    int dstHeight = 224;
-    vector<Point2f> dstPoints;
-    dstPoints.push_back(Point2f(0, 0));
-    dstPoints.push_back(Point2f(dstWidth - 1, 0));
-    dstPoints.push_back(Point2f(dstWidth - 1, dstHeight - 1));
-    dstPoints.push_back(Point2f(0, dstHeight - 1));
-
-    // 计算透视变换矩阵
-    Mat perspectiveMatrix;
-    try
-    {
-        perspectiveMatrix = getPerspectiveTransform(srcPoints, dstPoints);
-    }
-    catch (const cv::Exception &e)
-    {
-        // 如果透视变换矩阵计算失败，返回空图像
-        cerr << "透视变换矩阵计算失败: " << e.what() << endl;
-        return Mat();
-    }
+// 灰度图双线性采样，越界返回 -1
+float sampleBilinear(const Mat &gray, Point2f p)
+{
+    int x = static_cast<int>(floor(p.x)), y = static_cast<int>(floor(p.y));
+    if (x < 0 || y < 0 || x + 1 >= gray.cols || y + 1 >= gray.rows)
+        return -1.0f;
+    float fx = p.x - x, fy = p.y - y;
+    const uchar *r0 = gray.ptr<uchar>(y) + x;
+    const uchar *r1 = gray.ptr<uchar>(y + 1) + x;
+    return (r0[0] * (1 - fx) + r0[1] * fx) * (1 - fy) + (r1[0] * (1 - fx) + r1[1] * fx) * fy;
+}
 
-    // 执行透视变换
-    Mat warpedArmor;
-    try
-    {
-        warpPerspective(frame, warpedArmor, perspectiveMatrix, Size(dstWidth, dstHeight));
-    }
-    catch (const cv::Exception &e)
+// 从 origin 沿 dir 以 0.25 像素步长前进，返回亮度首次降到 level 以下处的亚像素距离；未找到返回负值
+float findEdge(const Mat &gray, Point2f origin, Point2f dir, float maxDistance, float level)
+{
+    const float step = 0.25f;
+    float prev = sampleBilinear(gray, origin);
+    if (prev < level)
+        return -1.0f;
+    for (float t = step; t <= maxDistance; t += step)
     {
-        cerr << "透视变换执行失败: " << e.what() << endl;
-        return Mat();
+        float cur = sampleBilinear(gray, origin + dir * t);
+        if (cur < 0)
+            return -1.0f;
+        if (cur < level)
+            return t - step + step * (prev - level) / (prev - cur);
+        prev = cur;
     }
+    return -1.0f;
+}
 
-    // 将变换后的图像左右各 50 像素裁剪掉（当图像宽度不足 100 时，返回空图像表示失败）
-    if (warpedArmor.empty())
-        return Mat();
-
-    int w = warpedArmor.cols;
-    int h = warpedArmor.rows;
-    const int side = 50;
-    if (w <= 2 * side)
+// 在全分辨率图像上精修灯条：在粗检测位置附近取小 ROI，以超过半高亮度的像素做亮度加权矩，
+// 得到亚像素中心与主方向，再沿主方向找到亮度降到半高处的亚像素端点
+bool refineLightBar(const Mat &fullFrame, const LightBar &coarse, float scale, LightBar &refined)
+{
+    LightBar guess = scaleLightBar(coarse, scale);
+    float pad = max(4.0f, 0.25f * guess.length);
+    float minX = min(guess.endpoint1.x, guess.endpoint2.x) - pad;
+    float minY = min(guess.endpoint1.y, guess.endpoint2.y) - pad;
+    float maxX = max(guess.endpoint1.x, guess.endpoint2.x) + pad;
+    float maxY = max(guess.endpoint1.y, guess.endpoint2.y) + pad;
+    Rect roi(Point(cvFloor(minX), cvFloor(minY)), Point(cvCeil(maxX) + 1, cvCeil(maxY) + 1));
+    roi &= Rect(0, 0, fullFrame.cols, fullFrame.rows);
+    if (roi.width < 3 || roi.height < 3)
+        return false;
+
+    Mat gray;
+    cvtColor(fullFrame(roi), gray, COLOR_BGR2GRAY);
+    double minVal, maxVal;
+    minMaxLoc(gray, &minVal, &maxVal);
+    float level = static_cast<float>(0.5 * (minVal + maxVal));
+    if (maxVal - minVal < 30.0)
+        return false;
+
+    // 亮度加权矩（权重为超出半高的部分）
+    double m = 0, mx = 0, my = 0, mxx = 0, mxy = 0, myy = 0;
+    for (int y = 0; y < gray.rows; y++)
     {
-        // 宽度不足时，返回空图像以示裁剪失败
-        return Mat();
+        const uchar *row = gray.ptr<uchar>(y);
+        for (int x = 0; x < gray.cols; x++)
+        {
+            double w = row[x] - level;
+            if (w <= 0)
+                continue;
+            m += w;
+            mx += w * x;
+            my += w * y;
+            mxx += w * x * x;
+            mxy += w * x * y;
+            myy += w * y * y;
+        }
     }
-
-    // 裁剪中间区域
-    Rect midRoi(side, 0, w - 2 * side, h);
-    Mat cropped = warpedArmor(midRoi).clone();
-
-    return cropped;
+    if (m <= 0)
+        return false;
+    Point2f c(static_cast<float>(mx / m), static_cast<float>(my / m));
+    double mu20 = mxx / m - c.x * c.x, mu02 = myy / m - c.y * c.y, mu11 = mxy / m - c.x * c.y;
+    double theta = 0.5 * atan2(2 * mu11, mu20 - mu02);
+    Point2f axis(static_cast<float>(cos(theta)), static_cast<float>(sin(theta)));
+    // 与粗检测的端点顺序保持一致
+    if (axis.dot(guess.endpoint2 - guess.endpoint1) < 0)
+        axis = -axis;
+
+    float maxDistance = guess.length + pad;
+    float t1 = findEdge(gray, c, -axis, maxDistance, level);
+    float t2 = findEdge(gray, c, axis, maxDistance, level);
+    if (t1 <= 0 || t2 <= 0)
+        return false;
+
+    Point2f offset(static_cast<float>(roi.x), static_cast<float>(roi.y));
+    refined = coarse;
+    refined.endpoint1 = c - axis * t1 + offset;
+    refined.endpoint2 = c + axis * t2 + offset;
+    refined.center = (refined.endpoint1 + refined.endpoint2) * 0.5f;
+    refined.length = t1 + t2;
+    refined.angle = static_cast<float>(atan2(axis.y, axis.x) * 180.0 / CV_PI);
+    refined.line = Vec4f(axis.x, axis.y, refined.center.x, refined.center.y);
+
+    // 精修结果与粗检测差距过大时视为失败（ROI 内混入了其它亮斑）
+    Point2f shift = refined.center - guess.center;
+    if (sqrt(shift.dot(shift)) > 0.5f * guess.length || refined.length > 2.0f * guess.length ||
+        refined.length < 0.5f * guess.length)
+        return false;
+    return true;
 }
+} // namespace
 
-void processFrame(Mat &frame, Mat &binaryOut, Mat &result)
+void filterLightBars(const vector<Mat> &contours, float areaScale, vector<LightBar> &candidates)
 {
-    Mat gray, blurred;
-
-    // 转为灰度图
-    cvtColor(frame, gray, COLOR_BGR2GRAY);
-
-    // 高斯模糊，去除噪声
-    GaussianBlur(gray, blurred, Size(5, 5), 0);
-
-    // 使用亮度阈值检测灯条（不区分颜色）
-    Mat binary;
-    threshold(blurred, binary, 190, 255, THRESH_BINARY);
-
-    // ============ 增强的形态学操作：连接断裂灯条 ============
-    // 1. 大尺寸竖向闭运算：连接竖向断裂的灯条
-    Mat verticalKernel = getStructuringElement(MORPH_RECT, Size(1, 7)); // 竖向 1x7
-    morphologyEx(binary, binary, MORPH_CLOSE, verticalKernel);
-
-    // 2. 小尺寸矩形闭运算：填充小孔
-    Mat smallKernel = getStructuringElement(MORPH_RECT, Size(3, 3));
-    morphologyEx(binary, binary, MORPH_CLOSE, smallKernel);
-
-    // 3. 开运算去噪（使用更小的 kernel 避免过度腐蚀）
-    Mat openKernel = getStructuringElement(MORPH_RECT, Size(2, 2));
-    morphologyEx(binary, binary, MORPH_OPEN, openKernel);
-
-    // 输出二值图
-    binaryOut = binary;
-
-    // 查找轮廓
-    vector<vector<Point>> contours;
-    findContours(binaryOut, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-    // 复制原始帧到结果图像
-    result = frame.clone();
-
-    // 存储候选灯条（用直线表示）
-    vector<LightBar> candidates;
     for (const auto &contour : contours)
     {
         double area = contourArea(contour);
@@ -300,7 +215,7 @@ void processFrame(Mat &frame, Mat &binaryOut, Mat &result)
         double aspectRatio = max(width, height) / min(width, height);
 
         // 筛选条件：面积、长宽比（细长的灯条）
-        if (area > 50.0 && area < 5000.0 && aspectRatio > 2.5 && contour.size() >= 5)
+        if (area > 50.0 * areaScale && area < 5000.0 * areaScale && aspectRatio > 2.5 && contour.total() >= 5)
         {
             // 使用轮廓点拟合直线
             Vec4f fittedLine;
@@ -317,10 +232,11 @@ void processFrame(Mat &frame, Mat &binaryOut, Mat &result)
             float minProj = FLT_MAX;
             float maxProj = -FLT_MAX;
 
-            for (const auto &pt : contour)
+            const Point *points = contour.ptr<Point>();
+            for (size_t k = 0; k < contour.total(); k++)
             {
                 // 点到直线上的投影距离（标量投影）
-                float proj = (pt.x - x0) * vx + (pt.y - y0) * vy;
+                float proj = (points[k].x - x0) * vx + (points[k].y - y0) * vy;
                 minProj = min(minProj, proj);
                 maxProj = max(maxProj, proj);
             }
@@ -329,214 +245,458 @@ void processFrame(Mat &frame, Mat &binaryOut, Mat &result)
             Point2f endpoint1(x0 + minProj * vx, y0 + minProj * vy);
             Point2f endpoint2(x0 + maxProj * vx, y0 + maxProj * vy);
 
-            // 计算中心点和长度
-            Point2f center = (endpoint1 + endpoint2) * 0.5f;
-            float length = sqrt(pow(endpoint2.x - endpoint1.x, 2) + pow(endpoint2.y - endpoint1.y, 2));
-
-            // 计算角度（相对于水平方向）
-            float angle = atan2(vy, vx) * 180.0 / CV_PI;
-
             LightBar bar;
             bar.line = fittedLine;
-            bar.center = center;
+            bar.center = (endpoint1 + endpoint2) * 0.5f;
             bar.endpoint1 = endpoint1;
             bar.endpoint2 = endpoint2;
-            bar.length = length;
-            bar.angle = angle;
+            bar.length = (maxProj - minProj);
+            // 计算角度（相对于水平方向）
+            bar.angle = atan2(vy, vx) * 180.0 / CV_PI;
             candidates.push_back(bar);
-
-            // 绘制拟合的直线（红色）
-            line(result, endpoint1, endpoint2, Scalar(0, 0, 255), 2);
-            circle(result, center, 3, Scalar(0, 0, 255), -1);
         }
     }
+}
 
-    // 查找并绘制匹配的灯条对（绿色加粗）
-    for (int i = 0; i < candidates.size(); ++i)
+void pairLightBars(const vector<LightBar> &candidates, vector<ArmorDetection> &detections,
+                   pmr::vector<pair<size_t, size_t>> &barIndices)
+{
+    for (size_t i = 0; i < candidates.size(); ++i)
     {
-        for (int j = i + 1; j < candidates.size(); ++j)
+        for (size_t j = i + 1; j < candidates.size(); ++j)
         {
-            LightBar &bar1 = candidates[i];
-            LightBar &bar2 = candidates[j];
+            const LightBar &bar1 = candidates[i];
+            const LightBar &bar2 = candidates[j];
 
             // 计算角度差（判断两个灯条是否平行）
             double angleDiff = abs(bar1.angle - bar2.angle);
             if (angleDiff > 180)
                 angleDiff = 360 - angleDiff;
 
-            // 匹配条件：角度差小于4度
-            if (angleDiff < 6.0)
-            {
+            // 匹配条件：角度差小于6度
+            if (angleDiff >= 6.0)
+                continue;
 
-                // 绘制匹配的灯条（绿色加粗）
-                line(result, bar1.endpoint1, bar1.endpoint2, Scalar(0, 255, 0), 3);
-                line(result, bar2.endpoint1, bar2.endpoint2, Scalar(0, 255, 0), 3);
-
-                // 判断哪个灯条在左侧
-                bool bar1IsLeft = bar1.center.x < bar2.center.x;
-                LightBar &leftBar = bar1IsLeft ? bar1 : bar2;
-                LightBar &rightBar = bar1IsLeft ? bar2 : bar1;
-
-                // ============ 计算装甲板四个角点（用于 PnP 解算）============
-                // 使用与透视变换相同的逻辑来获取装甲板角点
-                Point2f leftEnd1 = leftBar.endpoint1;
-                Point2f leftEnd2 = leftBar.endpoint2;
-                Point2f rightEnd1 = rightBar.endpoint1;
-                Point2f rightEnd2 = rightBar.endpoint2;
-
-                // 计算延伸距离（灯条长度的 1/2）
-                float leftExtension = leftBar.length / 1.5f;
-                float rightExtension = rightBar.length / 1.5f;
-
-                // 计算灯条的方向向量
-                Point2f leftDir = leftEnd2 - leftEnd1;
-                float leftDirLength = sqrt(leftDir.x * leftDir.x + leftDir.y * leftDir.y);
-                if (leftDirLength > 0)
-                    leftDir = leftDir / leftDirLength;
-                else
-                    continue;
-
-                Point2f rightDir = rightEnd2 - rightEnd1;
-                float rightDirLength = sqrt(rightDir.x * rightDir.x + rightDir.y * rightDir.y);
-                if (rightDirLength > 0)
-                    rightDir = rightDir / rightDirLength;
-                else
-                    continue;
-
-                // 沿着灯条方向向两端延伸
-                Point2f extendedLeft1 = leftEnd1 - leftDir * leftExtension;
-                Point2f extendedLeft2 = leftEnd2 + leftDir * leftExtension;
-                Point2f extendedRight1 = rightEnd1 - rightDir * rightExtension;
-                Point2f extendedRight2 = rightEnd2 + rightDir * rightExtension;
-
-                // 确定上下顺序（Y坐标小的在上）
-                Point2f leftTop, leftBottom, rightTop, rightBottom;
-                if (extendedLeft1.y < extendedLeft2.y)
-                {
-                    leftTop = extendedLeft1;
-                    leftBottom = extendedLeft2;
-                }
-                else
-                {
-                    leftTop = extendedLeft2;
-                    leftBottom = extendedLeft1;
-                }
-
-                if (extendedRight1.y < extendedRight2.y)
-                {
-                    rightTop = extendedRight1;
-                    rightBottom = extendedRight2;
-                }
-                else
-                {
-                    rightTop = extendedRight2;
-                    rightBottom = extendedRight1;
-                }
-
-                // 装甲板四个角点（左上、右上、右下、左下）
-                vector<Point2f> armorCorners;
-                armorCorners.push_back(leftTop);
-                armorCorners.push_back(rightTop);
-                armorCorners.push_back(rightBottom);
-                armorCorners.push_back(leftBottom);
-
-                // ============ PnP 解算（使用装甲板四角点）============
-                // 定义装甲板的 3D 坐标（物理坐标系，单位 mm）
-                vector<Point3f> objectPoints;
-                float halfArmorWidth = ARMOR_WIDTH / 2.0;
-                float halfBarHeight = LIGHT_BAR_HEIGHT / 2.0;
-                // 装甲板延伸后的高度（灯条高度 + 延伸）
-                float armorHalfHeight = halfBarHeight * 1.5f; // 延伸了 0.5 倍
-
-                // 装甲板四个角点（按左上、右上、右下、左下顺序）
-                objectPoints.push_back(Point3f(-halfArmorWidth, armorHalfHeight, 0));  // 左上
-                objectPoints.push_back(Point3f(halfArmorWidth, armorHalfHeight, 0));   // 右上
-                objectPoints.push_back(Point3f(halfArmorWidth, -armorHalfHeight, 0));  // 右下
-                objectPoints.push_back(Point3f(-halfArmorWidth, -armorHalfHeight, 0)); // 左下
-
-                // 执行 PnP 解算
-                Mat rvec, tvec;
-                bool success = solvePnP(objectPoints, armorCorners, cameraMatrix, distCoeffs, rvec, tvec, false,
-                                        SOLVEPNP_ITERATIVE);
-
-                if (success)
-                {
-                    // 计算距离
-                    double distance =
-                        sqrt(tvec.at<double>(0) * tvec.at<double>(0) + tvec.at<double>(1) * tvec.at<double>(1) +
-                             tvec.at<double>(2) * tvec.at<double>(2));
-
-                    // 在图像上显示距离和位置信息
-                    Point2f centerPoint = (bar1.center + bar2.center) * 0.5;
-
-                    string distText = "Dist: " + to_string(int(distance)) + " mm";
-                    string posText = "X:" + to_string(int(tvec.at<double>(0))) +
-                                     " Y:" + to_string(int(tvec.at<double>(1))) +
-                                     " Z:" + to_string(int(tvec.at<double>(2)));
-
-                    putText(result, distText, Point(centerPoint.x - 50, centerPoint.y - 20), FONT_HERSHEY_SIMPLEX, 0.6,
-                            Scalar(0, 255, 255), 2);
-                    putText(result, posText, Point(centerPoint.x - 50, centerPoint.y + 5), FONT_HERSHEY_SIMPLEX, 0.5,
-                            Scalar(0, 255, 255), 1);
-
-                    // 绘制坐标系
-                    vector<Point3f> axisPoints;
-                    axisPoints.push_back(Point3f(0, 0, 0));
-                    axisPoints.push_back(Point3f(50, 0, 0)); // X轴
-                    axisPoints.push_back(Point3f(0, 50, 0)); // Y轴
-                    axisPoints.push_back(Point3f(0, 0, 50)); // Z轴
-
-                    vector<Point2f> projectedAxis;
-                    projectPoints(axisPoints, rvec, tvec, cameraMatrix, distCoeffs, projectedAxis);
-
-                    // 绘制坐标轴
-                    line(result, projectedAxis[0], projectedAxis[1], Scalar(0, 0, 255), 2); // X轴-红色
-                    line(result, projectedAxis[0], projectedAxis[2], Scalar(0, 255, 0), 2); // Y轴-绿色
-                    line(result, projectedAxis[0], projectedAxis[3], Scalar(255, 0, 0), 2); // Z轴-蓝色
-
-                    cout << "Distance: " << distance << " mm, Position: (" << tvec.at<double>(0) << ", "
-                         << tvec.at<double>(1) << ", " << tvec.at<double>(2) << ")" << endl;
-                }
-
-                // ============ 透视变换到正面视图 ============
-                Mat warpedArmor = warpArmorToFrontView(frame, leftBar, rightBar);
-
-                // 显示变换后的装甲板正面视图并尝试进行分类
-                if (!warpedArmor.empty())
-                {
-                    Mat displayArmor = warpedArmor.clone();
-                    auto matcher = armor::getGlobalArmorMatcher();
-                    if (matcher && matcher->isReady())
-                    {
-                        auto matchResult = matcher->match(warpedArmor);
-                        if (matchResult.success)
-                        {
-                            std::string matchText = std::to_string(matchResult.classId) + " (" +
-                                                    cv::format("%.2f", matchResult.confidence) + ")";
-                            putText(displayArmor, matchResult.label, Point(10, 30), FONT_HERSHEY_SIMPLEX, 0.7,
-                                    Scalar(0, 255, 0), 2);
-
-                            Point2f textAnchor = (bar1.center + bar2.center) * 0.5f;
-                            putText(result, matchResult.label, Point(textAnchor.x - 60, textAnchor.y - 40),
-                                    FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 165, 255), 2);
-                        }
-                        else
-                        {
-                            static int errorThrottle = 0;
-                            if (++errorThrottle % 120 == 0)
-                            {
-                                std::cerr << "ArmorMatcher 推理失败: " << matchResult.error << std::endl;
-                            }
-                        }
-                    }
-                    imshow("Armor Front View", displayArmor);
-                }
-
-                // 绘制连接线显示配对关系
-                line(result, bar1.center, bar2.center, Scalar(0, 255, 255), 1);
-            }
+            // 判断哪个灯条在左侧
+            bool bar1IsLeft = bar1.center.x < bar2.center.x;
+            ArmorDetection det;
+            det.leftBar = bar1IsLeft ? bar1 : bar2;
+            det.rightBar = bar1IsLeft ? bar2 : bar1;
+
+            // ============ 计算装甲板四个角点（用于 PnP 解算）============
+            if (!computeArmorCorners(det.leftBar, det.rightBar, det.corners))
+                continue;
+
+            detections.push_back(std::move(det));
+            barIndices.emplace_back(bar1IsLeft ? i : j, bar1IsLeft ? j : i);
+        }
+    }
+}
+
+void detectLightBars(DetectionFrame &state)
+{
+    auto stageStart = chrono::steady_clock::now();
+    HIKO_ALLOC_STAGE(Preprocess);
+
+    Mat gray, blurred;
+
+    // 转为灰度图
+    cvtColor(state.frame, gray, COLOR_BGR2GRAY);
+
+    // 高斯模糊，去除噪声
+    GaussianBlur(gray, blurred, Size(5, 5), 0);
+
+    // 使用亮度阈值检测灯条（不区分颜色）
+    Mat binary;
+    threshold(blurred, binary, 190, 255, THRESH_BINARY);
+
+    // ============ 增强的形态学操作：连接断裂灯条 ============
+    // 1. 大尺寸竖向闭运算：连接竖向断裂的灯条
+    static const Mat verticalKernel = getStructuringElement(MORPH_RECT, Size(1, 7)); // 竖向 1x7
+    morphologyEx(binary, binary, MORPH_CLOSE, verticalKernel);
+
+    // 2. 小尺寸矩形闭运算：填充小孔
+    static const Mat smallKernel = getStructuringElement(MORPH_RECT, Size(3, 3));
+    morphologyEx(binary, binary, MORPH_CLOSE, smallKernel);
+
+    // 3. 开运算去噪（使用更小的 kernel 避免过度腐蚀）
+    static const Mat openKernel = getStructuringElement(MORPH_RECT, Size(2, 2));
+    morphologyEx(binary, binary, MORPH_OPEN, openKernel);
+
+    state.binary = binary;
+    state.timing.preprocessMs = elapsedMs(stageStart);
+    HIKO_TIME_SINCE(Preprocess, stageStart);
+    stageStart = chrono::steady_clock::now();
+    HIKO_ALLOC_STAGE(Contours);
+
+    // 查找轮廓：轮廓点存放在 Mat 中（经由默认分配器），容器按线程复用
+    thread_local vector<Mat> contours;
+    findContours(binary, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+
+    // 面积阈值按搜索分辨率换算（仅粗到精模式，普通模式保持原阈值）
+    float areaScale = 1.0f;
+    if (!state.fullFrame.empty())
+        areaScale = (state.scale / kTunedSearchScale) * (state.scale / kTunedSearchScale);
+
+    state.candidates.clear();
+    filterLightBars(contours, areaScale, state.candidates);
+
+    state.timing.candidateCount = static_cast<int>(state.candidates.size());
+    state.timing.contourMs = elapsedMs(stageStart);
+    HIKO_TIME_SINCE(Contours, stageStart);
+}
+
+void pairArmors(DetectionFrame &state)
+{
+    auto stageStart = chrono::steady_clock::now();
+    HIKO_ALLOC_STAGE(Pairing);
+
+    // 查找匹配的灯条对
+    const vector<LightBar> &candidates = state.candidates;
+    state.detections.clear();
+    // 本阶段的临时容器从单帧内存区分配
+    pmr::memory_resource *memory = state.arena ? state.arena->resource() : pmr::get_default_resource();
+    pmr::vector<pair<size_t, size_t>> barIndices(memory); // 每个装甲板对应的（左、右）候选灯条下标
+    pairLightBars(candidates, state.detections, barIndices);
+    for (ArmorDetection &det : state.detections)
+        det.exposureTime = state.timestamp;
+
+    // ============ 全分辨率角点：粗到精模式下在原图上亚像素精修，否则按比例换算 ============
+    auto refineStart = chrono::steady_clock::now();
+    const bool refine = !state.fullFrame.empty() && state.scale != 1.0f;
+    pmr::vector<LightBar> fullBars(refine ? candidates.size() : 0, LightBar(), memory);
+    pmr::vector<char> fullBarReady(fullBars.size(), 0, memory);
+    auto fullBar = [&](size_t index) -> const LightBar & {
+        // 同一灯条可能参与多个配对，只精修一次
+        if (!fullBarReady[index])
+        {
+            if (!refineLightBar(state.fullFrame, candidates[index], state.scale, fullBars[index]))
+                fullBars[index] = scaleLightBar(candidates[index], state.scale);
+            fullBarReady[index] = 1;
+        }
+        return fullBars[index];
+    };
+    for (size_t k = 0; k < state.detections.size(); k++)
+    {
+        ArmorDetection &det = state.detections[k];
+        bool ok = refine && computeArmorCorners(fullBar(barIndices[k].first), fullBar(barIndices[k].second),
+                                                det.fullCorners);
+        if (!ok)
+        {
+            for (int c = 0; c < 4; c++)
+                det.fullCorners[c] = toFullResolution(det.corners[c], state.scale);
         }
     }
+    state.timing.refineMs = elapsedMs(refineStart);
+    state.timing.pairingMs = elapsedMs(stageStart);
+    HIKO_TIME_SINCE(Pairing, stageStart);
+}
+
+void solveArmorPoses(DetectionFrame &state)
+{
+    auto stageStart = chrono::steady_clock::now();
+
+    // ============ 轨迹关联：为每个装甲板取得稳定 ID 与上一帧位姿 ============
+    if (state.tracker)
+    {
+        HIKO_ALLOC_STAGE(Pairing);
+        state.tracker->associate(state.detections, state.timestamp);
+    }
+
+    // ============ PnP 解算（使用装甲板四角点，平面目标 IPPE；有轨迹位姿时热启动）============
+    // 内参按标定分辨率给出，相机 binning/decimation 后按比例换算
+    state.cameraMatrix = scaleCameraMatrix(cameraMatrix, state.sensorScaleX, state.sensorScaleY);
+    for (auto &det : state.detections)
+    {
+        auto pnpStart = chrono::steady_clock::now();
+        HIKO_ALLOC_STAGE(Pnp);
+        const ArmorPose *prior = state.tracker ? state.tracker->priorPose(det.trackId) : nullptr;
+        ArmorPose pose;
+        det.poseValid = solveArmorPose(det.fullCorners, state.cameraMatrix, distCoeffs, pose, prior);
+        if (det.poseValid)
+        {
+            det.rvec = pose.rvec;
+            det.tvec = pose.tvec;
+            det.distance = pose.distance;
+            det.reprojectionError = pose.reprojectionError;
+        }
+        det.pnpMs = elapsedMs(pnpStart);
+        HIKO_TIME_SINCE(Pnp, pnpStart);
+    }
+
+    state.timing.pairingMs += elapsedMs(stageStart);
+}
+
+void matchArmorPairs(DetectionFrame &state)
+{
+    pairArmors(state);
+    solveArmorPoses(state);
+}
+
+namespace
+{
+// 未加载模型时仍按默认输入尺寸生成正面视图（仅用于显示）
+const armor::ArmorMatcher &rectifierFor(const armor::ArmorMatcher *matcher)
+{
+    static const armor::ArmorMatcher defaultGeometry;
+    return matcher ? *matcher : defaultGeometry;
+}
+
+// 由角点一次透视变换直接生成网络输入与正面视图；有全分辨率原图时在原图上取图，输出尺寸固定
+bool rectifyArmor(const armor::ArmorMatcher &rectifier, const DetectionFrame &state, const ArmorDetection &det,
+                  Mat &blob, Mat &frontView)
+{
+    HIKO_TIME_SCOPE(Warp);
+    HIKO_ALLOC_STAGE(Warp);
+    const Mat &source = state.fullFrame.empty() ? state.frame : state.fullFrame;
+    const auto &quad = state.fullFrame.empty() ? det.corners : det.fullCorners;
+    return rectifier.prepareInput(source, quad, blob, frontView);
+}
+
+void inferArmor(const armor::ArmorMatcher &matcher, const Mat &blob, ArmorDetection &det, DetectionTiming &timing)
+{
+    armor::MatchResult matchResult;
+    timing.inferenceCount++;
+    {
+        HIKO_TIME_SCOPE(Inference);
+        HIKO_ALLOC_STAGE(Inference);
+        matchResult = matcher.matchBlob(blob);
+    }
+    if (matchResult.success)
+    {
+        det.classified = true;
+        det.classId = matchResult.classId;
+        det.confidence = matchResult.confidence;
+        det.label = matchResult.label;
+    }
+    else
+    {
+        HIKO_LOG_EVERY(Warn, 2000, "ArmorMatcher 推理失败: %s", matchResult.error.c_str());
+    }
+}
+
+bool canClassifyWith(const std::shared_ptr<armor::ArmorMatcher> &matcher)
+{
+    return matcher && matcher->isReady();
+}
+} // namespace
+
+void classifyArmors(DetectionFrame &state)
+{
+    auto stageStart = chrono::steady_clock::now();
+    state.timing.inferenceCount = 0;
+
+    // 本帧始终使用同一个分类器快照，热更新发布的新模型从下一帧开始生效
+    uint64_t matcherGeneration = 0;
+    auto matcher = armor::getGlobalArmorMatcher(&matcherGeneration);
+    bool canClassify = canClassifyWith(matcher);
+    LabelCache *labels = canClassify ? state.labels : nullptr;
+    if (labels)
+    {
+        labels->setModelGeneration(matcherGeneration);
+        labels->beginFrame();
+    }
+
+    // 既不推理也不保留正面视图时透视变换的结果无人使用，整个阶段跳过
+    if (!canClassify && !state.keepFrontView)
+    {
+        state.timing.classifyMs = elapsedMs(stageStart);
+        return;
+    }
+
+    const armor::ArmorMatcher &rectifier = rectifierFor(matcher.get());
+
+    // 网络输入张量与正面视图缓冲区按线程复用，尺寸不变时不再分配
+    thread_local Mat blob;
+    thread_local Mat frontView;
+
+    // ============ 由 PnP 角点一次透视变换直接生成网络输入并分类（缓存命中时跳过推理）============
+    for (auto &det : state.detections)
+    {
+        auto classifyStart = chrono::steady_clock::now();
+        bool rectified = rectifyArmor(rectifier, state, det, blob, frontView);
+        LabelTicket ticket;
+        if (rectified && canClassify && !(labels && labels->lookup(det, frontView, ticket)))
+        {
+            inferArmor(*matcher, blob, det, state.timing);
+            if (labels)
+                labels->store(det, frontView, ticket);
+        }
+        if (rectified && state.keepFrontView)
+        {
+            // 结果持有这块缓冲区，下次变换重新分配，避免覆盖已交给预览线程的图像
+            det.frontView = frontView;
+            frontView = Mat();
+        }
+        det.classifyMs = elapsedMs(classifyStart);
+    }
+
+    state.timing.classifyMs = elapsedMs(stageStart);
+}
+
+void rectifyArmors(DetectionFrame &state)
+{
+    auto stageStart = chrono::steady_clock::now();
+    state.timing.inferenceCount = 0;
+    state.matcher = armor::getGlobalArmorMatcher(&state.matcherGeneration);
+    const bool canClassify = canClassifyWith(state.matcher);
+    const armor::ArmorMatcher &rectifier = rectifierFor(state.matcher.get());
+
+    state.classifyInputs.resize(state.detections.size());
+    for (size_t i = 0; i < state.detections.size(); i++)
+    {
+        ArmorClassifyInput &input = state.classifyInputs[i];
+        input.ticket = LabelTicket();
+        input.rectified = false;
+        input.pending = false;
+        if (!canClassify && !state.keepFrontView)
+            continue;
+        auto classifyStart = chrono::steady_clock::now();
+        input.rectified = rectifyArmor(rectifier, state, state.detections[i], input.blob, input.frontView);
+        input.pending = input.rectified && canClassify;
+        state.detections[i].classifyMs = elapsedMs(classifyStart);
+    }
+
+    state.timing.classifyMs = elapsedMs(stageStart);
+}
+
+void lookupArmorLabels(DetectionFrame &state)
+{
+    if (!state.labels || !canClassifyWith(state.matcher))
+        return;
+    auto stageStart = chrono::steady_clock::now();
+    state.labels->setModelGeneration(state.matcherGeneration);
+    state.labels->beginFrame();
+    for (size_t i = 0; i < state.detections.size(); i++)
+    {
+        ArmorClassifyInput &input = state.classifyInputs[i];
+        if (input.pending && state.labels->lookup(state.detections[i], input.frontView, input.ticket))
+            input.pending = false;
+    }
+    state.timing.classifyMs += elapsedMs(stageStart);
+}
+
+void inferArmors(DetectionFrame &state)
+{
+    auto stageStart = chrono::steady_clock::now();
+    for (size_t i = 0; i < state.detections.size(); i++)
+    {
+        ArmorClassifyInput &input = state.classifyInputs[i];
+        if (!input.pending)
+            continue;
+        auto inferStart = chrono::steady_clock::now();
+        inferArmor(*state.matcher, input.blob, state.detections[i], state.timing);
+        state.detections[i].classifyMs += elapsedMs(inferStart);
+    }
+    state.timing.classifyMs += elapsedMs(stageStart);
+}
+
+void storeArmorLabels(DetectionFrame &state)
+{
+    const bool useLabels = state.labels && canClassifyWith(state.matcher);
+    for (size_t i = 0; i < state.detections.size(); i++)
+    {
+        ArmorClassifyInput &input = state.classifyInputs[i];
+        if (useLabels && input.pending)
+            state.labels->store(state.detections[i], input.frontView, input.ticket);
+        if (input.rectified && state.keepFrontView)
+        {
+            // 结果持有这块缓冲区，下次变换重新分配，避免覆盖已交给预览线程的图像
+            state.detections[i].frontView = input.frontView;
+            input.frontView = Mat();
+        }
+    }
+    // 不再持有分类器快照，热更新替换下来的旧模型随之释放
+    state.matcher.reset();
+}
+
+namespace
+{
+vector<ArmorDetection> runDetection(const Mat &frame, const DetectionContext &context, DetectionTiming *timing,
+                                    DetectionDebug *debug)
+{
+    auto frameStart = chrono::steady_clock::now();
+    // 不属于任何阶段的分配（结果容器、调试输出等）计入 Frame
+    HIKO_ALLOC_STAGE(Frame);
+
+    // 单帧内存区按线程复用，上一帧的临时容器在下一帧开始时一次性回收
+    thread_local framealloc::FrameArena arena;
+    arena.reset();
+
+    DetectionFrame state;
+    state.arena = &arena;
+    if (context.searchScale > 0.0f && context.searchScale < 1.0f)
+    {
+        // 粗到精：区域平均缩小后搜索，角点回到原图精修
+        HIKO_TIME_SCOPE(Resize);
+        HIKO_ALLOC_STAGE(Resize);
+        resize(frame, state.frame, Size(), context.searchScale, context.searchScale, INTER_AREA);
+        state.fullFrame = frame;
+        state.scale = static_cast<float>(state.frame.cols) / frame.cols;
+    }
+    else
+    {
+        state.frame = frame;
+    }
+    state.keepFrontView = debug && debug->keepFrontView;
+    state.tracker = context.tracker;
+    state.timestamp = context.timestamp;
+    state.labels = context.labels;
+    state.sensorScaleX = context.sensorScaleX;
+    state.sensorScaleY = context.sensorScaleY;
+
+    detectLightBars(state);
+    matchArmorPairs(state);
+    classifyArmors(state);
+    if (context.tracker)
+        context.tracker->commit(state.detections);
+
+    state.timing.totalMs = elapsedMs(frameStart);
+    if (timing)
+        *timing = state.timing;
+    if (debug)
+    {
+        debug->binary = state.binary;
+        debug->candidates = std::move(state.candidates);
+        debug->searchFrame = state.frame;
+        debug->scale = state.scale;
+        debug->cameraMatrix = state.cameraMatrix;
+    }
+    return std::move(state.detections);
+}
+} // namespace
+
+vector<ArmorDetection> detectArmors(const Mat &frame, DetectionTiming *timing, DetectionDebug *debug)
+{
+    return runDetection(frame, DetectionContext(), timing, debug);
+}
+
+vector<ArmorDetection> detectArmors(const Mat &frame, const DetectionContext &context, DetectionTiming *timing,
+                                    DetectionDebug *debug)
+{
+    return runDetection(frame, context, timing, debug);
+}
+
+double detectionAgeMs(const ArmorDetection &detection)
+{
+    if (detection.exposureTime <= 0.0)
+        return -1.0;
+    double now = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+    return (now - detection.exposureTime) * 1e3;
+}
+
+void processFrame(Mat &frame, Mat &binaryOut, Mat &result)
+{
+    DetectionDebug debug;
+    debug.keepFrontView = renderEnabled();
+    vector<ArmorDetection> detections = detectArmors(frame, nullptr, &debug);
+
+    binaryOut = debug.binary;
+    // 尺寸不变时复用调用方的结果缓冲区
+    frame.copyTo(result);
+    renderDetections(result, detections, &debug);
+    showArmorFrontViews(detections);
+    printDetections(detections);
 }
 
 // 把示例程序的 main 包裹起来，只有当定义了 PROCESS_MAIN 时才会编译为独立程序
@@ -1,9 +1,206 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <utility>
+#include <vector>
 
-// 处理接口：接收 BGR 彩色图像，输出二值图和带标注结果图
+class ArmorTracker;
+class LabelCache;
+namespace armor
+{
+class ArmorMatcher;
+}
+namespace framealloc
+{
+class FrameArena;
+}
+
+// 相机标定参数（定义于 process.cpp）
+extern cv::Mat cameraMatrix; // 相机内参矩阵
+extern cv::Mat distCoeffs;   // 畸变系数 [k1, k2, p1, p2, k3]
+
+// 灯条结构（用直线表示）
+struct LightBar
+{
+    cv::Vec4f line;        // 拟合直线 [vx, vy, x0, y0]
+    cv::Point2f center;    // 中心点
+    cv::Point2f endpoint1; // 端点1
+    cv::Point2f endpoint2; // 端点2
+    float length = 0.0f;   // 长度
+    float angle = 0.0f;    // 角度（度）
+};
+
+// 单个装甲板的检测结果（纯数据，不含任何绘制信息）
+struct ArmorDetection
+{
+    LightBar leftBar;
+    LightBar rightBar;
+    std::array<cv::Point2f, 4> corners;     // 检测图像中的四角点（左上、右上、右下、左下）
+    std::array<cv::Point2f, 4> fullCorners; // 全分辨率图像中的四角点，PnP 与分类使用；粗到精模式下为亚像素精修结果
+    int trackId = -1;                   // 跟踪器分配的跨帧稳定 ID，未启用跟踪时为 -1
+    double exposureTime = 0.0;          // 所在帧的时间戳 (s，steady_clock)，相机流程中为曝光时刻；0 表示未知
+
+    bool poseValid = false;
+    cv::Vec3d rvec;        // 旋转向量
+    cv::Vec3d tvec;        // 平移向量 (mm)
+    double distance = 0.0;          // 距离 (mm)
+    double reprojectionError = 0.0; // 四角点平均重投影误差 (px)
+
+    bool classified = false;
+    int classId = -1;
+    double confidence = 0.0;
+    std::string label;
+
+    cv::Mat frontView; // 透视矫正后的正面视图，仅在 DetectionDebug::keepFrontView 时保留
+
+    double pnpMs = 0.0;      // PnP 解算耗时
+    double classifyMs = 0.0; // 透视变换 + 分类耗时
+};
+
+// 单帧检测各阶段耗时（毫秒）与工作量
+struct DetectionTiming
+{
+    double preprocessMs = 0.0; // 灰度、模糊、阈值、形态学
+    double contourMs = 0.0;    // 轮廓提取与灯条拟合
+    double pairingMs = 0.0;    // 灯条配对、全分辨率精修与 PnP
+    double refineMs = 0.0;     // 其中全分辨率亚像素精修部分
+    double classifyMs = 0.0;   // 透视变换与分类
+    double totalMs = 0.0;
+    int candidateCount = 0; // 候选灯条数
+    int inferenceCount = 0; // 网络推理次数（不含分类缓存命中）
+};
+
+// 可选的调试输出，仅供渲染阶段使用；传 nullptr 时检测不会保留任何中间结果
+struct DetectionDebug
+{
+    bool keepFrontView = false;       // 是否在结果中保留正面视图
+    cv::Mat binary;                   // 形态学处理后的二值图（CV_8UC1）
+    std::vector<LightBar> candidates; // 通过筛选的全部候选灯条
+    cv::Mat searchFrame;              // 实际做灯条搜索的图像（粗到精模式下为缩小后的图像）
+    cv::Mat cameraMatrix;             // 本帧 PnP 实际使用的内参（已按相机 binning/decimation 换算）
+    float scale = 1.0f;               // searchFrame 相对输入图像的缩放比例，用于把全分辨率结果画回 searchFrame
+};
+
+// 分类缓存查询的认领凭据（见 LabelCache::lookup），推理结果据此写回同一条目
+struct LabelTicket
+{
+    uint64_t entry = 0;           // 条目编号
+    uint64_t frame = 0;           // 查询所在帧（缓存内部帧计数）
+    uint64_t modelGeneration = 0; // 查询时的分类模型发布序号
+};
+
+// 分类各步骤之间传递的单个装甲板数据，帧上下文复用时缓冲区随之复用
+struct ArmorClassifyInput
+{
+    cv::Mat blob;           // 网络输入张量
+    cv::Mat frontView;      // 正面视图
+    bool rectified = false; // 透视变换成功
+    bool pending = false;   // 需要推理（未命中分类缓存）
+    LabelTicket ticket;
+};
+
+// 分阶段检测的中间状态，流水线各阶段依次处理同一个 DetectionFrame
+struct DetectionFrame
+{
+    cv::Mat frame;                          // 灯条搜索使用的 BGR 彩色图（只读）
+    cv::Mat fullFrame;                      // 可选：全分辨率原图，设置后角点在其上做亚像素精修，分类也在其上取图
+    float scale = 1.0f;                     // frame 相对全分辨率的缩放比例（frame = resize(fullFrame, scale)）
+    float sensorScaleX = 1.0f;              // 全分辨率图像相对标定分辨率的比例（相机 binning/decimation，
+    float sensorScaleY = 1.0f;              // 见 hik::ImageData::scaleX/scaleY），PnP 按此换算内参
+    cv::Mat cameraMatrix;                   // matchArmorPairs 实际使用的内参
+    bool keepFrontView = false;             // 是否在结果中保留正面视图
+    cv::Mat binary;                         // detectLightBars 输出的二值图
+    std::vector<LightBar> candidates;       // detectLightBars 输出的候选灯条
+    std::vector<ArmorDetection> detections; // matchArmorPairs 输出，classifyArmors 补充分类结果
+    DetectionTiming timing;
+
+    // 可选的跟踪器：设置后 solveArmorPoses 在 PnP 之前做数据关联并以轨迹位姿热启动，
+    // 调用方在下一帧关联之前负责 tracker->commit(detections)（通常在 classifyArmors 之后）。要求各帧按顺序处理
+    ArmorTracker *tracker = nullptr;
+    double timestamp = 0.0; // 帧时间戳 (s，steady_clock)，供跟踪器预测使用，并写入 ArmorDetection::exposureTime
+
+    // 可选的分类缓存：设置后 classifyArmors 对位置连续、外观未变的装甲板复用上一次的分类结果
+    LabelCache *labels = nullptr;
+
+    // 分步分类（rectifyArmors ... storeArmorLabels）的中间结果：本帧的分类器快照与逐装甲板数据（下标与 detections 对应）
+    std::shared_ptr<armor::ArmorMatcher> matcher;
+    uint64_t matcherGeneration = 0;
+    std::vector<ArmorClassifyInput> classifyInputs;
+
+    // 可选的单帧内存区：各阶段的临时容器从中分配，由调用方在帧之间 reset；未设置时使用默认堆
+    framealloc::FrameArena *arena = nullptr;
+};
+
+// 阶段 1：预处理、轮廓提取与灯条拟合
+void detectLightBars(DetectionFrame &state);
+
+// 阶段 2：灯条配对、（可选）轨迹关联与 PnP 解算，等价于依次调用 pairArmors 与 solveArmorPoses
+void matchArmorPairs(DetectionFrame &state);
+
+// 阶段 2a：灯条配对与全分辨率角点精修，不访问跨帧状态，可多线程乱序执行
+void pairArmors(DetectionFrame &state);
+
+// 阶段 2b：（可选）轨迹关联与 PnP 解算；设置了 tracker 时必须按帧顺序调用
+void solveArmorPoses(DetectionFrame &state);
+
+// 阶段 3：透视变换与分类（可选地经过分类缓存），等价于依次调用下面四个步骤（中间结果不经过 classifyInputs）
+void classifyArmors(DetectionFrame &state);
+
+// 阶段 3 拆分为四步，供流水线把推理与分类缓存分开调度：
+// 3a：取分类器快照并生成网络输入与正面视图，只依赖角点，可多线程乱序执行
+void rectifyArmors(DetectionFrame &state);
+
+// 3b：（设置了 labels 时）查询分类缓存，命中的装甲板不再推理；须按帧顺序调用
+void lookupArmorLabels(DetectionFrame &state);
+
+// 3c：对未命中的装甲板做网络推理，可多线程乱序执行
+void inferArmors(DetectionFrame &state);
+
+// 3d：推理结果写回分类缓存并移交正面视图；须按帧顺序调用，各帧的 3b 与 3d 之间可以交错
+void storeArmorLabels(DetectionFrame &state);
+
+// 阶段内部的单个步骤，单独暴露供微基准计时；检测请使用上面的阶段函数
+// 候选灯条筛选：按面积（阈值乘以 areaScale）与长宽比过滤轮廓，拟合直线求端点，结果追加到 candidates
+void filterLightBars(const std::vector<cv::Mat> &contours, float areaScale, std::vector<LightBar> &candidates);
+
+// 灯条两两配对：角度差小于 6 度且能构成四角点的组合追加为装甲板（只填写灯条与 corners），
+// barIndices 同步追加每个装甲板对应的（左、右）候选灯条下标
+void pairLightBars(const std::vector<LightBar> &candidates, std::vector<ArmorDetection> &detections,
+                   std::pmr::vector<std::pair<size_t, size_t>> &barIndices);
+
+// 纯检测接口（依次执行上述三个阶段）：不绘制、不显示、不输出到控制台
+// frame: 输入 BGR 彩色图（只读）
+// timing: 可选，输出各阶段耗时
+// debug: 可选，输出二值图与候选灯条等中间结果
+std::vector<ArmorDetection> detectArmors(const cv::Mat &frame, DetectionTiming *timing = nullptr,
+                                         DetectionDebug *debug = nullptr);
+
+// 跨帧状态与粗到精参数，均为可选
+struct DetectionContext
+{
+    ArmorTracker *tracker = nullptr; // 设置后结果带稳定的 trackId，PnP 以同一轨迹上一帧的位姿热启动
+    double timestamp = 0.0;          // 帧时间戳 (s，steady_clock)，应单调递增，供跟踪器预测；相机流程中为曝光时刻
+    LabelCache *labels = nullptr;    // 分类缓存，命中时跳过网络推理
+    float searchScale = 1.0f;        // 粗到精：在按此比例缩小（区域平均）的图像上搜索灯条，再回到原图精修角点
+    float sensorScaleX = 1.0f;       // 输入图像相对 cameraMatrix 标定分辨率的比例（相机 binning/decimation）
+    float sensorScaleY = 1.0f;
+};
+
+// 带跨帧状态的检测接口；frame 为相机输出图像，cameraMatrix 按传感器全分辨率标定，
+// 相机启用 binning/decimation 时通过 sensorScaleX/Y 换算
+std::vector<ArmorDetection> detectArmors(const cv::Mat &frame, const DetectionContext &context,
+                                         DetectionTiming *timing = nullptr, DetectionDebug *debug = nullptr);
+
+// 检测结果的“年龄”：从所在帧曝光到现在的毫秒数，下游据此外推到当前时刻或丢弃过旧的结果；时间戳未知时返回 -1
+double detectionAgeMs(const ArmorDetection &detection);
+
+// 兼容接口：检测后调用渲染阶段，输出二值图和带标注结果图
 // frame: 输入 BGR 彩色图（将被只读访问）
 // binaryOut: 输出单通道二值图（CV_8UC1）
-// result: 输出带标注的彩色图（CV_8UC3）
+// result: 输出带标注的彩色图（CV_8UC3）；渲染被禁用时为原图的拷贝
 void processFrame(cv::Mat &frame, cv::Mat &binaryOut, cv::Mat &result);
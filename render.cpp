@@ -0,0 +1,167 @@
+#include "render.h"
+#include "asynclog.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+using namespace std;
+using namespace cv;
+
+#ifdef HIKO_ENABLE_RENDER
+
+namespace
+{
+std::atomic<bool> g_renderEnabled(true);
+} // namespace
+
+bool renderEnabled()
+{
+    return g_renderEnabled.load(std::memory_order_relaxed);
+}
+
+void setRenderEnabled(bool enabled)
+{
+    g_renderEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void renderDetections(Mat &canvas, const vector<ArmorDetection> &detections, const DetectionDebug *debug)
+{
+    if (!renderEnabled() || canvas.empty())
+        return;
+
+    // 绘制全部候选灯条的拟合直线（红色）
+    if (debug)
+    {
+        for (const auto &bar : debug->candidates)
+        {
+            line(canvas, bar.endpoint1, bar.endpoint2, Scalar(0, 0, 255), 2);
+            circle(canvas, bar.center, 3, Scalar(0, 0, 255), -1);
+        }
+    }
+
+    for (const auto &det : detections)
+    {
+        // 绘制匹配的灯条（绿色加粗）
+        line(canvas, det.leftBar.endpoint1, det.leftBar.endpoint2, Scalar(0, 255, 0), 3);
+        line(canvas, det.rightBar.endpoint1, det.rightBar.endpoint2, Scalar(0, 255, 0), 3);
+
+        Point2f centerPoint = (det.leftBar.center + det.rightBar.center) * 0.5f;
+
+        if (det.poseValid)
+        {
+            // 在图像上显示距离和位置信息
+            string distText = "Dist: " + to_string(int(det.distance)) + " mm";
+            string posText = "X:" + to_string(int(det.tvec[0])) + " Y:" + to_string(int(det.tvec[1])) +
+                             " Z:" + to_string(int(det.tvec[2]));
+
+            putText(canvas, distText, Point(centerPoint.x - 50, centerPoint.y - 20), FONT_HERSHEY_SIMPLEX, 0.6,
+                    Scalar(0, 255, 255), 2);
+            putText(canvas, posText, Point(centerPoint.x - 50, centerPoint.y + 5), FONT_HERSHEY_SIMPLEX, 0.5,
+                    Scalar(0, 255, 255), 1);
+
+            // 绘制坐标系
+            static const vector<Point3f> axisPoints = {
+                Point3f(0, 0, 0),
+                Point3f(50, 0, 0), // X轴
+                Point3f(0, 50, 0), // Y轴
+                Point3f(0, 0, 50), // Z轴
+            };
+            vector<Point2f> projectedAxis;
+            const Mat &K = debug && !debug->cameraMatrix.empty() ? debug->cameraMatrix : cameraMatrix;
+            projectPoints(axisPoints, det.rvec, det.tvec, K, distCoeffs, projectedAxis);
+            // 位姿对应全分辨率内参，画布为缩小后的搜索图像时换算回画布坐标
+            if (debug && debug->scale != 1.0f)
+            {
+                for (auto &p : projectedAxis)
+                    p = Point2f((p.x + 0.5f) * debug->scale - 0.5f, (p.y + 0.5f) * debug->scale - 0.5f);
+            }
+
+            line(canvas, projectedAxis[0], projectedAxis[1], Scalar(0, 0, 255), 2); // X轴-红色
+            line(canvas, projectedAxis[0], projectedAxis[2], Scalar(0, 255, 0), 2); // Y轴-绿色
+            line(canvas, projectedAxis[0], projectedAxis[3], Scalar(255, 0, 0), 2); // Z轴-蓝色
+        }
+
+        if (det.classified)
+        {
+            putText(canvas, det.label, Point(centerPoint.x - 60, centerPoint.y - 40), FONT_HERSHEY_SIMPLEX, 0.6,
+                    Scalar(0, 165, 255), 2);
+        }
+
+        if (det.trackId >= 0)
+        {
+            putText(canvas, "#" + to_string(det.trackId), Point(centerPoint.x + 30, centerPoint.y - 40),
+                    FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255, 255, 0), 2);
+        }
+
+        // 绘制连接线显示配对关系
+        line(canvas, det.leftBar.center, det.rightBar.center, Scalar(0, 255, 255), 1);
+    }
+}
+
+void showArmorFrontViews(const vector<ArmorDetection> &detections)
+{
+    if (!renderEnabled())
+        return;
+
+    // 与原实现一致：同一窗口只显示本帧最后一个有效的正面视图
+    for (auto it = detections.rbegin(); it != detections.rend(); ++it)
+    {
+        if (it->frontView.empty())
+            continue;
+        // 小尺寸网络的正面视图按整数倍放大显示
+        Mat displayArmor;
+        const int zoom = std::max(1, 224 / std::max(1, it->frontView.rows));
+        resize(it->frontView, displayArmor, Size(), zoom, zoom, INTER_NEAREST);
+        if (it->classified)
+            putText(displayArmor, it->label, Point(10, 30), FONT_HERSHEY_SIMPLEX, 0.7, Scalar(0, 255, 0), 2);
+        imshow("Armor Front View", displayArmor);
+        break;
+    }
+}
+
+void printDetections(const vector<ArmorDetection> &detections)
+{
+    if (!renderEnabled())
+        return;
+
+    // 一帧的位姿合为一条日志，每秒最多 20 条，控制台输出不会拖慢显示线程
+    char text[1024];
+    size_t length = 0;
+    for (const auto &det : detections)
+    {
+        if (!det.poseValid || length >= sizeof(text))
+            continue;
+        int n = snprintf(text + length, sizeof(text) - length, "%sDistance: %g mm, Position: (%g, %g, %g)",
+                         length > 0 ? "\n" : "", det.distance, det.tvec[0], det.tvec[1], det.tvec[2]);
+        if (n > 0)
+            length = min(length + static_cast<size_t>(n), sizeof(text));
+    }
+    if (length > 0)
+        HIKO_LOG_EVERY(Info, 50, "%s", text);
+}
+
+#else // HIKO_ENABLE_RENDER
+
+bool renderEnabled()
+{
+    return false;
+}
+
+void setRenderEnabled(bool)
+{
+}
+
+void renderDetections(Mat &, const vector<ArmorDetection> &, const DetectionDebug *)
+{
+}
+
+void showArmorFrontViews(const vector<ArmorDetection> &)
+{
+}
+
+void printDetections(const vector<ArmorDetection> &)
+{
+}
+
+#endif // HIKO_ENABLE_RENDER
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "process.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 渲染阶段：将 detectArmors 的结构化结果绘制到图像上。
+// 编译期：未定义 HIKO_ENABLE_RENDER 时所有函数均为空实现，renderEnabled() 恒为 false；
+// 运行期：可通过 setRenderEnabled(false) 关闭（例如 --headless）。
+
+// 当前是否启用渲染
+bool renderEnabled();
+
+// 运行期开关（编译期禁用时调用无效）
+void setRenderEnabled(bool enabled);
+
+// 在 canvas 上绘制候选灯条、匹配的装甲板、位姿与分类结果
+// debug: 可选，提供候选灯条以绘制未配对的灯条
+void renderDetections(cv::Mat &canvas, const std::vector<ArmorDetection> &detections,
+                      const DetectionDebug *debug = nullptr);
+
+// 在 "Armor Front View" 窗口中显示正面视图（需要检测时保留 frontView）
+void showArmorFrontViews(const std::vector<ArmorDetection> &detections);
+
+// 将每个装甲板的位姿打印到控制台
+void printDetections(const std::vector<ArmorDetection> &detections);
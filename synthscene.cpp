@@ -0,0 +1,422 @@
+#include "synthscene.h"
+#include "pose.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace synthscene
+{
+
+namespace
+{
+constexpr double kTexturePxPerMm = 2.0; // 面板纹理分辨率
+constexpr float kFrameMargin = 2.0f;    // 真值角点距图像边缘的最小距离 (px)
+constexpr int kPlaceAttempts = 50;      // 为每块装甲板寻找不重叠位置的尝试次数
+const cv::Scalar kBackground(25, 25, 25);
+const cv::Scalar kPanelColor(50, 50, 50);
+const cv::Scalar kDigitColor(150, 150, 150);
+
+double toRadians(double deg)
+{
+    return deg * CV_PI / 180.0;
+}
+
+// 物体坐标系（x 向右、y 向上、装甲板平面 z = 0，见 armorObjectPoints）到相机坐标系的旋转：
+// 先绕 x 轴翻转 180 度使装甲板正对相机且上方朝向图像上方，再依次施加俯仰与偏航
+cv::Vec3d armorRvec(double yaw, double pitch)
+{
+    const double cy = std::cos(yaw), sy = std::sin(yaw), cp = std::cos(pitch), sp = std::sin(pitch);
+    cv::Matx33d ry(cy, 0, sy, 0, 1, 0, -sy, 0, cy);
+    cv::Matx33d rx(1, 0, 0, 0, cp, -sp, 0, sp, cp);
+    cv::Matx33d flip(1, 0, 0, 0, -1, 0, 0, 0, -1);
+    cv::Vec3d rvec;
+    cv::Rodrigues(cv::Mat(ry * rx * flip), rvec);
+    return rvec;
+}
+
+bool insideFrame(const cv::Point2f &p, const cv::Size &size)
+{
+    return p.x >= kFrameMargin && p.y >= kFrameMargin && p.x <= size.width - 1 - kFrameMargin &&
+           p.y <= size.height - 1 - kFrameMargin;
+}
+
+// 灯光：暗一些的彩色光晕 + 接近白色的过曝中心（灰度高于检测阈值的只有中心部分）
+void drawLight(cv::Mat &image, const std::vector<cv::Point> &polygon, const cv::Scalar &color, int haloPx)
+{
+    const cv::Scalar halo = color * 0.5;
+    const cv::Scalar core = color * 0.35 + cv::Scalar(255, 255, 255) * 0.65;
+    cv::polylines(image, polygon, true, halo, std::max(2, haloPx), cv::LINE_AA);
+    cv::fillConvexPoly(image, polygon, core, cv::LINE_AA);
+}
+
+std::vector<cv::Point> toPolygon(const cv::Point2f *points, size_t count)
+{
+    std::vector<cv::Point> polygon;
+    polygon.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        polygon.emplace_back(cvRound(points[i].x), cvRound(points[i].y));
+    return polygon;
+}
+
+cv::Mat makeTexture(const std::string &label)
+{
+    const std::vector<cv::Point3f> &corners = armorObjectPoints();
+    const double widthMm = corners[1].x - corners[0].x;
+    const double heightMm = corners[0].y - corners[3].y;
+    cv::Mat texture(cvRound(heightMm * kTexturePxPerMm), cvRound(widthMm * kTexturePxPerMm), CV_8UC3, kPanelColor);
+    const double fontScale = texture.rows / 40.0;
+    const int thickness = std::max(2, texture.rows / 20);
+    int baseline = 0;
+    cv::Size textSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, fontScale, thickness, &baseline);
+    cv::Point origin((texture.cols - textSize.width) / 2, (texture.rows + textSize.height) / 2);
+    cv::putText(texture, label, origin, cv::FONT_HERSHEY_SIMPLEX, fontScale, kDigitColor, thickness, cv::LINE_AA);
+    return texture;
+}
+
+template <typename T> T parseNumber(const std::string &key, const std::string &value)
+{
+    size_t used = 0;
+    double parsed = std::stod(value, &used);
+    if (used != value.size())
+        throw std::invalid_argument(key);
+    return static_cast<T>(parsed);
+}
+} // namespace
+
+SceneGenerator::SceneGenerator(const SceneConfig &config)
+    : config_(config), rng_(config.seed), noiseRng_(static_cast<uint64_t>(config.seed) * 2654435761u + 1)
+{
+    if (config_.cameraMatrix.empty())
+    {
+        const double f = 0.9 * config_.resolution.width;
+        cameraMatrix_ = (cv::Mat_<double>(3, 3) << f, 0, (config_.resolution.width - 1) / 2.0, 0, f,
+                         (config_.resolution.height - 1) / 2.0, 0, 0, 1);
+    }
+    else
+    {
+        config_.cameraMatrix.convertTo(cameraMatrix_, CV_64F);
+    }
+    distCoeffs_ = cv::Mat::zeros(5, 1, CV_64F);
+
+    armors_.resize(static_cast<size_t>(std::max(0, config_.armors)));
+    for (size_t i = 0; i < armors_.size(); i++)
+    {
+        armors_[i].label = std::to_string(i % 5 + 1);
+        armors_[i].texture = makeTexture(armors_[i].label);
+        placeArmor(armors_[i]);
+    }
+
+    // 干扰灯光：长度与近处的灯条相当，约 3/4 为与竖直方向夹角在 20 度以内的亮条（能通过灯条筛选并参与配对），
+    // 其余为圆形亮斑；位置固定，渲染进背景
+    const float scale = config_.resolution.width / 1440.0f;
+    std::uniform_real_distribution<float> x(0.f, static_cast<float>(config_.resolution.width));
+    std::uniform_real_distribution<float> y(0.f, static_cast<float>(config_.resolution.height));
+    std::uniform_real_distribution<float> length(12.f * scale, 70.f * scale), aspect(4.f, 8.f), tilt(-20.f, 20.f);
+    std::uniform_real_distribution<float> radius(3.f * scale, 10.f * scale);
+    background_.create(config_.resolution, CV_8UC3);
+    background_.setTo(kBackground);
+    for (int i = 0; i < config_.clutter; i++)
+    {
+        const cv::Point2f center(x(rng_), y(rng_));
+        if (i % 4 == 3)
+        {
+            cv::circle(background_, center, cvRound(radius(rng_)),
+                       config_.barColor * 0.35 + cv::Scalar(255, 255, 255) * 0.65, cv::FILLED, cv::LINE_AA);
+            continue;
+        }
+        const float len = length(rng_);
+        const cv::RotatedRect shape(center, cv::Size2f(len / aspect(rng_), len), tilt(rng_));
+        cv::Point2f points[4];
+        shape.points(points);
+        drawLight(background_, toPolygon(points, 4), config_.barColor, cvRound(shape.size.width * 0.6f));
+    }
+}
+
+bool SceneGenerator::project(const Armor &armor, ArmorTruth &truth) const
+{
+    const float halfWidth = static_cast<float>(ARMOR_WIDTH / 2.0);
+    const float halfBar = static_cast<float>(LIGHT_BAR_HEIGHT / 2.0);
+    std::vector<cv::Point3f> objectPoints(armorObjectPoints());
+    objectPoints.insert(objectPoints.end(), {{-halfWidth, halfBar, 0},
+                                             {-halfWidth, -halfBar, 0},
+                                             {halfWidth, halfBar, 0},
+                                             {halfWidth, -halfBar, 0}});
+    truth.rvec = armorRvec(armor.yaw, armor.pitch);
+    truth.tvec = armor.position;
+    truth.distance = cv::norm(armor.position);
+    truth.label = armor.label;
+
+    std::vector<cv::Point2f> imagePoints;
+    cv::projectPoints(objectPoints, truth.rvec, truth.tvec, cameraMatrix_, distCoeffs_, imagePoints);
+    bool inside = true;
+    for (size_t i = 0; i < 4; i++)
+    {
+        truth.corners[i] = imagePoints[i];
+        truth.bars[i] = imagePoints[i + 4];
+        inside = inside && insideFrame(imagePoints[i], config_.resolution);
+    }
+    return inside;
+}
+
+bool SceneGenerator::placeArmor(Armor &armor)
+{
+    const double fx = cameraMatrix_.at<double>(0, 0), fy = cameraMatrix_.at<double>(1, 1);
+    const double cx = cameraMatrix_.at<double>(0, 2), cy = cameraMatrix_.at<double>(1, 2);
+    std::uniform_real_distribution<double> distance(config_.minDistance, std::max(config_.minDistance,
+                                                                                  config_.maxDistance));
+    std::uniform_real_distribution<double> u(0.1 * config_.resolution.width, 0.9 * config_.resolution.width);
+    std::uniform_real_distribution<double> v(0.1 * config_.resolution.height, 0.9 * config_.resolution.height);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+    // 已放置的装甲板（armors_ 中位于 armor 之前的元素）的外接矩形
+    std::vector<cv::Rect> occupied;
+    for (const Armor &other : armors_)
+    {
+        if (&other == &armor)
+            break;
+        ArmorTruth truth;
+        project(other, truth);
+        occupied.push_back(cv::boundingRect(std::vector<cv::Point2f>(truth.corners.begin(), truth.corners.end())));
+    }
+
+    bool placed = false;
+    for (int attempt = 0; attempt < kPlaceAttempts && !placed; attempt++)
+    {
+        // 在图像中随机取中心像素，按距离反投影到相机坐标系
+        const double a = (u(rng_) - cx) / fx, b = (v(rng_) - cy) / fy;
+        const double z = distance(rng_) / std::sqrt(1.0 + a * a + b * b);
+        armor.position = cv::Vec3d(a * z, b * z, z);
+        armor.yaw = toRadians(config_.maxYawDeg) * unit(rng_);
+        armor.pitch = toRadians(config_.maxPitchDeg) * unit(rng_);
+        armor.spin = toRadians(config_.spinDegPerFrame) * unit(rng_);
+        armor.move = config_.moveMmPerFrame * unit(rng_);
+
+        ArmorTruth truth;
+        if (!project(armor, truth))
+            continue;
+        const cv::Rect rect =
+            cv::boundingRect(std::vector<cv::Point2f>(truth.corners.begin(), truth.corners.end()));
+        // 留出灯条宽度的间隔，避免两块装甲板的灯条粘连
+        const int gap = cvRound(rect.width * 0.2);
+        const cv::Rect padded(rect.x - gap, rect.y - gap, rect.width + 2 * gap, rect.height + 2 * gap);
+        placed = std::none_of(occupied.begin(), occupied.end(),
+                              [&](const cv::Rect &r) { return (r & padded).area() > 0; });
+    }
+    return placed;
+}
+
+void SceneGenerator::step(Armor &armor)
+{
+    const double maxYaw = toRadians(config_.maxYawDeg);
+    armor.yaw += armor.spin;
+    if (std::fabs(armor.yaw) > maxYaw)
+    {
+        armor.yaw = std::max(-maxYaw, std::min(maxYaw, armor.yaw));
+        armor.spin = -armor.spin;
+    }
+
+    // 横向平移到图像边缘时反向
+    const cv::Vec3d previous = armor.position;
+    armor.position[0] += armor.move;
+    ArmorTruth truth;
+    if (!project(armor, truth))
+    {
+        armor.position = previous;
+        armor.move = -armor.move;
+    }
+}
+
+void SceneGenerator::render(const Armor &armor, const ArmorTruth &truth, cv::Mat &image) const
+{
+    // 面板：纹理按四角点透视变换，只在外接矩形内计算
+    const cv::Rect bounds = cv::boundingRect(std::vector<cv::Point2f>(truth.corners.begin(), truth.corners.end())) &
+                            cv::Rect(0, 0, image.cols, image.rows);
+    if (bounds.area() > 0)
+    {
+        const cv::Point2f offset(static_cast<float>(bounds.x), static_cast<float>(bounds.y));
+        const float w = static_cast<float>(armor.texture.cols), h = static_cast<float>(armor.texture.rows);
+        const cv::Point2f src[4] = {{0, 0}, {w, 0}, {w, h}, {0, h}};
+        cv::Point2f dst[4];
+        for (int i = 0; i < 4; i++)
+            dst[i] = truth.corners[i] - offset;
+        const cv::Mat homography = cv::getPerspectiveTransform(src, dst);
+        cv::Mat warped, mask;
+        cv::warpPerspective(armor.texture, warped, homography, bounds.size(), cv::INTER_LINEAR);
+        cv::warpPerspective(cv::Mat(armor.texture.size(), CV_8UC1, cv::Scalar(255)), mask, homography, bounds.size(),
+                            cv::INTER_NEAREST);
+        warped.copyTo(image(bounds), mask);
+    }
+
+    // 灯条：按物理宽度投影的四边形
+    const double pixelsPerMm = cameraMatrix_.at<double>(0, 0) / std::max(1.0, armor.position[2]);
+    const float halfBarWidth = static_cast<float>(LIGHT_BAR_WIDTH / 2.0);
+    const float halfWidth = static_cast<float>(ARMOR_WIDTH / 2.0);
+    const float halfBar = static_cast<float>(LIGHT_BAR_HEIGHT / 2.0);
+    for (float x : {-halfWidth, halfWidth})
+    {
+        std::vector<cv::Point3f> bar = {{x - halfBarWidth, halfBar, 0},
+                                        {x + halfBarWidth, halfBar, 0},
+                                        {x + halfBarWidth, -halfBar, 0},
+                                        {x - halfBarWidth, -halfBar, 0}};
+        std::vector<cv::Point2f> projected;
+        cv::projectPoints(bar, truth.rvec, truth.tvec, cameraMatrix_, distCoeffs_, projected);
+        drawLight(image, toPolygon(projected.data(), projected.size()), config_.barColor,
+                  cvRound(LIGHT_BAR_WIDTH * pixelsPerMm * 0.6));
+    }
+}
+
+void SceneGenerator::next(SceneFrame &frame)
+{
+    frame.index = index_;
+    frame.timestamp = config_.fps > 0 ? index_ / config_.fps : 0.0;
+    frame.armors.clear();
+    background_.copyTo(frame.bgr);
+
+    // 第一帧使用初始位姿，之后每帧先运动再渲染
+    if (index_ > 0)
+    {
+        for (Armor &armor : armors_)
+            step(armor);
+    }
+    index_++;
+
+    // 由远及近绘制，近处的装甲板遮挡远处的
+    std::vector<size_t> order(armors_.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return armors_[a].position[2] > armors_[b].position[2]; });
+    for (size_t i : order)
+    {
+        ArmorTruth truth;
+        const bool inside = project(armors_[i], truth);
+        render(armors_[i], truth, frame.bgr);
+        if (inside)
+            frame.armors.push_back(truth);
+    }
+
+    if (config_.blurSigma > 0)
+        cv::GaussianBlur(frame.bgr, frame.bgr, cv::Size(), config_.blurSigma);
+    if (config_.noiseSigma > 0)
+    {
+        noise_.create(frame.bgr.size(), CV_16SC3);
+        noiseRng_.fill(noise_, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(config_.noiseSigma));
+        cv::add(frame.bgr, noise_, frame.bgr, cv::noArray(), CV_8U);
+    }
+}
+
+SceneConfig stressScene()
+{
+    SceneConfig config;
+    config.resolution = cv::Size(1440, 1080);
+    config.armors = 6;
+    config.clutter = 50;
+    return config;
+}
+
+bool parseSceneSpec(const std::string &spec, SceneConfig &config, std::string &error)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= spec.size())
+    {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos)
+            end = spec.size();
+        if (end > start)
+            items.push_back(spec.substr(start, end - start));
+        start = end + 1;
+    }
+
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        const std::string &item = items[i];
+        const size_t eq = item.find('=');
+        if (eq == std::string::npos)
+        {
+            if (i == 0 && item == "default")
+                config = SceneConfig();
+            else if (i == 0 && item == "stress")
+                config = stressScene();
+            else
+            {
+                error = "unknown scene preset or item: " + item;
+                return false;
+            }
+            continue;
+        }
+
+        const std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+        try
+        {
+            if (key == "armors")
+                config.armors = parseNumber<int>(key, value);
+            else if (key == "clutter")
+                config.clutter = parseNumber<int>(key, value);
+            else if (key == "size")
+            {
+                int w = 0, h = 0;
+                if (std::sscanf(value.c_str(), "%dx%d", &w, &h) != 2)
+                    throw std::invalid_argument(key);
+                config.resolution = cv::Size(w, h);
+            }
+            else if (key == "distance")
+            {
+                const size_t dash = value.find('-');
+                if (dash == std::string::npos)
+                    throw std::invalid_argument(key);
+                config.minDistance = parseNumber<double>(key, value.substr(0, dash));
+                config.maxDistance = parseNumber<double>(key, value.substr(dash + 1));
+            }
+            else if (key == "yaw")
+                config.maxYawDeg = parseNumber<double>(key, value);
+            else if (key == "pitch")
+                config.maxPitchDeg = parseNumber<double>(key, value);
+            else if (key == "spin")
+                config.spinDegPerFrame = parseNumber<double>(key, value);
+            else if (key == "move")
+                config.moveMmPerFrame = parseNumber<double>(key, value);
+            else if (key == "color")
+            {
+                double b = 0, g = 0, r = 0;
+                if (value == "blue")
+                    config.barColor = SceneConfig().barColor;
+                else if (value == "red")
+                    config.barColor = cv::Scalar(80, 80, 255);
+                else if (std::sscanf(value.c_str(), "%lf:%lf:%lf", &b, &g, &r) == 3)
+                    config.barColor = cv::Scalar(b, g, r);
+                else
+                    throw std::invalid_argument(key);
+            }
+            else if (key == "blur")
+                config.blurSigma = parseNumber<double>(key, value);
+            else if (key == "noise")
+                config.noiseSigma = parseNumber<double>(key, value);
+            else if (key == "fps")
+                config.fps = parseNumber<double>(key, value);
+            else if (key == "seed")
+                config.seed = parseNumber<unsigned>(key, value);
+            else
+            {
+                error = "unknown scene key: " + key;
+                return false;
+            }
+        }
+        catch (const std::exception &)
+        {
+            error = "invalid value for " + key + ": " + value;
+            return false;
+        }
+    }
+
+    if (config.resolution.width <= 0 || config.resolution.height <= 0 || config.armors < 0 || config.clutter < 0 ||
+        config.minDistance <= 0 || config.maxDistance < config.minDistance)
+    {
+        error = "scene parameters out of range";
+        return false;
+    }
+    return true;
+}
+
+} // namespace synthscene
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace synthscene
+{
+
+/**
+ * @brief 合成场景参数
+ *
+ * 装甲板按 pose.h 中的物理尺寸建模（两根 LIGHT_BAR_WIDTH x LIGHT_BAR_HEIGHT 的灯条，中心相距 ARMOR_WIDTH，
+ * 中间为带数字的面板），以 cameraMatrix 投影到图像上；干扰灯光为不成对的亮条与亮斑。
+ * 可由 parseSceneSpec 从文本描述构造。
+ */
+struct SceneConfig
+{
+    cv::Size resolution{1440, 1080};
+    int armors = 4;                            ///< 装甲板数量
+    int clutter = 8;                           ///< 干扰灯光数量（约 3/4 为近似竖直的亮条，其余为圆形亮斑）
+    double minDistance = 1500.0;               ///< 装甲板中心到相机的距离范围 (mm)
+    double maxDistance = 6000.0;
+    double maxYawDeg = 40.0;                   ///< 偏航角范围 ±maxYawDeg（0 为正对相机）
+    double maxPitchDeg = 15.0;                 ///< 俯仰角范围 ±maxPitchDeg
+    double spinDegPerFrame = 1.0;              ///< 每帧偏航角变化的上限（到达范围边界时反向），0 为静止
+    double moveMmPerFrame = 5.0;               ///< 每帧横向平移的上限 (mm)，0 为静止
+    cv::Scalar barColor{255, 200, 120};        ///< 灯条颜色 (BGR)；中心按过曝渲染为接近白色
+    double blurSigma = 0.0;                    ///< 整帧高斯模糊（散焦、运动模糊的近似），0 为不模糊
+    double noiseSigma = 6.0;                   ///< 传感器高斯噪声标准差，0 为无噪声
+    double fps = 100.0;                        ///< 帧率，决定 SceneFrame::timestamp
+    unsigned seed = 1;                         ///< 随机种子，相同参数与种子生成逐像素相同的序列
+    cv::Mat cameraMatrix;                      ///< 3x3 内参；为空时按分辨率取 fx = fy = 0.9 * 宽度、主点居中
+};
+
+/**
+ * @brief 单个装甲板的真值
+ */
+struct ArmorTruth
+{
+    std::array<cv::Point2f, 4> corners; ///< armorObjectPoints 的投影（左上、右上、右下、左下）
+    std::array<cv::Point2f, 4> bars;    ///< 左灯条上、下端点，右灯条上、下端点
+    cv::Vec3d rvec;                     ///< 与 solveArmorPose 相同约定的旋转向量
+    cv::Vec3d tvec;                     ///< 平移向量 (mm)
+    double distance = 0.0;              ///< 相机到装甲板中心的距离 (mm)
+    std::string label;                  ///< 面板上的数字
+};
+
+/**
+ * @brief 一帧合成图像与真值；只包含完整位于图像内的装甲板
+ */
+struct SceneFrame
+{
+    uint64_t index = 0;
+    double timestamp = 0.0; ///< index / fps (s)
+    cv::Mat bgr;
+    std::vector<ArmorTruth> armors;
+};
+
+/**
+ * @brief 按帧生成合成场景：装甲板在范围内旋转、平移，干扰灯光位置固定
+ *
+ * 只依赖构造时的参数与种子，与调用时刻、线程无关，用于在没有比赛录像时可重复地测量热路径，
+ * 例如“50 个干扰灯光 + 6 块装甲板、1440x1080”下 O(n^2) 配对与逐个装甲板推理的最坏情况。
+ */
+class SceneGenerator
+{
+  public:
+    explicit SceneGenerator(const SceneConfig &config);
+
+    /**
+     * @brief 渲染下一帧；frame.bgr 尺寸不变时复用其缓冲区
+     */
+    void next(SceneFrame &frame);
+
+    const SceneConfig &config() const
+    {
+        return config_;
+    }
+
+    /// 实际使用的内参（config.cameraMatrix 为空时为按分辨率推算的值）
+    const cv::Mat &cameraMatrix() const
+    {
+        return cameraMatrix_;
+    }
+
+  private:
+    struct Armor
+    {
+        cv::Vec3d position; // 装甲板中心 (mm，相机坐标系)
+        double yaw = 0.0;   // 弧度
+        double pitch = 0.0;
+        double spin = 0.0;  // 每帧偏航角变化（弧度）
+        double move = 0.0;  // 每帧横向平移 (mm)
+        std::string label;
+        cv::Mat texture;    // 面板正面纹理，按面板物理尺寸的 2 倍像素绘制
+    };
+
+    bool project(const Armor &armor, ArmorTruth &truth) const;
+    bool placeArmor(Armor &armor);
+    void step(Armor &armor);
+    void render(const Armor &armor, const ArmorTruth &truth, cv::Mat &image) const;
+
+    SceneConfig config_;
+    cv::Mat cameraMatrix_;
+    cv::Mat distCoeffs_;
+    std::mt19937 rng_;
+    cv::RNG noiseRng_; // 噪声单独使用带种子的 RNG，不经过 OpenCV 的线程局部全局 RNG
+    std::vector<Armor> armors_;
+    cv::Mat background_; // 不含噪声的背景与干扰灯光
+    cv::Mat noise_;      // CV_16SC3，每帧重新填充
+    uint64_t index_ = 0;
+};
+
+/**
+ * @brief 解析场景描述，如 "stress" 或 "armors=6,clutter=50,size=1440x1080,color=red,blur=1.5"
+ *
+ * 以逗号分隔；可选的第一项为预设名（default、stress），其后的 key=value 覆盖预设。
+ * 键：armors、clutter、size(WxH)、distance(最小-最大 mm)、yaw、pitch、spin、move、
+ * color(blue / red / B:G:R)、blur、noise、fps、seed。
+ * @return 解析失败时返回 false 并在 error 中给出原因
+ */
+bool parseSceneSpec(const std::string &spec, SceneConfig &config, std::string &error);
+
+/**
+ * @brief 压力场景：1440x1080 上 6 块装甲板与 50 个干扰灯光
+ */
+SceneConfig stressScene();
+
+} // namespace synthscene
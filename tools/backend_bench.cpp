@@ -0,0 +1,167 @@
+// 推理后端基准：在保存的装甲板正面视图上比较各推理后端（OpenCV DNN / OpenCV INT8 / ONNX Runtime）
+// 在批大小 1/4/16 下的单次推理延迟分布与吞吐量，并以第一个后端为参考报告 top-1 一致率。
+// INT8 后端使用同一目录下的图像做静态量化校准。
+//
+// 用法: backend_bench <模型.onnx> <正面视图目录> [--backends opencv,opencv-int8,onnxruntime]
+//                     [--threads N] [--iterations N]
+
+#include "ArmorMatcher.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <opencv2/imgcodecs.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+namespace
+{
+std::vector<Mat> loadImages(const std::string &dir)
+{
+    std::vector<String> files;
+    glob(dir + "/*", files, false);
+    std::vector<Mat> images;
+    for (const String &file : files)
+    {
+        Mat image = imread(file, IMREAD_COLOR);
+        if (!image.empty())
+            images.push_back(image);
+    }
+    return images;
+}
+
+std::vector<armor::BackendType> parseBackends(const std::string &list)
+{
+    std::vector<armor::BackendType> types;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        armor::BackendType type;
+        if (armor::parseBackendType(name, type))
+            types.push_back(type);
+        else
+            std::fprintf(stderr, "unknown backend: %s\n", name.c_str());
+    }
+    return types;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr,
+                     "usage: %s <model.onnx> <crops_dir> [--backends opencv,opencv-int8,onnxruntime] [--threads N] "
+                     "[--iterations N]\n",
+                     argv[0]);
+        return 1;
+    }
+    std::string modelPath = argv[1];
+    std::string cropsDir = argv[2];
+    std::string backendList = "opencv,opencv-int8,onnxruntime";
+    int threads = 1;
+    size_t iterations = 200;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--backends" && i + 1 < argc)
+            backendList = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg == "--iterations" && i + 1 < argc)
+            iterations = static_cast<size_t>(std::atoi(argv[++i]));
+    }
+
+    std::vector<Mat> crops = loadImages(cropsDir);
+    if (crops.empty())
+    {
+        std::fprintf(stderr, "no images in %s\n", cropsDir.c_str());
+        return 1;
+    }
+    std::printf("%zu crops, intra-op threads %d, %zu iterations per row\n\n", crops.size(), threads, iterations);
+
+    std::vector<int> reference;
+    std::string referenceName;
+    bench::printHeader("throughput");
+    for (armor::BackendType type : parseBackends(backendList))
+    {
+        const char *name = armor::backendName(type);
+        if (!armor::backendAvailable(type))
+        {
+            std::printf("%-36s not built\n", name);
+            continue;
+        }
+
+        armor::ArmorMatcher matcher;
+        armor::BackendOptions options;
+        options.type = type;
+        options.intraOpThreads = threads;
+        matcher.setBackend(options);
+        matcher.setMaxContexts(1);
+        if (type == armor::BackendType::OpenCvInt8)
+            matcher.setCalibrationImages(crops);
+        if (!matcher.load(modelPath))
+        {
+            std::printf("%-36s load failed: %s\n", name, matcher.lastError().c_str());
+            continue;
+        }
+        const armor::ArmorMatcher::LoadStats &stats = matcher.loadStats();
+        std::printf("%-36s load %.1f ms, warm-up %.1f ms\n", name, stats.loadMs, stats.warmupMs);
+
+        std::vector<Mat> blobs(crops.size());
+        for (size_t i = 0; i < crops.size(); i++)
+            matcher.prepareImage(crops[i], blobs[i]);
+
+        // top-1 结果（批大小 1）
+        std::vector<int> predictions(blobs.size(), -1);
+        for (size_t i = 0; i < blobs.size(); i++)
+        {
+            armor::MatchResult result = matcher.matchBlob(blobs[i]);
+            predictions[i] = result.success ? result.classId : -1;
+        }
+
+        for (int batchSize : {1, 4, 16})
+        {
+            std::vector<Mat> batch(batchSize);
+            auto fill = [&](size_t i) {
+                for (int k = 0; k < batchSize; k++)
+                    batch[k] = blobs[(i * batchSize + k) % blobs.size()];
+            };
+            fill(0);
+            std::vector<armor::MatchResult> probe = matcher.matchBatch(batch);
+            std::string label = std::string(name) + " batch " + std::to_string(batchSize);
+            if (!probe.front().success)
+            {
+                std::printf("%-36s unsupported: %s\n", label.c_str(), probe.front().error.c_str());
+                continue;
+            }
+
+            bench::Summary summary = bench::measure(
+                [&](size_t i) {
+                    fill(i);
+                    std::vector<armor::MatchResult> results = matcher.matchBatch(batch);
+                    bench::doNotOptimize(results);
+                },
+                iterations);
+            char extra[64];
+            std::snprintf(extra, sizeof(extra), "%.1f img/s", batchSize * 1e9 / summary.meanNs);
+            bench::printRow(label, summary, extra);
+        }
+
+        if (reference.empty())
+        {
+            reference = predictions;
+            referenceName = name;
+            continue;
+        }
+        size_t agree = 0;
+        for (size_t i = 0; i < predictions.size(); i++)
+            agree += predictions[i] == reference[i] && predictions[i] >= 0;
+        std::printf("%-36s top-1 agreement with %s: %.2f%% (%zu/%zu)\n", name, referenceName.c_str(),
+                    100.0 * agree / predictions.size(), agree, predictions.size());
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 简易基准测试工具：重复执行并统计单次耗时分布，不依赖第三方库
+namespace bench
+{
+
+struct Summary
+{
+    size_t iterations = 0;
+    double meanNs = 0.0;
+    double p50Ns = 0.0;
+    double p90Ns = 0.0;
+    double p99Ns = 0.0;
+    double maxNs = 0.0;
+};
+
+// 阻止编译器把基准测试的结果优化掉
+template <typename T> inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+inline Summary summarize(std::vector<double> samplesNs)
+{
+    Summary s;
+    if (samplesNs.empty())
+        return s;
+    std::sort(samplesNs.begin(), samplesNs.end());
+    double sum = 0.0;
+    for (double v : samplesNs)
+        sum += v;
+    auto pct = [&](double p) {
+        size_t idx = static_cast<size_t>(p * (samplesNs.size() - 1) + 0.5);
+        return samplesNs[std::min(idx, samplesNs.size() - 1)];
+    };
+    s.iterations = samplesNs.size();
+    s.meanNs = sum / samplesNs.size();
+    s.p50Ns = pct(0.50);
+    s.p90Ns = pct(0.90);
+    s.p99Ns = pct(0.99);
+    s.maxNs = samplesNs.back();
+    return s;
+}
+
+// 逐次计时执行 fn(i)，i 为迭代序号；先执行 warmup 次不计时
+template <typename Fn> Summary measure(Fn &&fn, size_t iterations, size_t warmup = 10)
+{
+    for (size_t i = 0; i < warmup; i++)
+        fn(i);
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (size_t i = 0; i < iterations; i++)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        fn(i);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - begin).count());
+    }
+    return summarize(std::move(samples));
+}
+
+inline void printHeader(const char *extra = "")
+{
+    std::printf("%-36s %10s %10s %10s %10s %10s  %s\n", "benchmark", "mean(us)", "p50(us)", "p90(us)", "p99(us)",
+                "max(us)", extra);
+}
+
+inline void printRow(const std::string &name, const Summary &s, const std::string &extra = "")
+{
+    std::printf("%-36s %10.2f %10.2f %10.2f %10.2f %10.2f  %s\n", name.c_str(), s.meanNs / 1e3, s.p50Ns / 1e3,
+                s.p90Ns / 1e3, s.p99Ns / 1e3, s.maxNs / 1e3, extra.c_str());
+}
+
+} // namespace bench
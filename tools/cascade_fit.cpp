@@ -0,0 +1,284 @@
+// 级联第一级拟合与评估：从按类别分目录保存的装甲板正面视图拟合模板相关分类器，
+// 用留一法选择直接给出结果的 margin 阈值，并可选地对比级联与纯网络的准确率和单次分类耗时。
+//
+// 目录结构: <crops_dir>/<类别>/*.png，类别为网络输出下标；指定 --labels 时也可以是 labels.txt 中的标签文本
+//
+// 用法: cascade_fit <crops_dir> <输出.yml> [--labels labels.txt] [--precision 0.995] [--min-score 0.3]
+//                   [--model 模型.onnx]
+
+#include "ArmorMatcher.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/imgcodecs.hpp>
+#include <string>
+#include <vector>
+
+using namespace cv;
+namespace fs = std::filesystem;
+
+namespace
+{
+struct Sample
+{
+    int classId = -1;
+    Mat blob;
+    Mat feature;
+};
+
+std::vector<std::string> readLabels(const std::string &path)
+{
+    std::vector<std::string> labels;
+    std::ifstream ifs(path);
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty())
+            labels.push_back(line);
+    }
+    return labels;
+}
+
+int classIdOf(const std::string &name, const std::vector<std::string> &labels)
+{
+    auto it = std::find(labels.begin(), labels.end(), name);
+    if (it != labels.end())
+        return static_cast<int>(it - labels.begin());
+    char *end = nullptr;
+    long id = std::strtol(name.c_str(), &end, 10);
+    return end && *end == '\0' && !name.empty() ? static_cast<int>(id) : -1;
+}
+
+std::vector<Sample> loadSamples(const std::string &dir, const std::vector<std::string> &labels,
+                                const armor::ArmorMatcher &matcher)
+{
+    std::vector<Sample> samples;
+    std::error_code ec;
+    for (const auto &classDir : fs::directory_iterator(dir, ec))
+    {
+        if (!classDir.is_directory())
+            continue;
+        int classId = classIdOf(classDir.path().filename().string(), labels);
+        if (classId < 0)
+        {
+            std::fprintf(stderr, "skip %s: unknown class\n", classDir.path().c_str());
+            continue;
+        }
+        for (const auto &file : fs::directory_iterator(classDir.path(), ec))
+        {
+            Mat image = imread(file.path().string(), IMREAD_COLOR);
+            Sample sample;
+            sample.classId = classId;
+            if (image.empty() || !matcher.prepareImage(image, sample.blob) ||
+                !armor::DigitTemplateClassifier::extractFeature(sample.blob, 0, sample.feature))
+                continue;
+            samples.push_back(std::move(sample));
+        }
+    }
+    return samples;
+}
+
+// 留一法预测：样本所属类别的模板去掉样本自身后重新归一化
+struct LooPrediction
+{
+    bool correct = false;
+    float score = 0.0f;
+    float margin = 0.0f;
+};
+
+std::vector<LooPrediction> leaveOneOut(const std::vector<Sample> &samples)
+{
+    std::vector<int> classes;
+    for (const Sample &s : samples)
+        classes.push_back(s.classId);
+    std::sort(classes.begin(), classes.end());
+    classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+
+    std::vector<Mat> sums(classes.size());
+    for (Mat &sum : sums)
+        sum = Mat::zeros(1, armor::DigitTemplateClassifier::kSize * armor::DigitTemplateClassifier::kSize, CV_32F);
+    for (const Sample &s : samples)
+        sums[std::lower_bound(classes.begin(), classes.end(), s.classId) - classes.begin()] += s.feature;
+
+    std::vector<LooPrediction> predictions;
+    Mat own;
+    for (const Sample &s : samples)
+    {
+        size_t ownIndex = std::lower_bound(classes.begin(), classes.end(), s.classId) - classes.begin();
+        float best = -2.0f, second = -2.0f;
+        size_t bestIndex = 0;
+        for (size_t c = 0; c < classes.size(); c++)
+        {
+            Mat sum = sums[c];
+            if (c == ownIndex)
+            {
+                own = sums[c] - s.feature;
+                sum = own;
+            }
+            double norm = cv::norm(sum);
+            float score = norm > 1e-6 ? static_cast<float>(sum.dot(s.feature) / norm) : -1.0f;
+            if (score > best)
+            {
+                second = best;
+                best = score;
+                bestIndex = c;
+            }
+            else if (score > second)
+            {
+                second = score;
+            }
+        }
+        LooPrediction p;
+        p.correct = bestIndex == ownIndex;
+        p.score = best;
+        p.margin = best - second;
+        predictions.push_back(p);
+    }
+    return predictions;
+}
+
+// 在满足精度要求的前提下让第一级覆盖尽可能多的样本，返回 margin 阈值
+float chooseMargin(const std::vector<LooPrediction> &predictions, float minScore, double precision, double &coverage,
+                   double &acceptedPrecision)
+{
+    std::vector<LooPrediction> candidates;
+    for (const LooPrediction &p : predictions)
+    {
+        if (p.score >= minScore)
+            candidates.push_back(p);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const LooPrediction &a, const LooPrediction &b) { return a.margin > b.margin; });
+
+    float threshold = 2.0f; // 相关系数之差不会超过 2，即从不直接给出结果
+    coverage = 0.0;
+    acceptedPrecision = 1.0;
+    size_t correct = 0;
+    for (size_t k = 0; k < candidates.size(); k++)
+    {
+        correct += candidates[k].correct;
+        double p = static_cast<double>(correct) / (k + 1);
+        // 相同 margin 的样本同时被接受，只在 margin 变化处取阈值
+        bool boundary = k + 1 == candidates.size() || candidates[k + 1].margin < candidates[k].margin;
+        if (boundary && p >= precision)
+        {
+            threshold = candidates[k].margin;
+            coverage = static_cast<double>(k + 1) / predictions.size();
+            acceptedPrecision = p;
+        }
+    }
+    return threshold;
+}
+
+double nowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const char *name, const armor::ArmorMatcher &matcher, const std::vector<Sample> &samples)
+{
+    std::vector<double> times;
+    size_t correct = 0, firstStage = 0;
+    for (const Sample &s : samples)
+    {
+        double begin = nowNs();
+        armor::MatchResult result = matcher.matchBlob(s.blob);
+        times.push_back(nowNs() - begin);
+        correct += result.success && result.classId == s.classId;
+        firstStage += result.firstStage;
+    }
+    char extra[96];
+    std::snprintf(extra, sizeof(extra), "acc %.2f%%, first stage %.1f%%", 100.0 * correct / samples.size(),
+                  100.0 * firstStage / samples.size());
+    bench::printRow(name, bench::summarize(std::move(times)), extra);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr,
+                     "usage: %s <crops_dir> <output.yml> [--labels labels.txt] [--precision 0.995] [--min-score 0.3] "
+                     "[--model model.onnx]\n",
+                     argv[0]);
+        return 1;
+    }
+    std::string cropsDir = argv[1];
+    std::string outputPath = argv[2];
+    std::string labelsPath, modelPath;
+    double precision = 0.995;
+    float minScore = 0.3f;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--labels" && i + 1 < argc)
+            labelsPath = argv[++i];
+        else if (arg == "--precision" && i + 1 < argc)
+            precision = std::atof(argv[++i]);
+        else if (arg == "--min-score" && i + 1 < argc)
+            minScore = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--model" && i + 1 < argc)
+            modelPath = argv[++i];
+    }
+
+    std::vector<std::string> labels = labelsPath.empty() ? std::vector<std::string>() : readLabels(labelsPath);
+    armor::ArmorMatcher preprocessor; // 只使用预处理（三通道输入），不需要加载模型
+    std::vector<Sample> samples = loadSamples(cropsDir, labels, preprocessor);
+    if (samples.size() < 2)
+    {
+        std::fprintf(stderr, "not enough samples in %s\n", cropsDir.c_str());
+        return 1;
+    }
+
+    std::vector<Mat> features;
+    std::vector<int> classIds;
+    for (const Sample &s : samples)
+    {
+        features.push_back(s.feature);
+        classIds.push_back(s.classId);
+    }
+    armor::DigitTemplateClassifier stage;
+    stage.fit(features, classIds);
+    stage.minScore = minScore;
+
+    std::vector<LooPrediction> loo = leaveOneOut(samples);
+    size_t looCorrect = 0;
+    for (const LooPrediction &p : loo)
+        looCorrect += p.correct;
+    double coverage = 0.0, acceptedPrecision = 0.0;
+    stage.minMargin = chooseMargin(loo, minScore, precision, coverage, acceptedPrecision);
+
+    std::printf("%zu samples, %d classes\n", samples.size(), stage.templates().rows);
+    std::printf("leave-one-out top-1 accuracy (all samples): %.2f%%\n", 100.0 * looCorrect / samples.size());
+    std::printf("min margin %.4f: first stage answers %.1f%% of samples at %.2f%% precision (target %.2f%%)\n",
+                stage.minMargin, 100.0 * coverage, 100.0 * acceptedPrecision, 100.0 * precision);
+    if (!stage.save(outputPath))
+    {
+        std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+        return 1;
+    }
+    std::printf("saved %s\n", outputPath.c_str());
+
+    if (modelPath.empty())
+        return 0;
+
+    // 级联与纯网络对比（在拟合数据上，单样本逐次计时）
+    armor::ArmorMatcher matcher;
+    if (!matcher.loadWithLabels(modelPath, labelsPath) || !matcher.loadFirstStage(outputPath))
+    {
+        std::fprintf(stderr, "load failed: %s\n", matcher.lastError().c_str());
+        return 1;
+    }
+    std::printf("\n");
+    bench::printHeader();
+    matcher.setCascadeEnabled(false);
+    report("dnn only", matcher, samples);
+    matcher.setCascadeEnabled(true);
+    report("cascade", matcher, samples);
+    return 0;
+}
@@ -0,0 +1,119 @@
+// 设备时钟映射回放：用合成的时间戳序列离线验证 clockmap::DeviceClockMapper。
+// 设备时钟相对主机时钟有固定频率偏差，帧在曝光后经过“最小传输延迟 + 指数抖动 + 偶发尖峰”到达，
+// 中途设备时间戳复位一次（模拟相机重连）。分别回放“只有帧到达”与“帧到达 + 每秒一次时间戳锁存”两种情况，
+// 统计映射出的曝光时刻相对真实曝光时刻的误差；超出容差时返回非零。
+// 只有帧到达时映射结果应比真实曝光晚一个最小传输延迟，误差按扣除该偏置后统计。
+//
+// 用法: clock_replay [漂移 ppm=40] [时长 s=60] [随机种子=1]
+
+#include "bench_util.h"
+#include "clockmap.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+constexpr double kTicksPerSecond = 1e8; // GigE 相机常见的 100 MHz 时间戳
+constexpr double kFps = 200.0;
+constexpr double kMinDelayS = 3e-3;     // 读出 + 传输的最小延迟
+constexpr double kJitterS = 0.5e-3;     // 指数抖动均值
+constexpr double kSpikeS = 20e-3;       // 尖峰延迟
+constexpr double kSpikeRate = 0.01;
+constexpr double kSettleS = 2.0;        // 开始及复位后不计入统计的时长
+constexpr double kToleranceS = 1e-3;    // p99 误差容差
+
+struct Result
+{
+    bench::Summary error;
+    double driftPpm = 0.0;
+    unsigned long long resets = 0;
+};
+
+Result replay(double driftPpm, double seconds, bool latch, unsigned seed)
+{
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> jitter(1.0 / kJitterS);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    clockmap::DeviceClockMapper mapper(kTicksPerSecond);
+    const double rate = 1.0 + driftPpm * 1e-6; // 设备秒 -> 主机秒
+    const double hostStart = 1000.0;           // 主机 steady_clock 起点（秒）
+    const double resetAt = seconds / 2;        // 此时设备时间戳从 0 重新开始
+
+    // 设备时间 = (主机时间 - deviceEpoch) / rate
+    double deviceEpoch = hostStart - 123.456;
+    auto ticksAt = [&](double hostS) { return static_cast<uint64_t>((hostS - deviceEpoch) / rate * kTicksPerSecond); };
+    auto toNs = [](double s) { return static_cast<int64_t>(std::llround(s * 1e9)); };
+
+    std::vector<double> errorsNs;
+    double nextLatch = 0.0;
+    bool didReset = false;
+    const double bias = latch ? 0.0 : kMinDelayS;
+    for (double t = 0.0; t < seconds; t += 1.0 / kFps)
+    {
+        const double exposure = hostStart + t;
+        if (!didReset && t >= resetAt)
+        {
+            deviceEpoch = exposure;
+            didReset = true;
+        }
+        double delay = kMinDelayS + jitter(rng);
+        if (unit(rng) < kSpikeRate)
+            delay += kSpikeS;
+        const uint64_t ticks = ticksAt(exposure);
+        mapper.observeArrival(ticks, toNs(exposure + delay));
+
+        if (latch && t >= nextLatch)
+        {
+            // 往返 0.2 ~ 2 ms，设备在往返期间的任意时刻锁存
+            const double before = exposure + delay + 1e-4;
+            const double rtt = 2e-4 + unit(rng) * 1.8e-3;
+            mapper.observeLatch(ticksAt(before + unit(rng) * rtt), toNs(before), toNs(before + rtt));
+            nextLatch += 1.0;
+        }
+
+        const bool settling = t < kSettleS || (t >= resetAt && t < resetAt + kSettleS);
+        int64_t mappedNs = 0;
+        if (!settling && mapper.toHost(ticks, mappedNs))
+            errorsNs.push_back(std::fabs(mappedNs / 1e9 - exposure - bias) * 1e9);
+    }
+
+    Result r;
+    r.error = bench::summarize(errorsNs);
+    clockmap::DeviceClockMapper::Status status = mapper.status();
+    r.driftPpm = status.driftPpm;
+    r.resets = status.resets;
+    return r;
+}
+
+bool report(const char *name, const Result &r, double driftPpm)
+{
+    const bool ok = r.error.iterations > 0 && r.error.p99Ns <= kToleranceS * 1e9 && r.resets == 1;
+    std::printf("%-8s | n %6zu | |err| p50 %7.1f us | p99 %7.1f us | max %7.1f us | drift %7.2f ppm (true %.2f) | "
+                "resets %llu | %s\n",
+                name, r.error.iterations, r.error.p50Ns / 1e3, r.error.p99Ns / 1e3, r.error.maxNs / 1e3, r.driftPpm,
+                driftPpm, r.resets, ok ? "OK" : "FAIL");
+    return ok;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const double driftPpm = argc > 1 ? std::atof(argv[1]) : 40.0;
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 60.0;
+    const unsigned seed = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 1u;
+    if (seconds <= 4 * kSettleS)
+    {
+        std::fprintf(stderr, "时长至少 %.0f s\n", 4 * kSettleS);
+        return 2;
+    }
+
+    std::printf("fps %.0f, 最小传输延迟 %.1f ms, 抖动均值 %.1f ms, 尖峰 %.0f ms (%.0f%%), 时长 %.0f s, 中途复位一次\n",
+                kFps, kMinDelayS * 1e3, kJitterS * 1e3, kSpikeS * 1e3, kSpikeRate * 100, seconds);
+    bool ok = report("arrival", replay(driftPpm, seconds, false, seed), driftPpm);
+    ok = report("latched", replay(driftPpm, seconds, true, seed), driftPpm) && ok;
+    return ok ? 0 : 1;
+}
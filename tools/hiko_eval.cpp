@@ -0,0 +1,500 @@
+// 离线精度 / 速度回归：在带标注的录制数据（图像目录或视频）上运行完整的检测与分类流程，
+// 报告检测查准率 / 查全率、角点误差、距离误差、分类准确率以及每帧耗时分位数，并写出机器可读的结果文件。
+// 指定 --baseline 时与之前的结果文件比较，任一精度指标回退超出容差即返回非零，用于给性能优化把关：
+// 先在改动前生成基线，改动后以同样的参数再跑一次。
+//
+// 标注文件（OpenCV FileStorage，YAML 或 JSON）:
+//   camera_matrix: 可选，按标注图像分辨率标定的 3x3 内参，缺省使用 process.cpp 中的标定
+//   frames:
+//     - image: "000123.png"          # 图像目录输入时为文件名；视频输入时改用 index（从 0 开始的帧号）
+//       armors:
+//         - corners: [x0, y0, x1, y1, x2, y2, x3, y3]   # 左上、右上、右下、左下（原图像素坐标）
+//           label: "3"                                   # 可省略，省略时不参与分类准确率
+//           distance: 2500                               # 可省略，相机到装甲板中心的距离 (mm)
+// 未出现在 frames 中的帧照常检测（保持跟踪器的时间连续），但不参与精度统计。
+//
+// 用法: hiko_eval <图像目录|视频> [--annotations 标注文件] [--model 模型.onnx] [--labels labels.txt]
+//                 [--first-stage cascade.yml] [--search-scale 0.5] [--track] [--fps 100] [--match-ratio 0.3]
+//                 [--output result.json] [--baseline 基线.json] [--tolerance 0.005] [--corner-tolerance 0.1]
+
+#include "ArmorMatcher.h"
+#include "bench_util.h"
+#include "process.h"
+#include "tracker.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+namespace
+{
+constexpr int kWarmupFrames = 5; // 前几帧包含模型与缓冲区的首次初始化，不计入耗时分布
+
+struct GroundTruth
+{
+    std::array<Point2f, 4> corners;
+    std::string label;
+    double distance = 0.0; // mm，0 表示未标注
+};
+
+struct Annotations
+{
+    Mat cameraMatrix;
+    std::map<std::string, std::vector<GroundTruth>> byImage; // 图像目录输入，按文件名
+    std::map<int, std::vector<GroundTruth>> byIndex;         // 视频输入，按帧号
+};
+
+std::string readLabel(const FileNode &node)
+{
+    if (node.isString())
+        return static_cast<std::string>(node);
+    if (node.isInt())
+        return std::to_string(static_cast<int>(node));
+    return std::string();
+}
+
+bool loadAnnotations(const std::string &path, Annotations &out)
+{
+    FileStorage fs;
+    try
+    {
+        if (!fs.open(path, FileStorage::READ))
+            return false;
+    }
+    catch (const cv::Exception &)
+    {
+        return false;
+    }
+    if (!fs["camera_matrix"].empty())
+        fs["camera_matrix"] >> out.cameraMatrix;
+
+    for (const FileNode &frame : fs["frames"])
+    {
+        std::vector<GroundTruth> armors;
+        for (const FileNode &node : frame["armors"])
+        {
+            std::vector<float> c;
+            node["corners"] >> c;
+            if (c.size() != 8)
+            {
+                std::fprintf(stderr, "%s: armor corners must have 8 values\n", path.c_str());
+                return false;
+            }
+            GroundTruth gt;
+            for (int k = 0; k < 4; k++)
+                gt.corners[k] = Point2f(c[2 * k], c[2 * k + 1]);
+            gt.label = readLabel(node["label"]);
+            if (!node["distance"].empty())
+                gt.distance = static_cast<double>(node["distance"]);
+            armors.push_back(gt);
+        }
+        if (!frame["image"].empty())
+            out.byImage[static_cast<std::string>(frame["image"])] = std::move(armors);
+        else if (!frame["index"].empty())
+            out.byIndex[static_cast<int>(frame["index"])] = std::move(armors);
+    }
+    return !out.byImage.empty() || !out.byIndex.empty();
+}
+
+double meanCornerError(const std::array<Point2f, 4> &a, const std::array<Point2f, 4> &b)
+{
+    double sum = 0.0;
+    for (int k = 0; k < 4; k++)
+    {
+        Point2f d = a[k] - b[k];
+        sum += std::sqrt(d.dot(d));
+    }
+    return sum / 4.0;
+}
+
+// 装甲板宽度：左右两条灯条中点之间的距离，匹配阈值按它缩放
+double armorWidth(const std::array<Point2f, 4> &c)
+{
+    Point2f d = (c[1] + c[2]) * 0.5f - (c[0] + c[3]) * 0.5f;
+    return std::sqrt(d.dot(d));
+}
+
+struct Metrics
+{
+    size_t frames = 0;          // 全部处理的帧
+    size_t annotatedFrames = 0; // 参与精度统计的帧
+    size_t groundTruth = 0;
+    size_t detections = 0;
+    size_t matched = 0;
+    std::vector<double> cornerErrors;   // 匹配上的装甲板平均角点误差 (px)
+    std::vector<double> distanceErrors; // 相对距离误差 |d - gt| / gt
+    size_t labeled = 0;                 // 匹配上且标注了类别
+    size_t correct = 0;                 // 其中分类正确
+    size_t unclassified = 0;            // 其中没有分类结果
+    std::vector<double> frameNs;        // 每帧检测 + 分类耗时
+    DetectionTiming stageSum;           // 各阶段耗时之和（毫秒）
+};
+
+// 按平均角点误差从小到大贪心一对一匹配，误差超过 matchRatio * 装甲板宽度的不算匹配
+void scoreFrame(const std::vector<GroundTruth> &truth, const std::vector<ArmorDetection> &detections,
+                double matchRatio, Metrics &m)
+{
+    struct Candidate
+    {
+        double error;
+        size_t gt;
+        size_t det;
+    };
+    std::vector<Candidate> candidates;
+    for (size_t g = 0; g < truth.size(); g++)
+    {
+        double limit = matchRatio * armorWidth(truth[g].corners);
+        for (size_t d = 0; d < detections.size(); d++)
+        {
+            double error = meanCornerError(truth[g].corners, detections[d].fullCorners);
+            if (error <= limit)
+                candidates.push_back({error, g, d});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate &a, const Candidate &b) { return a.error < b.error; });
+
+    std::vector<char> gtUsed(truth.size(), 0), detUsed(detections.size(), 0);
+    for (const Candidate &c : candidates)
+    {
+        if (gtUsed[c.gt] || detUsed[c.det])
+            continue;
+        gtUsed[c.gt] = detUsed[c.det] = 1;
+        m.matched++;
+        m.cornerErrors.push_back(c.error);
+
+        const GroundTruth &gt = truth[c.gt];
+        const ArmorDetection &det = detections[c.det];
+        if (gt.distance > 0 && det.poseValid)
+            m.distanceErrors.push_back(std::fabs(det.distance - gt.distance) / gt.distance);
+        if (!gt.label.empty())
+        {
+            m.labeled++;
+            if (!det.classified)
+                m.unclassified++;
+            else if (det.label == gt.label)
+                m.correct++;
+        }
+    }
+    m.groundTruth += truth.size();
+    m.detections += detections.size();
+}
+
+double ratio(size_t num, size_t den)
+{
+    return den > 0 ? static_cast<double>(num) / den : 0.0;
+}
+
+void writeSummary(FileStorage &fs, const char *name, const bench::Summary &s, double scale)
+{
+    fs << name << "{";
+    fs << "count" << static_cast<int>(s.iterations);
+    fs << "mean" << s.meanNs * scale << "p50" << s.p50Ns * scale << "p90" << s.p90Ns * scale;
+    fs << "p99" << s.p99Ns * scale << "max" << s.maxNs * scale;
+    fs << "}";
+}
+
+struct Result
+{
+    double precision = 0.0;
+    double recall = 0.0;
+    double cornerMeanPx = 0.0;
+    double distanceMeanRel = 0.0;
+    double accuracy = 0.0;
+    bool hasLabels = false;
+    bool hasDistances = false;
+    double latencyP50Ms = 0.0;
+    double latencyP99Ms = 0.0;
+};
+
+// bench::Summary 的字段按纳秒命名，这里同样用于像素与比例
+Result summarizeMetrics(const Metrics &m)
+{
+    Result r;
+    r.precision = ratio(m.matched, m.detections);
+    r.recall = ratio(m.matched, m.groundTruth);
+    r.cornerMeanPx = bench::summarize(m.cornerErrors).meanNs;
+    r.hasDistances = !m.distanceErrors.empty();
+    r.distanceMeanRel = bench::summarize(m.distanceErrors).meanNs;
+    r.hasLabels = m.labeled > 0;
+    r.accuracy = ratio(m.correct, m.labeled);
+    bench::Summary latency = bench::summarize(m.frameNs);
+    r.latencyP50Ms = latency.p50Ns / 1e6;
+    r.latencyP99Ms = latency.p99Ns / 1e6;
+    return r;
+}
+
+bool writeResult(const std::string &path, const std::string &input, const Metrics &m, const Result &r)
+{
+    FileStorage fs;
+    try
+    {
+        if (!fs.open(path, FileStorage::WRITE | FileStorage::FORMAT_JSON))
+            return false;
+    }
+    catch (const cv::Exception &)
+    {
+        return false;
+    }
+    fs << "input" << input;
+    fs << "frames" << static_cast<int>(m.frames) << "annotated_frames" << static_cast<int>(m.annotatedFrames);
+    fs << "ground_truth" << static_cast<int>(m.groundTruth) << "detections" << static_cast<int>(m.detections);
+    fs << "matched" << static_cast<int>(m.matched);
+    fs << "precision" << r.precision << "recall" << r.recall;
+    writeSummary(fs, "corner_error_px", bench::summarize(m.cornerErrors), 1.0);
+    writeSummary(fs, "distance_error_rel", bench::summarize(m.distanceErrors), 1.0);
+    fs << "classification" << "{";
+    fs << "labeled" << static_cast<int>(m.labeled) << "correct" << static_cast<int>(m.correct);
+    fs << "unclassified" << static_cast<int>(m.unclassified) << "accuracy" << r.accuracy;
+    fs << "}";
+    writeSummary(fs, "latency_ms", bench::summarize(m.frameNs), 1e-6);
+    const double n = m.frames > 0 ? static_cast<double>(m.frames) : 1.0;
+    fs << "stage_mean_ms" << "{";
+    fs << "preprocess" << m.stageSum.preprocessMs / n << "contours" << m.stageSum.contourMs / n;
+    fs << "pairing" << m.stageSum.pairingMs / n << "classify" << m.stageSum.classifyMs / n;
+    fs << "}";
+    return true;
+}
+
+bool loadResult(const std::string &path, Result &r)
+{
+    FileStorage fs;
+    try
+    {
+        if (!fs.open(path, FileStorage::READ))
+            return false;
+    }
+    catch (const cv::Exception &)
+    {
+        return false;
+    }
+    r.precision = static_cast<double>(fs["precision"]);
+    r.recall = static_cast<double>(fs["recall"]);
+    r.cornerMeanPx = static_cast<double>(fs["corner_error_px"]["mean"]);
+    r.hasDistances = static_cast<int>(fs["distance_error_rel"]["count"]) > 0;
+    r.distanceMeanRel = static_cast<double>(fs["distance_error_rel"]["mean"]);
+    r.hasLabels = static_cast<int>(fs["classification"]["labeled"]) > 0;
+    r.accuracy = static_cast<double>(fs["classification"]["accuracy"]);
+    r.latencyP50Ms = static_cast<double>(fs["latency_ms"]["p50"]);
+    r.latencyP99Ms = static_cast<double>(fs["latency_ms"]["p99"]);
+    return true;
+}
+
+// 与基线比较：比例类指标下降超过 tolerance、误差类指标上升超过容差视为回退；耗时只报告不判定
+bool compareWithBaseline(const Result &base, const Result &cur, double tolerance, double cornerTolerance)
+{
+    bool ok = true;
+    auto higherIsBetter = [&](const char *name, double b, double c, double tol) {
+        bool pass = c >= b - tol;
+        std::printf("  %-18s %10.4f -> %10.4f  %s\n", name, b, c, pass ? "ok" : "REGRESSED");
+        ok = ok && pass;
+    };
+    auto lowerIsBetter = [&](const char *name, double b, double c, double tol) {
+        bool pass = c <= b + tol;
+        std::printf("  %-18s %10.4f -> %10.4f  %s\n", name, b, c, pass ? "ok" : "REGRESSED");
+        ok = ok && pass;
+    };
+    std::printf("baseline comparison:\n");
+    higherIsBetter("precision", base.precision, cur.precision, tolerance);
+    higherIsBetter("recall", base.recall, cur.recall, tolerance);
+    lowerIsBetter("corner error (px)", base.cornerMeanPx, cur.cornerMeanPx, cornerTolerance);
+    if (base.hasDistances && cur.hasDistances)
+        lowerIsBetter("distance error", base.distanceMeanRel, cur.distanceMeanRel, tolerance);
+    if (base.hasLabels && cur.hasLabels)
+        higherIsBetter("accuracy", base.accuracy, cur.accuracy, tolerance);
+    std::printf("  %-18s %10.3f -> %10.3f ms\n", "latency p50", base.latencyP50Ms, cur.latencyP50Ms);
+    std::printf("  %-18s %10.3f -> %10.3f ms\n", "latency p99", base.latencyP99Ms, cur.latencyP99Ms);
+    return ok;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr,
+                     "usage: %s <image_dir|video> [--annotations file.yml] [--model model.onnx] [--labels labels.txt] "
+                     "[--first-stage cascade.yml] [--search-scale 0.5] [--track] [--fps 100] [--match-ratio 0.3] "
+                     "[--output result.json] [--baseline baseline.json] [--tolerance 0.005] "
+                     "[--corner-tolerance 0.1]\n",
+                     argv[0]);
+        return 1;
+    }
+    namespace fs = std::filesystem;
+    const std::string input = argv[1];
+    const bool isDirectory = fs::is_directory(input);
+    std::string annotationsPath = isDirectory ? (fs::path(input) / "annotations.yml").string() : std::string();
+    std::string modelPath, labelsPath, firstStagePath, outputPath = "eval_result.json", baselinePath;
+    float searchScale = 0.5f;
+    bool track = false;
+    double fps = 100.0;
+    double matchRatio = 0.3;
+    double tolerance = 0.005;
+    double cornerTolerance = 0.1;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--annotations" && i + 1 < argc)
+            annotationsPath = argv[++i];
+        else if (arg == "--model" && i + 1 < argc)
+            modelPath = argv[++i];
+        else if (arg == "--labels" && i + 1 < argc)
+            labelsPath = argv[++i];
+        else if (arg == "--first-stage" && i + 1 < argc)
+            firstStagePath = argv[++i];
+        else if (arg == "--search-scale" && i + 1 < argc)
+            searchScale = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--track")
+            track = true;
+        else if (arg == "--fps" && i + 1 < argc)
+            fps = std::atof(argv[++i]);
+        else if (arg == "--match-ratio" && i + 1 < argc)
+            matchRatio = std::atof(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = std::atof(argv[++i]);
+        else if (arg == "--corner-tolerance" && i + 1 < argc)
+            cornerTolerance = std::atof(argv[++i]);
+    }
+
+    Annotations annotations;
+    if (annotationsPath.empty() || !loadAnnotations(annotationsPath, annotations))
+    {
+        std::fprintf(stderr, "cannot load annotations: %s\n",
+                     annotationsPath.empty() ? "(use --annotations for video input)" : annotationsPath.c_str());
+        return 1;
+    }
+    if (!annotations.cameraMatrix.empty())
+        cameraMatrix = annotations.cameraMatrix;
+
+    if (!modelPath.empty())
+    {
+        auto matcher = std::make_shared<armor::ArmorMatcher>();
+        if (!matcher->loadWithLabels(modelPath, labelsPath) ||
+            (!firstStagePath.empty() && !matcher->loadFirstStage(firstStagePath)))
+        {
+            std::fprintf(stderr, "load failed: %s\n", matcher->lastError().c_str());
+            return 1;
+        }
+        armor::setGlobalArmorMatcher(matcher);
+    }
+
+    // 帧来源：图像目录按文件名排序，视频按顺序解码；读取与解码不计入耗时
+    std::vector<String> files;
+    VideoCapture video;
+    if (isDirectory)
+    {
+        glob(input + "/*", files, false);
+        std::sort(files.begin(), files.end());
+    }
+    else
+    {
+        if (!video.open(input))
+        {
+            std::fprintf(stderr, "cannot open %s\n", input.c_str());
+            return 1;
+        }
+        double videoFps = video.get(CAP_PROP_FPS);
+        if (videoFps > 0)
+            fps = videoFps;
+    }
+
+    ArmorTracker tracker;
+    Metrics metrics;
+    size_t fileIndex = 0;
+    for (int index = 0;; index++)
+    {
+        Mat frame;
+        const std::vector<GroundTruth> *truth = nullptr;
+        if (isDirectory)
+        {
+            while (frame.empty() && fileIndex < files.size())
+            {
+                const String &file = files[fileIndex++];
+                frame = imread(file, IMREAD_COLOR);
+                auto it = annotations.byImage.find(fs::path(file).filename().string());
+                truth = frame.empty() || it == annotations.byImage.end() ? nullptr : &it->second;
+            }
+        }
+        else
+        {
+            video >> frame;
+            auto it = annotations.byIndex.find(index);
+            truth = it == annotations.byIndex.end() ? nullptr : &it->second;
+        }
+        if (frame.empty())
+            break;
+
+        DetectionContext context;
+        context.tracker = track ? &tracker : nullptr;
+        context.timestamp = index / fps;
+        context.searchScale = searchScale;
+        DetectionTiming timing;
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<ArmorDetection> detections = detectArmors(frame, context, &timing);
+        auto end = std::chrono::steady_clock::now();
+
+        metrics.frames++;
+        if (index >= kWarmupFrames)
+            metrics.frameNs.push_back(std::chrono::duration<double, std::nano>(end - begin).count());
+        metrics.stageSum.preprocessMs += timing.preprocessMs;
+        metrics.stageSum.contourMs += timing.contourMs;
+        metrics.stageSum.pairingMs += timing.pairingMs;
+        metrics.stageSum.classifyMs += timing.classifyMs;
+        if (truth)
+        {
+            metrics.annotatedFrames++;
+            scoreFrame(*truth, detections, matchRatio, metrics);
+        }
+    }
+    if (metrics.annotatedFrames == 0)
+    {
+        std::fprintf(stderr, "no annotated frames found in %s\n", input.c_str());
+        return 1;
+    }
+
+    Result result = summarizeMetrics(metrics);
+    std::printf("%zu frames (%zu annotated): %zu ground truth, %zu detections, %zu matched\n", metrics.frames,
+                metrics.annotatedFrames, metrics.groundTruth, metrics.detections, metrics.matched);
+    std::printf("precision %.4f | recall %.4f | corner error mean %.3f px", result.precision, result.recall,
+                result.cornerMeanPx);
+    if (result.hasDistances)
+        std::printf(" | distance error mean %.2f%%", 100.0 * result.distanceMeanRel);
+    if (result.hasLabels)
+        std::printf(" | accuracy %.4f (%zu/%zu, %zu unclassified)", result.accuracy, metrics.correct, metrics.labeled,
+                    metrics.unclassified);
+    std::printf("\n\n");
+    bench::printHeader();
+    bench::printRow("frame (detect + classify)", bench::summarize(metrics.frameNs));
+
+    if (!writeResult(outputPath, input, metrics, result))
+    {
+        std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+        return 1;
+    }
+    std::printf("\nsaved %s\n", outputPath.c_str());
+
+    if (baselinePath.empty())
+        return 0;
+    Result baseline;
+    if (!loadResult(baselinePath, baseline))
+    {
+        std::fprintf(stderr, "cannot load baseline %s\n", baselinePath.c_str());
+        return 1;
+    }
+    return compareWithBaseline(baseline, result, tolerance, cornerTolerance) ? 0 : 2;
+}
@@ -0,0 +1,277 @@
+// 检测与分类热路径的逐个核函数微基准：每个核函数在固定输入上单独重复计时，输出单次耗时分布。
+// 覆盖像素格式转换、缩小、灰度、高斯模糊 + 阈值、三次形态学运算、轮廓提取、灯条筛选（含 fitLine）、灯条配对、
+// PnP、透视变换 + 网络输入生成、match 的预处理与网络前向，以及端到端的 detectArmors。
+// 输入为 synthscene 生成的合成场景（默认 1440x1080、4 块装甲板与 8 个干扰灯光，--scene stress 为 6 块装甲板与
+// 50 个干扰灯光），以及命令行给出的录制图像或视频（取第一帧）。
+// 像素格式转换以 OpenCV 的 Bayer 去马赛克代替相机 SDK 的转换（离线工具不链接 SDK），输入由 BGR 图重新采样得到。
+// 检测核函数在 0.5 倍搜索分辨率上运行，与默认的粗到精流程一致。
+//
+// 用法: hiko_microbench [图像或视频 ...] [--iterations N] [--filter 子串] [--model 模型.onnx] [--scene 描述]
+//                        [--armors N]
+
+#include "ArmorMatcher.h"
+#include "bench_util.h"
+#include "pose.h"
+#include "process.h"
+#include "synthscene.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+namespace
+{
+constexpr float kSearchScale = 0.5f;
+
+struct Input
+{
+    std::string name;
+    Mat bgr;                                    // 全分辨率 BGR 图
+    std::vector<std::array<Point2f, 4>> quads; // 全分辨率装甲板四角点，PnP 与透视变换使用
+};
+
+// 合成场景的第一帧；四角点取自真值
+Input makeSyntheticInput(const synthscene::SceneConfig &config, const std::string &name)
+{
+    synthscene::SceneGenerator generator(config);
+    synthscene::SceneFrame frame;
+    generator.next(frame);
+    Input input;
+    input.name = name;
+    input.bgr = frame.bgr;
+    for (const synthscene::ArmorTruth &armor : frame.armors)
+        input.quads.push_back(armor.corners);
+    return input;
+}
+
+// 录制图像或视频的第一帧；四角点取自一次完整检测的结果
+bool loadInput(const std::string &path, Input &input)
+{
+    Mat frame = imread(path, IMREAD_COLOR);
+    if (frame.empty())
+    {
+        VideoCapture video(path);
+        if (video.isOpened())
+            video >> frame;
+    }
+    if (frame.empty())
+        return false;
+    input.name = path.substr(path.find_last_of("/\\") + 1);
+    input.bgr = frame;
+    DetectionContext context;
+    context.searchScale = kSearchScale;
+    for (const ArmorDetection &det : detectArmors(frame, context))
+        input.quads.push_back(det.fullCorners);
+    return true;
+}
+
+// BGR 重新采样为 BayerBG8（与主程序设置的相机像素格式一致）
+Mat toBayer(const Mat &bgr)
+{
+    Mat bayer(bgr.size(), CV_8UC1);
+    for (int y = 0; y < bgr.rows; y++)
+    {
+        const Vec3b *src = bgr.ptr<Vec3b>(y);
+        uchar *dst = bayer.ptr<uchar>(y);
+        for (int x = 0; x < bgr.cols; x++)
+        {
+            // 偶数行 B G B G，奇数行 G R G R
+            int channel = (y % 2 == 0) ? (x % 2 == 0 ? 0 : 1) : (x % 2 == 0 ? 1 : 2);
+            dst[x] = src[x][channel];
+        }
+    }
+    return bayer;
+}
+
+struct Runner
+{
+    size_t iterations = 200;
+    std::string filter;
+
+    // 名称包含过滤子串时计时并输出一行
+    template <typename Fn> void run(const std::string &input, const std::string &kernel, Fn &&fn,
+                                    const std::string &extra = "")
+    {
+        std::string name = "[" + input + "] " + kernel;
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            return;
+        bench::printRow(name, bench::measure(fn, iterations), extra);
+    }
+};
+
+std::string sizeText(const Mat &m)
+{
+    return std::to_string(m.cols) + "x" + std::to_string(m.rows);
+}
+
+void runInput(Runner &runner, const Input &input, const armor::ArmorMatcher &matcher)
+{
+    const std::string &n = input.name;
+    const std::string full = sizeText(input.bgr);
+
+    // 像素格式转换与缩小：全分辨率
+    Mat bayer = toBayer(input.bgr), converted;
+    runner.run(n, "convert bayer->bgr", [&](size_t) { cvtColor(bayer, converted, COLOR_BayerBG2BGR); }, full);
+    Mat search;
+    runner.run(n, "resize area 0.5",
+               [&](size_t) { resize(input.bgr, search, Size(), kSearchScale, kSearchScale, INTER_AREA); }, full);
+    resize(input.bgr, search, Size(), kSearchScale, kSearchScale, INTER_AREA);
+    const std::string half = sizeText(search);
+
+    // 预处理：与 detectLightBars 相同的参数，每个核函数的输入固定，输出写入独立的缓冲区
+    Mat gray, blurred, binary;
+    runner.run(n, "cvtColor bgr->gray", [&](size_t) { cvtColor(search, gray, COLOR_BGR2GRAY); }, half);
+    cvtColor(search, gray, COLOR_BGR2GRAY);
+    runner.run(n, "gaussian 5x5 + threshold",
+               [&](size_t) {
+                   GaussianBlur(gray, blurred, Size(5, 5), 0);
+                   threshold(blurred, binary, 190, 255, THRESH_BINARY);
+               },
+               half);
+    GaussianBlur(gray, blurred, Size(5, 5), 0);
+    threshold(blurred, binary, 190, 255, THRESH_BINARY);
+
+    const Mat verticalKernel = getStructuringElement(MORPH_RECT, Size(1, 7));
+    const Mat smallKernel = getStructuringElement(MORPH_RECT, Size(3, 3));
+    const Mat openKernel = getStructuringElement(MORPH_RECT, Size(2, 2));
+    Mat closedVertical, closedSmall, opened;
+    runner.run(n, "morph close 1x7",
+               [&](size_t) { morphologyEx(binary, closedVertical, MORPH_CLOSE, verticalKernel); }, half);
+    morphologyEx(binary, closedVertical, MORPH_CLOSE, verticalKernel);
+    runner.run(n, "morph close 3x3",
+               [&](size_t) { morphologyEx(closedVertical, closedSmall, MORPH_CLOSE, smallKernel); }, half);
+    morphologyEx(closedVertical, closedSmall, MORPH_CLOSE, smallKernel);
+    runner.run(n, "morph open 2x2", [&](size_t) { morphologyEx(closedSmall, opened, MORPH_OPEN, openKernel); }, half);
+    morphologyEx(closedSmall, opened, MORPH_OPEN, openKernel);
+
+    // 轮廓、筛选与配对
+    std::vector<Mat> contours;
+    runner.run(n, "findContours",
+               [&](size_t) { findContours(opened, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE); }, half);
+    findContours(opened, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+
+    std::vector<LightBar> candidates;
+    runner.run(n, "filterLightBars (fitLine)",
+               [&](size_t) {
+                   candidates.clear();
+                   filterLightBars(contours, 1.0f, candidates);
+               },
+               std::to_string(contours.size()) + " contours");
+    candidates.clear();
+    filterLightBars(contours, 1.0f, candidates);
+
+    std::vector<ArmorDetection> pairs;
+    std::pmr::vector<std::pair<size_t, size_t>> barIndices;
+    runner.run(n, "pairLightBars",
+               [&](size_t) {
+                   pairs.clear();
+                   barIndices.clear();
+                   pairLightBars(candidates, pairs, barIndices);
+               },
+               std::to_string(candidates.size()) + " candidates");
+    pairs.clear();
+    barIndices.clear();
+    pairLightBars(candidates, pairs, barIndices);
+    std::printf("%-36s %zu armors paired\n", ("[" + n + "]").c_str(), pairs.size());
+
+    // 单个装甲板的 PnP、透视变换与分类：轮流使用场景中的各个装甲板
+    if (!input.quads.empty())
+    {
+        // 典型 1440x1080 工业相机内参（基准与标定值无关，仅需合理）
+        Mat K = (Mat_<double>(3, 3) << 1300.0, 0, input.bgr.cols / 2.0, 0, 1300.0, input.bgr.rows / 2.0, 0, 0, 1);
+        Mat D = Mat::zeros(5, 1, CV_64F);
+        const std::string perArmor = std::to_string(input.quads.size()) + " armors";
+        ArmorPose pose;
+        runner.run(n, "solveArmorPose (ippe)",
+                   [&](size_t i) { solveArmorPose(input.quads[i % input.quads.size()], K, D, pose); }, perArmor);
+
+        Mat blob, frontView;
+        runner.run(n, "prepareInput (warp+tensor)",
+                   [&](size_t i) {
+                       matcher.prepareInput(input.bgr, input.quads[i % input.quads.size()], blob, frontView);
+                   },
+                   sizeText(Mat(matcher.inputHeight(), matcher.inputWidth(), CV_8UC1)));
+        if (matcher.prepareInput(input.bgr, input.quads.front(), blob, frontView))
+        {
+            Mat imageBlob;
+            runner.run(n, "match preprocess (image)", [&](size_t) { matcher.prepareImage(frontView, imageBlob); });
+            if (matcher.isReady())
+                runner.run(n, "match forward", [&](size_t) { bench::doNotOptimize(matcher.matchBlob(blob)); });
+        }
+    }
+
+    // 端到端：三个阶段依次执行（含上面全部步骤，未加载模型时不含推理）
+    DetectionContext context;
+    context.searchScale = kSearchScale;
+    runner.run(n, "detectArmors (end to end)",
+               [&](size_t) { bench::doNotOptimize(detectArmors(input.bgr, context)); }, full);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Runner runner;
+    std::string modelPath;
+    synthscene::SceneConfig scene;
+    std::string sceneName = "synthetic";
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+            runner.iterations = static_cast<size_t>(std::atoi(argv[++i]));
+        else if (arg == "--filter" && i + 1 < argc)
+            runner.filter = argv[++i];
+        else if (arg == "--model" && i + 1 < argc)
+            modelPath = argv[++i];
+        else if (arg == "--scene" && i + 1 < argc)
+        {
+            std::string error;
+            sceneName = argv[++i];
+            if (!synthscene::parseSceneSpec(sceneName, scene, error))
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+        }
+        else if (arg == "--armors" && i + 1 < argc)
+            scene.armors = std::atoi(argv[++i]);
+        else
+            paths.push_back(arg);
+    }
+
+    // 未加载模型时 prepareInput 使用默认输入尺寸，不计推理
+    auto matcher = std::make_shared<armor::ArmorMatcher>();
+    if (!modelPath.empty())
+    {
+        if (!matcher->load(modelPath))
+        {
+            std::fprintf(stderr, "load failed: %s\n", matcher->lastError().c_str());
+            return 1;
+        }
+        armor::setGlobalArmorMatcher(matcher);
+    }
+
+    std::vector<Input> inputs;
+    inputs.push_back(makeSyntheticInput(scene, sceneName));
+    for (const std::string &path : paths)
+    {
+        Input input;
+        if (loadInput(path, input))
+            inputs.push_back(std::move(input));
+        else
+            std::fprintf(stderr, "cannot read %s\n", path.c_str());
+    }
+
+    std::printf("%zu iterations per kernel%s\n", runner.iterations, matcher->isReady() ? "" : ", no model loaded");
+    bench::printHeader("input");
+    for (const Input &input : inputs)
+        runInput(runner, input, *matcher);
+    return 0;
+}
@@ -0,0 +1,453 @@
+// 合成场景帧源：用 synthscene::SceneGenerator 代替相机，驱动与主程序相同的检测流程，
+// 在没有比赛录像时可重复地测量热路径的最坏情况（例如 --scene stress：1440x1080 上 50 个干扰灯光 + 6 块装甲板，
+// 候选灯条两两配对的 O(n^2) 组合与逐个装甲板的网络推理）。
+//
+// 默认先渲染 --cache 帧（渲染不计时），再循环送入与主程序 --pipeline 相同的多线程流水线
+// （缩小 -> 分割 -> 配对/PnP -> 分类），报告吞吐量、各阶段统计、每帧端到端耗时、配对与分类耗时分位数，
+// 以及候选灯条数、配对数、推理次数与相对真值的检出率。--sequential 改为在当前线程逐帧调用 detectArmors。
+// 默认不使用分类缓存，每个配对都经过推理（最坏情况）；--label-cache 与主程序一样启用缓存。
+//
+// --alloc-check 预热帧数：分配检查（需要以 HIKO_ALLOC_COUNT=ON 构建）。按主程序顺序模式的处理循环（取图拷贝、
+// 带跟踪与分类的 detectArmors）逐帧运行，预热之后统计处理线程每帧的堆分配次数与缺页数，任一帧的分配次数
+// 超过 --max-allocs（默认 0）时输出各阶段计数与分配调用点并返回 2，供 CI 检查“稳定运行后每帧零分配”。
+//
+// --write 目录：把 --frames 帧写成 PNG，并在同一目录写出 hiko_eval 格式的 annotations.yml
+// （附加每块装甲板的 rvec / tvec 真值），之后可用 hiko_eval 目录 评估精度。
+//
+// 用法: hiko_synth [--scene 描述] [--frames 600] [--cache 64] [--workers 2] [--sequential] [--label-cache]
+//                  [--search-scale 0.5] [--model 模型.onnx] [--labels labels.txt] [--write 目录]
+//                  [--alloc-check 预热帧数] [--max-allocs 0]
+// 场景描述见 synthscene.h 中的 parseSceneSpec，如 "stress" 或 "armors=6,clutter=50,color=red,blur=1.2"
+
+#include "ArmorMatcher.h"
+#include "alloccount.h"
+#include "bench_util.h"
+#include "framealloc.h"
+#include "labelcache.h"
+#include "pipeline.h"
+#include "process.h"
+#include "synthscene.h"
+#include "tracker.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <opencv2/imgcodecs.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cv;
+
+namespace
+{
+struct SynthFrame
+{
+    uint64_t sequence = 0;
+    size_t scene = 0; // 对应的缓存帧
+    std::chrono::steady_clock::time_point started;
+    Mat bgr; // 全分辨率图像，相当于相机转换后的输出
+    DetectionFrame detection;
+    framealloc::FrameArena arena;
+};
+
+// 单帧的工作量与耗时
+struct FrameResult
+{
+    double totalMs = 0.0; // 流水线模式为进入流水线到输出，顺序模式为 detectArmors 总耗时
+    double pairingMs = 0.0;
+    double classifyMs = 0.0;
+    int candidates = 0;
+    int pairs = 0;
+    int inferences = 0;
+    int truth = 0;
+    int found = 0; // 有检测结果落在其附近的真值装甲板数
+};
+
+// 真值装甲板中心附近（0.3 倍装甲板宽度以内）有检测结果即视为检出；只用于确认场景确实被检测到，
+// 精确的角点与分类评估请用 --write 导出后交给 hiko_eval
+int countFound(const std::vector<synthscene::ArmorTruth> &truth, const std::vector<ArmorDetection> &detections)
+{
+    int found = 0;
+    for (const synthscene::ArmorTruth &t : truth)
+    {
+        const Point2f center = (t.corners[0] + t.corners[1] + t.corners[2] + t.corners[3]) * 0.25f;
+        const double limit = 0.3 * norm(t.corners[1] - t.corners[0]);
+        for (const ArmorDetection &det : detections)
+        {
+            const std::array<Point2f, 4> &q = det.fullCorners;
+            const Point2f c = (q[0] + q[1] + q[2] + q[3]) * 0.25f;
+            if (norm(c - center) <= limit)
+            {
+                found++;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+FrameResult makeResult(const DetectionTiming &timing, const std::vector<ArmorDetection> &detections,
+                       const synthscene::SceneFrame &scene)
+{
+    FrameResult r;
+    r.totalMs = timing.totalMs;
+    r.pairingMs = timing.pairingMs;
+    r.classifyMs = timing.classifyMs;
+    r.candidates = timing.candidateCount;
+    r.pairs = static_cast<int>(detections.size());
+    r.inferences = timing.inferenceCount;
+    r.truth = static_cast<int>(scene.armors.size());
+    r.found = countFound(scene.armors, detections);
+    return r;
+}
+
+void report(const std::vector<FrameResult> &results)
+{
+    std::vector<double> total, pairing, classify;
+    double candidates = 0, pairs = 0, inferences = 0;
+    int maxCandidates = 0, maxPairs = 0, maxInferences = 0;
+    long truth = 0, found = 0;
+    for (const FrameResult &r : results)
+    {
+        total.push_back(r.totalMs * 1e6);
+        pairing.push_back(r.pairingMs * 1e6);
+        classify.push_back(r.classifyMs * 1e6);
+        candidates += r.candidates;
+        pairs += r.pairs;
+        inferences += r.inferences;
+        maxCandidates = std::max(maxCandidates, r.candidates);
+        maxPairs = std::max(maxPairs, r.pairs);
+        maxInferences = std::max(maxInferences, r.inferences);
+        truth += r.truth;
+        found += r.found;
+    }
+    const double n = std::max<size_t>(1, results.size());
+    bench::printHeader();
+    bench::printRow("frame total", bench::summarize(total));
+    bench::printRow("pairing + refine + pnp", bench::summarize(pairing));
+    bench::printRow("warp + classify", bench::summarize(classify));
+    std::printf("per frame: candidates %.1f (max %d) | armors paired %.1f (max %d) | inferences %.1f (max %d)\n",
+                candidates / n, maxCandidates, pairs / n, maxPairs, inferences / n, maxInferences);
+    std::printf("ground truth found: %ld / %ld (%.1f%%)\n", found, truth, truth > 0 ? 100.0 * found / truth : 0.0);
+}
+
+// 导出图像与 hiko_eval 格式的标注
+bool writeDataset(synthscene::SceneGenerator &generator, size_t frames, const std::string &dir)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    FileStorage out;
+    if (!out.open((fs::path(dir) / "annotations.yml").string(), FileStorage::WRITE))
+        return false;
+    out << "camera_matrix" << generator.cameraMatrix();
+    out << "frames" << "[";
+    synthscene::SceneFrame frame;
+    for (size_t i = 0; i < frames; i++)
+    {
+        generator.next(frame);
+        char name[32];
+        std::snprintf(name, sizeof(name), "%06zu.png", i);
+        if (!imwrite((fs::path(dir) / name).string(), frame.bgr))
+            return false;
+        out << "{" << "image" << name << "armors" << "[";
+        for (const synthscene::ArmorTruth &armor : frame.armors)
+        {
+            out << "{" << "corners" << "[";
+            for (const Point2f &p : armor.corners)
+                out << p.x << p.y;
+            out << "]";
+            out << "label" << armor.label << "distance" << armor.distance;
+            out << "rvec" << armor.rvec << "tvec" << armor.tvec;
+            out << "}";
+        }
+        out << "]" << "}";
+    }
+    out << "]";
+    out.release();
+    std::printf("wrote %zu frames and annotations.yml to %s\n", frames, dir.c_str());
+    return true;
+}
+
+std::vector<FrameResult> runSequential(const std::vector<synthscene::SceneFrame> &cache, size_t frames,
+                                       float searchScale, bool useLabelCache, double fps)
+{
+    std::vector<FrameResult> results;
+    results.reserve(frames);
+    ArmorTracker tracker;
+    LabelCache labels;
+    DetectionContext context;
+    context.searchScale = searchScale;
+    context.tracker = &tracker;
+    context.labels = useLabelCache ? &labels : nullptr;
+    for (size_t i = 0; i < frames; i++)
+    {
+        const synthscene::SceneFrame &scene = cache[i % cache.size()];
+        context.timestamp = i / fps;
+        DetectionTiming timing;
+        std::vector<ArmorDetection> detections = detectArmors(scene.bgr, context, &timing);
+        results.push_back(makeResult(timing, detections, scene));
+    }
+    return results;
+}
+
+// 分配检查：与主程序顺序模式相同的处理循环，预热之后逐帧统计当前线程的分配
+int runAllocCheck(const std::vector<synthscene::SceneFrame> &cache, size_t frames, size_t warmup, uint64_t maxAllocs,
+                  float searchScale, bool useLabelCache, double fps)
+{
+    if (!alloccount::compiled())
+    {
+        std::fprintf(stderr, "--alloc-check requires a build with HIKO_ALLOC_COUNT=ON\n");
+        return 1;
+    }
+    ArmorTracker tracker;
+    LabelCache labels;
+    DetectionContext context;
+    context.tracker = &tracker;
+    context.labels = useLabelCache ? &labels : nullptr;
+    context.searchScale = searchScale;
+    // 相当于 GrabImageBGR 写入的相机缓冲区
+    Mat grabbed(cache.front().bgr.size(), CV_8UC3);
+
+    alloccount::Reporter reporter;
+    std::vector<double> allocations, minorFaults;
+    uint64_t worst = 0, worstFrame = 0, failedFrames = 0, bytes = 0;
+    for (size_t i = 0; i < warmup + frames; i++)
+    {
+        const bool measured = i >= warmup;
+        if (i == warmup)
+        {
+            reporter.take();
+            alloccount::setSiteCapture(true);
+        }
+        const alloccount::Counters before = alloccount::threadCounters();
+        {
+            HIKO_ALLOC_STAGE(Grab);
+            cache[i % cache.size()].bgr.copyTo(grabbed);
+        }
+        context.timestamp = i / fps;
+        bench::doNotOptimize(detectArmors(grabbed, context));
+        const alloccount::Counters delta = alloccount::threadCounters() - before;
+        if (!measured)
+            continue;
+        allocations.push_back(static_cast<double>(delta.allocations));
+        minorFaults.push_back(static_cast<double>(delta.minorFaults));
+        bytes += delta.bytes;
+        if (delta.allocations > maxAllocs)
+            failedFrames++;
+        if (delta.allocations > worst)
+        {
+            worst = delta.allocations;
+            worstFrame = i;
+        }
+    }
+    alloccount::setSiteCapture(false);
+
+    const bench::Summary a = bench::summarize(allocations), f = bench::summarize(minorFaults);
+    std::printf("allocation check: %zu warm-up frames, %zu measured frames, limit %llu allocations per frame\n",
+                warmup, frames, static_cast<unsigned long long>(maxAllocs));
+    std::printf("allocations per frame: mean %.2f p99 %.0f max %llu (frame %llu) | bytes per frame %.0f | "
+                "minor faults per frame: mean %.2f max %.0f\n",
+                a.meanNs, a.p99Ns, static_cast<unsigned long long>(worst), static_cast<unsigned long long>(worstFrame),
+                frames > 0 ? static_cast<double>(bytes) / frames : 0.0, f.meanNs, f.maxNs);
+    std::printf("per stage:\n%s", alloccount::Reporter::format(reporter.take(), frames).c_str());
+    if (failedFrames == 0)
+    {
+        std::printf("PASS\n");
+        return 0;
+    }
+    std::printf("allocation sites after warm-up:\n%s", alloccount::formatSites(alloccount::takeSites(10)).c_str());
+    std::printf("FAIL: %llu of %zu frames exceed the limit\n", static_cast<unsigned long long>(failedFrames),
+                frames);
+    return 2;
+}
+
+std::vector<FrameResult> runPipelined(const std::vector<synthscene::SceneFrame> &cache, size_t frames,
+                                      float searchScale, bool useLabelCache, double fps, int workers)
+{
+    ArmorTracker tracker;   // 只由 track 阶段访问
+    LabelCache labels;      // 由 track（查询）与 label_store（写回）两个保序阶段经 labelsMutex 互斥访问
+    std::mutex labelsMutex;
+    pipeline::FramePipeline<SynthFrame> pipe(8, 4);
+    std::vector<FrameResult> results;
+    results.reserve(frames);
+    std::atomic<size_t> done(0);
+    size_t submitted = 0; // 仅 source 线程访问
+
+    pipe.setSource([&](SynthFrame &ctx) {
+        if (submitted >= frames)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return false;
+        }
+        ctx.scene = submitted++ % cache.size();
+        ctx.started = std::chrono::steady_clock::now();
+        // 相当于主程序中相机转换写入上下文自己的缓冲区
+        cache[ctx.scene].bgr.copyTo(ctx.bgr);
+        return true;
+    });
+    pipe.addStage("resize", 1, [&](SynthFrame &ctx) {
+        ctx.arena.reset();
+        ctx.detection.arena = &ctx.arena;
+        ctx.detection.timing = DetectionTiming();
+        if (searchScale < 1.0f)
+        {
+            Mat scaled;
+            resize(ctx.bgr, scaled, Size(), searchScale, searchScale, INTER_AREA);
+            ctx.detection.frame = scaled;
+            ctx.detection.fullFrame = ctx.bgr;
+            ctx.detection.scale = static_cast<float>(scaled.cols) / ctx.bgr.cols;
+        }
+        else
+        {
+            ctx.detection.frame = ctx.bgr;
+            ctx.detection.fullFrame.release();
+            ctx.detection.scale = 1.0f;
+        }
+        ctx.detection.timestamp = ctx.sequence / fps;
+    });
+    pipe.addStage("segment", workers, [](SynthFrame &ctx) { detectLightBars(ctx.detection); });
+    pipe.addStage("pair", workers, [](SynthFrame &ctx) {
+        pairArmors(ctx.detection);
+        rectifyArmors(ctx.detection);
+    });
+    // 与主程序相同：关联、PnP、轨迹提交与分类缓存查询在保序阶段按帧顺序执行，推理多线程执行，结果保序写回
+    pipe.addOrderedStage("track", [&](SynthFrame &ctx) {
+        ctx.detection.tracker = &tracker;
+        ctx.detection.labels = useLabelCache ? &labels : nullptr;
+        solveArmorPoses(ctx.detection);
+        tracker.commit(ctx.detection.detections);
+        std::lock_guard<std::mutex> lock(labelsMutex);
+        lookupArmorLabels(ctx.detection);
+    });
+    pipe.addStage("classify", workers, [](SynthFrame &ctx) { inferArmors(ctx.detection); });
+    pipe.addOrderedStage("label_store", [&](SynthFrame &ctx) {
+        std::lock_guard<std::mutex> lock(labelsMutex);
+        storeArmorLabels(ctx.detection);
+    });
+    pipe.setSink([&](SynthFrame &ctx) {
+        FrameResult r = makeResult(ctx.detection.timing, ctx.detection.detections, cache[ctx.scene]);
+        r.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ctx.started).count();
+        results.push_back(r);
+        done.fetch_add(1, std::memory_order_release);
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!pipe.start())
+        return results;
+    while (done.load(std::memory_order_acquire) < frames)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::vector<pipeline::StageStats> stats = pipe.takeStats();
+    pipe.stop();
+
+    std::printf("pipeline (%d workers): %zu frames in %.2f s, %.1f fps\n", workers, frames, seconds, frames / seconds);
+    std::printf("%s", pipeline::FramePipeline<SynthFrame>::formatStats(stats).c_str());
+    return results;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    synthscene::SceneConfig config;
+    std::string modelPath, labelsPath, writeDir;
+    size_t frames = 600, cacheFrames = 64;
+    int workers = 2;
+    float searchScale = 0.5f;
+    bool sequential = false, useLabelCache = false;
+    long allocWarmup = -1; // 小于 0 表示不做分配检查
+    uint64_t maxAllocs = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--scene" && i + 1 < argc)
+        {
+            std::string error;
+            if (!synthscene::parseSceneSpec(argv[++i], config, error))
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+            frames = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--cache" && i + 1 < argc)
+            cacheFrames = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--workers" && i + 1 < argc)
+            workers = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--search-scale" && i + 1 < argc)
+            searchScale = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--sequential")
+            sequential = true;
+        else if (arg == "--label-cache")
+            useLabelCache = true;
+        else if (arg == "--model" && i + 1 < argc)
+            modelPath = argv[++i];
+        else if (arg == "--labels" && i + 1 < argc)
+            labelsPath = argv[++i];
+        else if (arg == "--write" && i + 1 < argc)
+            writeDir = argv[++i];
+        else if (arg == "--alloc-check" && i + 1 < argc)
+            allocWarmup = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--max-allocs" && i + 1 < argc)
+            maxAllocs = static_cast<uint64_t>(std::max(0, std::atoi(argv[++i])));
+        else
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--scene spec] [--frames 600] [--cache 64] [--workers 2] [--sequential] "
+                         "[--label-cache] [--search-scale 0.5] [--model model.onnx] [--labels labels.txt] "
+                         "[--write dir] [--alloc-check warmup_frames] [--max-allocs 0]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    synthscene::SceneGenerator generator(config);
+    std::printf("scene %dx%d: %d armors, %d clutter lights, distance %.0f-%.0f mm, blur %.1f, noise %.1f, seed %u\n",
+                config.resolution.width, config.resolution.height, config.armors, config.clutter, config.minDistance,
+                config.maxDistance, config.blurSigma, config.noiseSigma, config.seed);
+    if (!writeDir.empty())
+    {
+        if (!writeDataset(generator, frames, writeDir))
+        {
+            std::fprintf(stderr, "cannot write dataset to %s\n", writeDir.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    // PnP 使用生成场景的内参
+    cameraMatrix = generator.cameraMatrix().clone();
+    if (!modelPath.empty())
+    {
+        auto matcher = std::make_shared<armor::ArmorMatcher>();
+        if (!matcher->loadWithLabels(modelPath, labelsPath))
+        {
+            std::fprintf(stderr, "load failed: %s\n", matcher->lastError().c_str());
+            return 1;
+        }
+        armor::setGlobalArmorMatcher(matcher);
+    }
+
+    std::vector<synthscene::SceneFrame> cache(std::min(cacheFrames, frames));
+    for (synthscene::SceneFrame &frame : cache)
+        generator.next(frame);
+
+    const double fps = config.fps > 0 ? config.fps : 100.0;
+    if (allocWarmup >= 0)
+        return runAllocCheck(cache, frames, static_cast<size_t>(allocWarmup), maxAllocs, searchScale, useLabelCache,
+                             fps);
+    std::vector<FrameResult> results =
+        sequential ? runSequential(cache, frames, searchScale, useLabelCache, fps)
+                   : runPipelined(cache, frames, searchScale, useLabelCache, fps, workers);
+    std::printf("%s, %s\n", modelPath.empty() ? "no model loaded" : modelPath.c_str(),
+                useLabelCache ? "label cache on" : "label cache off");
+    report(results);
+    return 0;
+}
@@ -0,0 +1,199 @@
+// 网络输入尺寸基准：对一个或多个 ONNX 模型，比较不同网络输入尺寸下 prepareInput 与单次推理的延迟分布，
+// 并报告每个样本的浮点运算量。输入宽高取自模型的输入形状；模型宽高为动态维度时可用 --sizes 依次指定多个尺寸。
+// 指定正面视图目录时，再以列表中第一个配置为参考报告 top-1 一致率。
+//
+// 用法: input_size_bench <模型.onnx>[,<模型2.onnx>...] [--sizes 150x224,96x144,48x64] [--crops 正面视图目录]
+//                        [--iterations N]
+
+#include "ArmorMatcher.h"
+#include "bench_util.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+
+namespace
+{
+std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+std::vector<Size> parseSizes(const std::string &list)
+{
+    std::vector<Size> sizes;
+    for (const std::string &item : splitList(list))
+    {
+        int w = 0, h = 0;
+        if (std::sscanf(item.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0)
+            sizes.emplace_back(w, h);
+        else
+            std::fprintf(stderr, "bad size: %s\n", item.c_str());
+    }
+    return sizes;
+}
+
+std::vector<Mat> loadImages(const std::string &dir)
+{
+    std::vector<Mat> images;
+    if (dir.empty())
+        return images;
+    std::vector<String> files;
+    glob(dir + "/*", files, false);
+    for (const String &file : files)
+    {
+        Mat image = imread(file, IMREAD_COLOR);
+        if (!image.empty())
+            images.push_back(image);
+    }
+    return images;
+}
+
+// 单样本浮点运算量（百万次），模型无法由 OpenCV DNN 解析时返回 0
+double modelMflops(const std::string &path, int channels, int rows, int cols)
+{
+    try
+    {
+        dnn::Net net = dnn::readNetFromONNX(path);
+        return net.getFLOPS(dnn::MatShape{1, channels, rows, cols}) / 1e6;
+    }
+    catch (const Exception &)
+    {
+        return 0.0;
+    }
+}
+
+// 合成一帧：暗背景上一块轻微倾斜、带亮色数字的装甲板
+Mat makeFrame(std::array<Point2f, 4> &quad)
+{
+    Mat frame(540, 720, CV_8UC3, Scalar(20, 20, 20));
+    quad = {Point2f(300, 210), Point2f(420, 200), Point2f(425, 310), Point2f(305, 320)};
+    std::vector<Point> poly;
+    for (const Point2f &p : quad)
+        poly.emplace_back(cvRound(p.x), cvRound(p.y));
+    fillConvexPoly(frame, poly, Scalar(60, 60, 60));
+    putText(frame, "3", Point(345, 290), FONT_HERSHEY_SIMPLEX, 2.5, Scalar(230, 230, 230), 5);
+    return frame;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr,
+                     "usage: %s <model.onnx>[,<model2.onnx>...] [--sizes 150x224,96x144] [--crops dir] "
+                     "[--iterations N]\n",
+                     argv[0]);
+        return 1;
+    }
+    std::vector<std::string> models = splitList(argv[1]);
+    std::vector<Size> sizes;
+    std::string cropsDir;
+    size_t iterations = 500;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc)
+            sizes = parseSizes(argv[++i]);
+        else if (arg == "--crops" && i + 1 < argc)
+            cropsDir = argv[++i];
+        else if (arg == "--iterations" && i + 1 < argc)
+            iterations = static_cast<size_t>(std::atoi(argv[++i]));
+    }
+    if (sizes.empty())
+        sizes.emplace_back(0, 0); // 只使用模型声明的尺寸
+
+    std::array<Point2f, 4> quad;
+    Mat frame = makeFrame(quad);
+    std::vector<Mat> crops = loadImages(cropsDir);
+
+    std::vector<int> reference;
+    std::string referenceName;
+    bench::printHeader("MFLOPs/sample");
+    for (const std::string &modelPath : models)
+    {
+        for (const Size &size : sizes)
+        {
+            armor::ArmorMatcher matcher;
+            matcher.setMaxContexts(1);
+            if (!matcher.load(modelPath, size.width, size.height))
+            {
+                std::printf("%-36s load failed: %s\n", modelPath.c_str(), matcher.lastError().c_str());
+                continue;
+            }
+            // 模型宽高固定时 --sizes 不起作用，跳过重复的配置
+            if (size.width > 0 && (matcher.inputWidth() != size.width || matcher.inputHeight() != size.height) &&
+                &size != &sizes.front())
+                continue;
+
+            std::string name = modelPath.substr(modelPath.find_last_of('/') + 1) + " " +
+                               std::to_string(matcher.inputWidth()) + "x" + std::to_string(matcher.inputHeight());
+            char flops[32];
+            std::snprintf(flops, sizeof(flops), "%.1f",
+                          modelMflops(modelPath, 3, matcher.inputHeight(), matcher.inputWidth()));
+
+            Mat blob, frontView;
+            bench::Summary prepare = bench::measure(
+                [&](size_t) {
+                    matcher.prepareInput(frame, quad, blob, frontView);
+                    bench::doNotOptimize(blob);
+                },
+                iterations);
+            bench::printRow(name + " prepare", prepare);
+
+            armor::MatchResult probe = matcher.matchBlob(blob);
+            if (!probe.success)
+            {
+                std::printf("%-36s inference failed: %s\n", name.c_str(), probe.error.c_str());
+                continue;
+            }
+            bench::Summary inference = bench::measure(
+                [&](size_t) {
+                    armor::MatchResult result = matcher.matchBlob(blob);
+                    bench::doNotOptimize(result);
+                },
+                iterations);
+            bench::printRow(name + " inference", inference, flops);
+
+            if (crops.empty())
+                continue;
+            std::vector<int> predictions(crops.size(), -1);
+            Mat cropBlob;
+            for (size_t i = 0; i < crops.size(); i++)
+            {
+                armor::MatchResult result;
+                if (matcher.prepareImage(crops[i], cropBlob))
+                    result = matcher.matchBlob(cropBlob);
+                predictions[i] = result.success ? result.classId : -1;
+            }
+            if (reference.empty())
+            {
+                reference = predictions;
+                referenceName = name;
+                continue;
+            }
+            size_t agree = 0;
+            for (size_t i = 0; i < predictions.size(); i++)
+                agree += predictions[i] == reference[i] && predictions[i] >= 0;
+            std::printf("%-36s top-1 agreement with %s: %.2f%% (%zu/%zu)\n", name.c_str(), referenceName.c_str(),
+                        100.0 * agree / predictions.size(), agree, predictions.size());
+        }
+    }
+    return 0;
+}
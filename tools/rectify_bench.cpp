@@ -0,0 +1,117 @@
+// 装甲板正面视图 + 网络输入预处理微基准：
+// 旧流程（warp 到 224x224 -> 裁剪 clone -> 灰度 -> 二值化 -> GRAY2BGR -> resize -> 裁剪 clone
+// -> convertTo -> split/normalize/merge -> blobFromImage）与 ArmorMatcher::prepareInput 的单次变换对比，
+// 同时报告两者生成张量的差异。
+//
+// 用法: rectify_bench [迭代次数=2000]
+
+#include "ArmorMatcher.h"
+#include "bench_util.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <opencv2/opencv.hpp>
+#include <random>
+
+using namespace cv;
+
+namespace
+{
+// 复刻旧的 warpArmorToFrontView + ArmorMatcher::match 预处理部分
+Mat legacyPreprocess(const Mat &frame, const std::array<Point2f, 4> &quad)
+{
+    std::vector<Point2f> src(quad.begin(), quad.end());
+    std::vector<Point2f> dst = {Point2f(0, 0), Point2f(223, 0), Point2f(223, 223), Point2f(0, 223)};
+    Mat warped;
+    warpPerspective(frame, warped, getPerspectiveTransform(src, dst), Size(224, 224));
+    Mat cropped = warped(Rect(50, 0, 124, 224)).clone();
+
+    Mat gray, bw, bgr, resized;
+    cvtColor(cropped, gray, COLOR_BGR2GRAY);
+    threshold(gray, bw, 40, 255, THRESH_BINARY);
+    cvtColor(bw, bgr, COLOR_GRAY2BGR);
+    resize(bgr, resized, Size(224, 224), 0, 0, INTER_LINEAR);
+    resized = resized(Rect(37, 0, 150, 224)).clone();
+    resized.convertTo(resized, CV_32F, 1.0f / 255.0f);
+
+    const float mean[3] = {0.485f, 0.456f, 0.406f};
+    const float stdv[3] = {0.229f, 0.224f, 0.225f};
+    std::vector<Mat> chans(3);
+    split(resized, chans);
+    for (int i = 0; i < 3; i++)
+        chans[i] = (chans[i] - mean[i]) / stdv[i];
+    merge(chans, resized);
+    return dnn::blobFromImage(resized);
+}
+
+// 合成一帧：暗背景上若干块带亮色数字区域的倾斜装甲板
+Mat makeFrame(std::vector<std::array<Point2f, 4>> &quads)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> cx(200.f, 520.f), cy(150.f, 390.f), w(60.f, 140.f), tilt(-0.25f, 0.25f);
+    Mat frame(540, 720, CV_8UC3, Scalar(20, 20, 20));
+    randn(frame, Scalar(25, 25, 25), Scalar(8, 8, 8));
+    for (int i = 0; i < 8; i++)
+    {
+        float x = cx(rng), y = cy(rng), width = w(rng), t = tilt(rng), h = width * 0.9f;
+        std::array<Point2f, 4> q = {Point2f(x - width / 2, y - h / 2 + t * width), Point2f(x + width / 2, y - h / 2 - t * width),
+                                    Point2f(x + width / 2, y + h / 2 - t * width), Point2f(x - width / 2, y + h / 2 + t * width)};
+        quads.push_back(q);
+        std::vector<Point> poly;
+        for (const Point2f &p : q)
+            poly.emplace_back(cvRound(p.x), cvRound(p.y));
+        fillConvexPoly(frame, poly, Scalar(60, 60, 60));
+        putText(frame, std::to_string(i % 9 + 1), Point(cvRound(x - width * 0.15f), cvRound(y + h * 0.15f)),
+                FONT_HERSHEY_SIMPLEX, width / 60.0, Scalar(230, 230, 230), 3);
+    }
+    return frame;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 2000;
+
+    std::vector<std::array<Point2f, 4>> quads;
+    Mat frame = makeFrame(quads);
+    armor::ArmorMatcher matcher; // 只使用预处理，不需要加载模型
+
+    bench::printHeader();
+    bench::Summary legacy = bench::measure(
+        [&](size_t i) {
+            Mat blob = legacyPreprocess(frame, quads[i % quads.size()]);
+            bench::doNotOptimize(blob);
+        },
+        iterations);
+    bench::printRow("legacy (multi-pass)", legacy);
+
+    Mat blob, frontView;
+    bench::Summary fused = bench::measure(
+        [&](size_t i) {
+            matcher.prepareInput(frame, quads[i % quads.size()], blob, frontView);
+            bench::doNotOptimize(blob);
+        },
+        iterations);
+    bench::printRow("fused prepareInput", fused);
+
+    // 张量一致性：旧流程在二值图上做双线性缩放，边缘处为过渡值，新流程直接二值化，只在边缘像素上有差异
+    double maxDiff = 0.0, meanDiff = 0.0;
+    for (const auto &quad : quads)
+    {
+        Mat reference = legacyPreprocess(frame, quad);
+        if (!matcher.prepareInput(frame, quad, blob, frontView) || reference.total() != blob.total())
+        {
+            std::printf("shape mismatch\n");
+            return 1;
+        }
+        Mat diff;
+        absdiff(reference.reshape(1, 1), blob.reshape(1, 1), diff);
+        double mx;
+        minMaxLoc(diff, nullptr, &mx);
+        maxDiff = std::max(maxDiff, mx);
+        meanDiff += mean(diff)[0] / quads.size();
+    }
+    std::printf("speedup %.2fx, tensor diff vs legacy: mean %.4f, max %.4f\n", legacy.meanNs / fused.meanNs, meanDiff,
+                maxDiff);
+    return 0;
+}
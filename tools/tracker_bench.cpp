@@ -0,0 +1,105 @@
+// 跟踪器微基准：合成若干匀速运动（带随机加速度与角点噪声）的装甲板，
+// 统计每帧关联 + 更新耗时以及 ID 切换次数。
+//
+// 用法: tracker_bench [帧数=2000]
+
+#include "bench_util.h"
+#include "tracker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace cv;
+
+namespace
+{
+struct Target
+{
+    Point2f center;
+    Point2f velocity; // px/s
+    float width;
+    int lastTrackId = -1;
+};
+
+std::array<Point2f, 4> targetCorners(const Target &t)
+{
+    float hw = t.width / 2, hh = t.width * 0.28f;
+    return {Point2f(t.center.x - hw, t.center.y - hh), Point2f(t.center.x + hw, t.center.y - hh),
+            Point2f(t.center.x + hw, t.center.y + hh), Point2f(t.center.x - hw, t.center.y + hh)};
+}
+
+void runCase(int numTargets, int frames)
+{
+    const double dt = 1.0 / 100.0;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> posX(100.f, 1340.f), posY(100.f, 980.f);
+    std::uniform_real_distribution<float> vel(-400.f, 400.f), width(30.f, 90.f);
+    std::normal_distribution<float> accel(0.f, 2000.f), noise(0.f, 0.5f);
+
+    std::vector<Target> targets(numTargets);
+    for (Target &t : targets)
+        t = {Point2f(posX(rng), posY(rng)), Point2f(vel(rng), vel(rng)), width(rng)};
+
+    // 预先生成全部帧，计时只覆盖跟踪器本身
+    std::vector<std::vector<ArmorDetection>> sequence(frames);
+    for (int f = 0; f < frames; f++)
+    {
+        for (Target &t : targets)
+        {
+            t.velocity += Point2f(accel(rng), accel(rng)) * static_cast<float>(dt);
+            t.center += t.velocity * static_cast<float>(dt);
+            // 在画面边缘反弹，保持目标数量不变
+            if (t.center.x < 50 || t.center.x > 1390)
+                t.velocity.x = -t.velocity.x;
+            if (t.center.y < 50 || t.center.y > 1030)
+                t.velocity.y = -t.velocity.y;
+
+            ArmorDetection det;
+            det.corners = targetCorners(t);
+            for (Point2f &p : det.corners)
+                p += Point2f(noise(rng), noise(rng));
+            sequence[f].push_back(det);
+        }
+    }
+
+    ArmorTracker tracker;
+    std::vector<std::vector<int>> ids(frames);
+    bench::Summary timing = bench::measure(
+        [&](size_t i) {
+            std::vector<ArmorDetection> &dets = sequence[i];
+            tracker.update(dets, 1.0 + i * dt);
+            bench::doNotOptimize(dets);
+        },
+        frames, 0);
+
+    // 同一目标的 trackId 在相邻帧之间发生变化即计为一次 ID 切换
+    int switches = 0;
+    std::vector<int> last(numTargets, -1);
+    for (int f = 0; f < frames; f++)
+    {
+        for (int k = 0; k < numTargets; k++)
+        {
+            int id = sequence[f][k].trackId;
+            if (last[k] >= 0 && id != last[k])
+                switches++;
+            last[k] = id;
+        }
+    }
+
+    char name[64], extra[96];
+    std::snprintf(name, sizeof(name), "update (%d targets)", numTargets);
+    std::snprintf(extra, sizeof(extra), "id switches %d / %d frames, tracks %zu", switches, frames,
+                  tracker.tracks().size());
+    bench::printRow(name, timing, extra);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+    bench::printHeader("association");
+    for (int n : {1, 4, 10, 30, 60})
+        runCase(n, frames);
+    return 0;
+}
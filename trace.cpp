@@ -0,0 +1,207 @@
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace trace
+{
+
+namespace
+{
+// 环形缓冲区中的一个事件。写入方先把 sequence 置为奇数，写完字段后置为 2 * (位置 + 1)，
+// 读取方前后两次读到相同的偶数序号才认为字段完整（seqlock）
+struct Event
+{
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> beginNs{0};
+    std::atomic<uint64_t> durationNs{0};
+    std::atomic<uint64_t> frameId{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint32_t> thread{0};
+    std::atomic<int32_t> candidates{-1};
+    std::atomic<int32_t> inferences{-1};
+};
+
+struct Ring
+{
+    explicit Ring(size_t capacity) : events(new Event[capacity]), mask(capacity - 1)
+    {
+    }
+
+    std::unique_ptr<Event[]> events;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> head{0};
+};
+
+// 不析构：工作线程可能在静态对象析构后仍在记录
+std::atomic<Ring *> g_ring{nullptr};
+std::atomic<uint64_t> g_slowFrameNs{0};
+std::atomic<bool> g_dumpRequested{false};
+std::atomic<uint32_t> g_nextThread{1};
+
+std::mutex g_dumpMutex;
+std::string g_outputDir;
+std::chrono::steady_clock::time_point g_lastDump;
+int g_dumpCount = 0;
+
+constexpr std::chrono::seconds kDumpInterval(2);
+
+// 输出目录下新的转储文件名，调用方持有 g_dumpMutex
+std::string nextDumpPath()
+{
+    long long stamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+    return (g_outputDir.empty() ? std::string() : g_outputDir + "/") + "trace_" + std::to_string(stamp) + "_" +
+           std::to_string(g_dumpCount++) + ".json";
+}
+
+uint32_t threadId()
+{
+    thread_local uint32_t id = g_nextThread.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+} // namespace
+
+void enable(size_t capacity, const std::string &outputDir)
+{
+    std::lock_guard<std::mutex> lock(g_dumpMutex);
+    g_outputDir = outputDir;
+    if (g_ring.load(std::memory_order_acquire))
+        return;
+    size_t cap = 2;
+    while (cap < capacity)
+        cap <<= 1;
+    g_ring.store(new Ring(cap), std::memory_order_release);
+}
+
+bool active() noexcept
+{
+    return g_ring.load(std::memory_order_relaxed) != nullptr;
+}
+
+void span(const char *name, uint64_t beginNs, uint64_t durationNs, uint64_t frameId, int candidates,
+          int inferences) noexcept
+{
+    Ring *ring = g_ring.load(std::memory_order_acquire);
+    if (!ring)
+        return;
+    uint64_t pos = ring->head.fetch_add(1, std::memory_order_relaxed);
+    Event &e = ring->events[pos & ring->mask];
+    e.sequence.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.beginNs.store(beginNs, std::memory_order_relaxed);
+    e.durationNs.store(durationNs, std::memory_order_relaxed);
+    e.frameId.store(frameId, std::memory_order_relaxed);
+    e.name.store(name, std::memory_order_relaxed);
+    e.thread.store(threadId(), std::memory_order_relaxed);
+    e.candidates.store(candidates, std::memory_order_relaxed);
+    e.inferences.store(inferences, std::memory_order_relaxed);
+    e.sequence.store(2 * pos + 2, std::memory_order_release);
+}
+
+void setSlowFrameThreshold(double ms) noexcept
+{
+    g_slowFrameNs.store(ms > 0.0 ? static_cast<uint64_t>(ms * 1e6) : 0, std::memory_order_relaxed);
+}
+
+void frameCompleted(uint64_t durationNs) noexcept
+{
+    uint64_t threshold = g_slowFrameNs.load(std::memory_order_relaxed);
+    if (threshold > 0 && durationNs > threshold && active())
+        g_dumpRequested.store(true, std::memory_order_relaxed);
+}
+
+void requestDump() noexcept
+{
+    g_dumpRequested.store(true, std::memory_order_relaxed);
+}
+
+bool dumpIfRequested(std::string *path)
+{
+    if (!g_dumpRequested.load(std::memory_order_relaxed) || !active())
+        return false;
+
+    std::string file;
+    {
+        std::lock_guard<std::mutex> lock(g_dumpMutex);
+        auto now = std::chrono::steady_clock::now();
+        if (g_dumpCount > 0 && now - g_lastDump < kDumpInterval)
+            return false;
+        g_dumpRequested.store(false, std::memory_order_relaxed);
+        g_lastDump = now;
+        file = nextDumpPath();
+    }
+    if (!dump(file))
+        return false;
+    if (path)
+        *path = file;
+    return true;
+}
+
+bool dumpNow(std::string *path)
+{
+    if (!active())
+        return false;
+    std::string file;
+    {
+        std::lock_guard<std::mutex> lock(g_dumpMutex);
+        g_lastDump = std::chrono::steady_clock::now();
+        file = nextDumpPath();
+    }
+    if (!dump(file))
+        return false;
+    if (path)
+        *path = file;
+    return true;
+}
+
+bool dump(const std::string &path)
+{
+    Ring *ring = g_ring.load(std::memory_order_acquire);
+    if (!ring)
+        return false;
+    FILE *fp = std::fopen(path.c_str(), "w");
+    if (!fp)
+        return false;
+
+    std::fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(fp, "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"hiko\"}}");
+
+    // 从最旧的仍在缓冲区中的事件开始，按写入顺序输出
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t capacity = ring->mask + 1;
+    for (uint64_t pos = head > capacity ? head - capacity : 0; pos < head; pos++)
+    {
+        const Event &e = ring->events[pos & ring->mask];
+        const uint64_t expected = 2 * pos + 2;
+        if (e.sequence.load(std::memory_order_acquire) != expected)
+            continue; // 尚未写完或已被覆盖
+        uint64_t beginNs = e.beginNs.load(std::memory_order_relaxed);
+        uint64_t durationNs = e.durationNs.load(std::memory_order_relaxed);
+        uint64_t frameId = e.frameId.load(std::memory_order_relaxed);
+        const char *name = e.name.load(std::memory_order_relaxed);
+        uint32_t thread = e.thread.load(std::memory_order_relaxed);
+        int candidates = e.candidates.load(std::memory_order_relaxed);
+        int inferences = e.inferences.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.sequence.load(std::memory_order_relaxed) != expected || !name)
+            continue;
+
+        std::fprintf(fp,
+                     ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,"
+                     "\"args\":{\"frame\":%llu",
+                     thread, name, beginNs / 1e3, durationNs / 1e3, static_cast<unsigned long long>(frameId));
+        if (candidates >= 0)
+            std::fprintf(fp, ",\"candidates\":%d", candidates);
+        if (inferences >= 0)
+            std::fprintf(fp, ",\"inferences\":%d", inferences);
+        std::fprintf(fp, "}}");
+    }
+    std::fprintf(fp, "\n]}\n");
+    return std::fclose(fp) == 0;
+}
+
+} // namespace trace
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 逐帧追踪：把各阶段的耗时区间（Chrome 追踪格式的完整事件，含开始时刻与时长）写入预分配的无锁环形缓冲区，
+// 只保留最近的事件；按需转储为 Chrome trace JSON，可直接在 Perfetto / chrome://tracing 中打开。
+// 区间由 frametiming 的埋点产生，未开启时每个埋点只多一次原子读取。
+namespace trace
+{
+
+/**
+ * @brief 开启记录，预分配 capacity 个事件（向上取整为 2 的幂）；应在启动工作线程之前调用一次
+ * @param outputDir 转储文件所在目录，为空表示当前目录
+ */
+void enable(size_t capacity, const std::string &outputDir);
+
+bool active() noexcept;
+
+/**
+ * @brief 记录一个区间；candidates / inferences 为负时不输出
+ * @param name 静态字符串（只保存指针）
+ */
+void span(const char *name, uint64_t beginNs, uint64_t durationNs, uint64_t frameId, int candidates = -1,
+          int inferences = -1) noexcept;
+
+/**
+ * @brief 端到端耗时超过阈值的帧触发转储，<= 0 表示不按耗时触发
+ */
+void setSlowFrameThreshold(double ms) noexcept;
+
+/**
+ * @brief 一帧结束时调用，超过慢帧阈值时请求转储
+ */
+void frameCompleted(uint64_t durationNs) noexcept;
+
+/**
+ * @brief 请求转储（只设置标志，可在信号处理函数中调用），实际写文件由 dumpIfRequested 完成
+ */
+void requestDump() noexcept;
+
+/**
+ * @brief 在非热路径线程上周期性调用：有转储请求时写出当前缓冲区
+ *
+ * 两次转储至少间隔 2 秒，期间的请求合并到下一次；写文件期间记录不暂停，正在被覆盖的事件被跳过。
+ * @param path 输出写入的文件路径
+ * @return 是否写出了文件
+ */
+bool dumpIfRequested(std::string *path = nullptr);
+
+/**
+ * @brief 立即转储到输出目录下新的文件（程序退出时使用），不受转储间隔限制
+ */
+bool dumpNow(std::string *path = nullptr);
+
+/**
+ * @brief 立即把当前缓冲区写为 Chrome trace JSON
+ */
+bool dump(const std::string &path);
+
+} // namespace trace
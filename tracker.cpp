@@ -0,0 +1,335 @@
+#include "tracker.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+// 超出关联门限的代价，匈牙利算法需要有限值
+constexpr double kInfeasibleCost = 1e6;
+
+float plateWidth(const array<Point2f, 4> &corners)
+{
+    // 上下两条边的平均长度
+    Point2f top = corners[1] - corners[0];
+    Point2f bottom = corners[2] - corners[3];
+    return 0.5f * (sqrt(top.dot(top)) + sqrt(bottom.dot(bottom)));
+}
+} // namespace
+
+Rect2f ArmorTracker::Track::predictedRoi(float margin) const
+{
+    float minX = predicted[0].x, maxX = predicted[0].x;
+    float minY = predicted[0].y, maxY = predicted[0].y;
+    for (const Point2f &p : predicted)
+    {
+        minX = min(minX, p.x);
+        maxX = max(maxX, p.x);
+        minY = min(minY, p.y);
+        maxY = max(maxY, p.y);
+    }
+    float pad = margin * plateWidth(predicted);
+    return Rect2f(minX - pad, minY - pad, maxX - minX + 2 * pad, maxY - minY + 2 * pad);
+}
+
+ArmorTracker::ArmorTracker() : ArmorTracker(Params())
+{
+}
+
+ArmorTracker::ArmorTracker(const Params &params) : m_params(params)
+{
+}
+
+void ArmorTracker::reset()
+{
+    m_tracks.clear();
+    m_nextId = 0;
+    m_associated = false;
+}
+
+void ArmorTracker::initTrack(Track &track, const array<Point2f, 4> &corners, double timestamp) const
+{
+    for (int k = 0; k < 4; k++)
+    {
+        track.m_x[2 * k] = corners[k].x;
+        track.m_x[2 * k + 1] = corners[k].y;
+        track.m_v[2 * k] = track.m_v[2 * k + 1] = 0.0;
+    }
+    double r = m_params.measurementNoise;
+    double v = m_params.initialVelocity;
+    track.m_p00 = r * r;
+    track.m_p01 = 0.0;
+    track.m_p11 = v * v;
+    track.m_time = timestamp;
+    track.corners = track.predicted = corners;
+    track.velocity = Point2f(0, 0);
+}
+
+void ArmorTracker::predict(Track &track, double timestamp) const
+{
+    // 时间戳无效（<= 0）或跳变时按默认帧间隔预测；同一时间戳重复预测不做任何事
+    double dt = timestamp - track.m_time;
+    if (timestamp > 0.0 && dt == 0.0)
+        return;
+    if (timestamp <= 0.0 || dt < 0.0 || dt > 1.0)
+        dt = m_params.defaultDt;
+
+    // 白噪声加速度模型的过程噪声
+    double q = m_params.accelNoise * m_params.accelNoise;
+    double dt2 = dt * dt;
+    double p00 = track.m_p00 + 2 * dt * track.m_p01 + dt2 * track.m_p11 + q * dt2 * dt2 / 4;
+    double p01 = track.m_p01 + dt * track.m_p11 + q * dt2 * dt / 2;
+    double p11 = track.m_p11 + q * dt2;
+    track.m_p00 = p00;
+    track.m_p01 = p01;
+    track.m_p11 = p11;
+
+    for (int i = 0; i < 8; i++)
+        track.m_x[i] += track.m_v[i] * dt;
+    track.m_time = timestamp;
+
+    for (int k = 0; k < 4; k++)
+        track.predicted[k] = Point2f(static_cast<float>(track.m_x[2 * k]), static_cast<float>(track.m_x[2 * k + 1]));
+}
+
+void ArmorTracker::correct(Track &track, const array<Point2f, 4> &corners) const
+{
+    double r = m_params.measurementNoise * m_params.measurementNoise;
+    double s = track.m_p00 + r;
+    double k0 = track.m_p00 / s;
+    double k1 = track.m_p01 / s;
+
+    double vx = 0.0, vy = 0.0;
+    for (int k = 0; k < 4; k++)
+    {
+        double zx = corners[k].x - track.m_x[2 * k];
+        double zy = corners[k].y - track.m_x[2 * k + 1];
+        track.m_x[2 * k] += k0 * zx;
+        track.m_x[2 * k + 1] += k0 * zy;
+        track.m_v[2 * k] += k1 * zx;
+        track.m_v[2 * k + 1] += k1 * zy;
+        track.corners[k] = Point2f(static_cast<float>(track.m_x[2 * k]), static_cast<float>(track.m_x[2 * k + 1]));
+        vx += track.m_v[2 * k];
+        vy += track.m_v[2 * k + 1];
+    }
+    track.velocity = Point2f(static_cast<float>(vx / 4), static_cast<float>(vy / 4));
+
+    double p00 = (1 - k0) * track.m_p00;
+    double p01 = (1 - k0) * track.m_p01;
+    double p11 = track.m_p11 - k1 * track.m_p01;
+    track.m_p00 = p00;
+    track.m_p01 = p01;
+    track.m_p11 = p11;
+}
+
+double ArmorTracker::associationCost(const Track &track, const array<Point2f, 4> &corners) const
+{
+    double sum = 0.0;
+    for (int k = 0; k < 4; k++)
+    {
+        Point2f d = corners[k] - track.predicted[k];
+        sum += sqrt(d.dot(d));
+    }
+    double width = max(1.0f, plateWidth(track.predicted));
+    return sum / 4.0 / width;
+}
+
+// 匈牙利算法（rows <= cols），代价矩阵为 m_cost[rows x cols]，结果写入 m_rowMatch
+void ArmorTracker::solveAssignment(int rows, int cols)
+{
+    const double inf = numeric_limits<double>::infinity();
+    m_u.assign(rows + 1, 0.0);
+    m_v.assign(cols + 1, 0.0);
+    m_p.assign(cols + 1, 0);
+    m_way.assign(cols + 1, 0);
+
+    for (int i = 1; i <= rows; i++)
+    {
+        m_p[0] = i;
+        int j0 = 0;
+        m_minv.assign(cols + 1, inf);
+        m_used.assign(cols + 1, 0);
+        do
+        {
+            m_used[j0] = 1;
+            int i0 = m_p[j0], j1 = 0;
+            double delta = inf;
+            for (int j = 1; j <= cols; j++)
+            {
+                if (m_used[j])
+                    continue;
+                double cur = m_cost[(i0 - 1) * cols + (j - 1)] - m_u[i0] - m_v[j];
+                if (cur < m_minv[j])
+                {
+                    m_minv[j] = cur;
+                    m_way[j] = j0;
+                }
+                if (m_minv[j] < delta)
+                {
+                    delta = m_minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= cols; j++)
+            {
+                if (m_used[j])
+                {
+                    m_u[m_p[j]] += delta;
+                    m_v[j] -= delta;
+                }
+                else
+                {
+                    m_minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (m_p[j0] != 0);
+        do
+        {
+            int j1 = m_way[j0];
+            m_p[j0] = m_p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    m_rowMatch.assign(rows, -1);
+    for (int j = 1; j <= cols; j++)
+    {
+        if (m_p[j] != 0)
+            m_rowMatch[m_p[j] - 1] = j - 1;
+    }
+}
+
+void ArmorTracker::associate(vector<ArmorDetection> &detections, double timestamp)
+{
+    m_timestamp = timestamp;
+    m_associated = true;
+
+    for (Track &track : m_tracks)
+        predict(track, timestamp);
+
+    m_trackOfDetection.assign(detections.size(), -1);
+    for (ArmorDetection &det : detections)
+        det.trackId = -1;
+    if (detections.empty() || m_tracks.empty())
+        return;
+
+    // 行取较少的一方，保证 rows <= cols
+    int numDet = static_cast<int>(detections.size());
+    int numTrk = static_cast<int>(m_tracks.size());
+    bool detRows = numDet <= numTrk;
+    int rows = detRows ? numDet : numTrk;
+    int cols = detRows ? numTrk : numDet;
+
+    m_cost.resize(static_cast<size_t>(rows) * cols);
+    for (int d = 0; d < numDet; d++)
+    {
+        for (int t = 0; t < numTrk; t++)
+        {
+            double c = associationCost(m_tracks[t], detections[d].corners);
+            if (c > m_params.maxCost)
+                c = kInfeasibleCost;
+            size_t idx = detRows ? static_cast<size_t>(d) * cols + t : static_cast<size_t>(t) * cols + d;
+            m_cost[idx] = c;
+        }
+    }
+
+    solveAssignment(rows, cols);
+
+    for (int r = 0; r < rows; r++)
+    {
+        int c = m_rowMatch[r];
+        if (c < 0 || m_cost[static_cast<size_t>(r) * cols + c] >= kInfeasibleCost)
+            continue;
+        int d = detRows ? r : c;
+        int t = detRows ? c : r;
+        m_trackOfDetection[d] = t;
+        detections[d].trackId = m_tracks[t].id;
+    }
+}
+
+void ArmorTracker::commit(vector<ArmorDetection> &detections)
+{
+    if (!m_associated || m_trackOfDetection.size() != detections.size())
+        associate(detections, m_timestamp);
+    m_associated = false;
+
+    for (Track &track : m_tracks)
+        track.missed++;
+
+    for (size_t d = 0; d < detections.size(); d++)
+    {
+        ArmorDetection &det = detections[d];
+        Track *track;
+        if (m_trackOfDetection[d] >= 0)
+        {
+            track = &m_tracks[m_trackOfDetection[d]];
+            correct(*track, det.corners);
+        }
+        else
+        {
+            m_tracks.emplace_back();
+            track = &m_tracks.back();
+            track->id = m_nextId++;
+            initTrack(*track, det.corners, m_timestamp);
+            det.trackId = track->id;
+        }
+
+        track->hits++;
+        track->missed = 0;
+        track->lastSeen = m_timestamp;
+        if (track->hits >= m_params.minHits)
+            track->confirmed = true;
+
+        if (det.poseValid)
+        {
+            track->pose.valid = true;
+            track->pose.rvec = det.rvec;
+            track->pose.tvec = det.tvec;
+            track->pose.distance = det.distance;
+            track->pose.reprojectionError = det.reprojectionError;
+        }
+        if (det.classified)
+        {
+            track->classified = true;
+            track->classId = det.classId;
+            track->confidence = det.confidence;
+            track->label = det.label;
+        }
+    }
+
+    // 删除丢失过久的轨迹；尚未确认的轨迹丢失一帧即删除，抑制误检产生的短轨迹
+    m_tracks.erase(remove_if(m_tracks.begin(), m_tracks.end(),
+                             [this](const Track &t) {
+                                 return t.missed > m_params.maxMissed || (!t.confirmed && t.missed > 0);
+                             }),
+                   m_tracks.end());
+}
+
+void ArmorTracker::update(vector<ArmorDetection> &detections, double timestamp)
+{
+    associate(detections, timestamp);
+    commit(detections);
+}
+
+const ArmorTracker::Track *ArmorTracker::find(int trackId) const
+{
+    for (const Track &track : m_tracks)
+    {
+        if (track.id == trackId)
+            return &track;
+    }
+    return nullptr;
+}
+
+const ArmorPose *ArmorTracker::priorPose(int trackId) const
+{
+    const Track *track = find(trackId);
+    // 轨迹在关联阶段之前的 missed 反映上一帧是否被观测到
+    if (!track || track->missed > 0 || !track->pose.valid)
+        return nullptr;
+    return &track->pose;
+}
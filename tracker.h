@@ -0,0 +1,100 @@
+#pragma once
+
+#include "pose.h"
+#include "process.h"
+#include <array>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// 多目标装甲板跟踪器：以四角点为观测，逐坐标匀速卡尔曼滤波预测，
+// 匈牙利算法按预测角点做数据关联，为每个目标分配跨帧稳定的 ID。
+// 下游阶段（PnP 热启动、分类复用、ROI 选择）可通过 trackId 读取轨迹上保存的状态。
+// 非线程安全，同一实例只能按帧顺序在一个线程上使用。
+class ArmorTracker
+{
+public:
+    struct Params
+    {
+        double maxCost = 0.6;            // 关联门限：平均角点距离 / 预测装甲板宽度
+        int minHits = 2;                 // 连续命中多少帧后轨迹被确认
+        int maxMissed = 5;               // 连续丢失多少帧后删除轨迹
+        double accelNoise = 3000.0;      // 角点加速度噪声标准差 (px/s^2)
+        double measurementNoise = 1.0;   // 角点观测噪声标准差 (px)
+        double initialVelocity = 1000.0; // 新轨迹速度的初始不确定度 (px/s)
+        double defaultDt = 1.0 / 100.0;  // 时间戳无效时使用的帧间隔 (s)
+    };
+
+    struct Track
+    {
+        int id = -1;
+        int hits = 0;            // 累计命中帧数
+        int missed = 0;          // 连续丢失帧数（0 表示本帧已关联）
+        bool confirmed = false;  // 命中数达到 minHits 后为 true
+        double lastSeen = 0.0;   // 最近一次关联的时间戳 (s)
+
+        std::array<cv::Point2f, 4> corners;   // 最近一次滤波后的角点
+        std::array<cv::Point2f, 4> predicted; // 预测到当前帧时间戳的角点
+        cv::Point2f velocity;                 // 装甲板中心速度 (px/s)
+
+        // 最近一次有效的位姿与分类结果，供下游阶段复用
+        ArmorPose pose;
+        bool classified = false;
+        int classId = -1;
+        double confidence = 0.0;
+        std::string label;
+
+        // 预测角点的外接矩形，按装甲板宽度比例向外扩展 margin
+        cv::Rect2f predictedRoi(float margin = 0.5f) const;
+
+    private:
+        friend class ArmorTracker;
+        double m_x[8] = {}; // 四角点坐标 (x0, y0, ... x3, y3)
+        double m_v[8] = {}; // 对应速度
+        // 所有坐标共享同一观测时刻与噪声模型，协方差相同，只保存一份 2x2 矩阵
+        double m_p00 = 0.0, m_p01 = 0.0, m_p11 = 0.0;
+        double m_time = 0.0;
+    };
+
+    ArmorTracker();
+    explicit ArmorTracker(const Params &params);
+
+    // 关联阶段：把所有轨迹预测到 timestamp，并把检测结果与轨迹关联，
+    // 关联成功的检测写入 ArmorDetection::trackId，其余为 -1
+    void associate(std::vector<ArmorDetection> &detections, double timestamp);
+
+    // 提交阶段：用本帧检测结果（含位姿、分类）更新已关联轨迹，未关联检测新建轨迹并写入 trackId，
+    // 丢失过久的轨迹被删除。必须在 associate 之后以同一组检测结果调用
+    void commit(std::vector<ArmorDetection> &detections);
+
+    // associate + commit，适用于位姿和分类已在关联之前完成的场景
+    void update(std::vector<ArmorDetection> &detections, double timestamp);
+
+    // 可用作 PnP 热启动初值的位姿：轨迹存在、上一帧已关联且位姿有效，否则返回 nullptr
+    const ArmorPose *priorPose(int trackId) const;
+
+    const Track *find(int trackId) const;
+    const std::vector<Track> &tracks() const { return m_tracks; }
+    void reset();
+
+private:
+    void predict(Track &track, double timestamp) const;
+    void correct(Track &track, const std::array<cv::Point2f, 4> &corners) const;
+    void initTrack(Track &track, const std::array<cv::Point2f, 4> &corners, double timestamp) const;
+    double associationCost(const Track &track, const std::array<cv::Point2f, 4> &corners) const;
+    void solveAssignment(int rows, int cols);
+
+    Params m_params;
+    std::vector<Track> m_tracks;
+    int m_nextId = 0;
+    double m_timestamp = 0.0;
+    bool m_associated = false;
+
+    // 匈牙利算法工作缓冲区，跨帧复用避免分配
+    std::vector<double> m_cost;
+    std::vector<double> m_u, m_v, m_minv;
+    std::vector<int> m_p, m_way;
+    std::vector<char> m_used;
+    std::vector<int> m_rowMatch; // 每行（检测或轨迹）匹配到的列，-1 表示未匹配
+    std::vector<int> m_trackOfDetection;
+};